@@ -0,0 +1,322 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#include <algorithm>
+#include <stdexcept>
+#include <functional>
+
+#include "CfbWriter.hpp"
+
+
+namespace mswmm {
+
+static constexpr uint32_t ENDOFCHAIN = 0xFFFFFFFE;
+static constexpr uint32_t FATSECT = 0xFFFFFFFD;
+static constexpr uint32_t FREESECT = 0xFFFFFFFF;
+static constexpr uint32_t NOSTREAM = 0xFFFFFFFF;
+static constexpr size_t sectorSize = 4096;
+static constexpr size_t miniSectorSize = 64;
+static constexpr size_t miniStreamCutoff = 4096;
+static constexpr size_t entrySize = 128;
+
+
+
+namespace {
+
+struct Entry {
+  std::u16string name;
+  uint8_t type;
+  std::vector<uint32_t> children;
+  uint32_t left = NOSTREAM;
+  uint32_t right = NOSTREAM;
+  uint32_t child = NOSTREAM;
+  bool red = false;
+  uint32_t start = ENDOFCHAIN;
+  uint64_t size = 0;
+  std::string const* data = nullptr;
+};
+
+} // Anonymous namespace
+
+
+
+static void put16(std::string& s, uint16_t v) {
+  s += static_cast<char>(v & 0xFF);
+  s += static_cast<char>(v >> 8);
+}
+
+
+
+static void put32(std::string& s, uint32_t v) {
+  put16(s, v & 0xFFFF);
+  put16(s, v >> 16);
+}
+
+
+
+static void put64(std::string& s, uint64_t v) {
+  put32(s, v & 0xFFFFFFFF);
+  put32(s, v >> 32);
+}
+
+
+
+static void padTo(std::string& s, size_t alignment, char fill = 0) {
+  if (s.size() % alignment != 0) {
+    s.append(alignment - s.size() % alignment, fill);
+  }
+}
+
+
+
+/**
+ * @brief The order of entries in a storage: shorter names first, then
+ * by upper case name. Only ASCII case folding is done.
+ */
+static bool entryLess(std::u16string const& a, std::u16string const& b) {
+  if (a.size() != b.size()) {
+    return a.size() < b.size();
+  }
+  auto upper = [](char16_t c) -> char16_t {
+    return (c >= u'a' && c <= u'z') ? c - (u'a' - u'A') : c;
+  };
+  for (size_t i = 0; i < a.size(); ++i) {
+    if (upper(a[i]) != upper(b[i])) {
+      return upper(a[i]) < upper(b[i]);
+    }
+  }
+  return false;
+}
+
+
+
+/**
+ * @brief Add a stream to the file. Storages in its path are created
+ * as needed.
+ *
+ * @param path Backslash separated path, e.g. u"ProducerData\\Producer.Dat".
+ * @param data The content of the stream.
+ */
+void CfbWriter::addStream(std::u16string const& path, std::string data) {
+  streams.push_back({path, std::move(data)});
+}
+
+
+
+/**
+ * @brief Serialize the compound file.
+ *
+ * @return std::string The content of the file.
+ */
+std::string CfbWriter::write() const {
+  // Build directory hierarchy. Entry 0 is the root.
+  std::vector<Entry> entries(1);
+  entries[0].name = u"Root Entry";
+  entries[0].type = 5;
+  for (auto const& stream: streams) {
+    uint32_t parent = 0;
+    size_t begin = 0;
+    while (true) {
+      size_t end = stream.path.find(u'\\', begin);
+      std::u16string name = stream.path.substr(begin, end - begin);
+      if (name.empty() || name.size() > 31) {
+        throw std::invalid_argument("Invalid CFB entry name.");
+      }
+      bool isStream = end == std::u16string::npos;
+
+      uint32_t found = NOSTREAM;
+      for (uint32_t c: entries[parent].children) {
+        if (!entryLess(entries[c].name, name) && !entryLess(name, entries[c].name)) {
+          found = c;
+        }
+      }
+      if (found == NOSTREAM) {
+        found = entries.size();
+        Entry e;
+        e.name = name;
+        e.type = isStream ? 2 : 1;
+        entries.push_back(std::move(e));
+        entries[parent].children.push_back(found);
+      }
+      if (isStream) {
+        if (entries[found].type != 2) {
+          throw std::invalid_argument("CFB path used as both storage and stream.");
+        }
+        entries[found].data = &stream.data;
+        entries[found].size = stream.data.size();
+        break;
+      }
+      parent = found;
+      begin = end + 1;
+    }
+  }
+
+  // The children of every storage form a red-black tree. A tree built
+  // from the middle of the sorted children is balanced; coloring its
+  // deepest level red makes all black heights equal.
+  std::function<uint32_t(std::vector<uint32_t> const&, size_t, size_t, int, std::vector<std::pair<uint32_t, int>>&)> build;
+  build = [&](std::vector<uint32_t> const& sorted, size_t lo, size_t hi, int depth,
+              std::vector<std::pair<uint32_t, int>>& depths) -> uint32_t
+  {
+    if (lo >= hi) {
+      return NOSTREAM;
+    }
+    size_t mid = (lo + hi) / 2;
+    uint32_t id = sorted[mid];
+    depths.emplace_back(id, depth);
+    entries[id].left = build(sorted, lo, mid, depth + 1, depths);
+    entries[id].right = build(sorted, mid + 1, hi, depth + 1, depths);
+    return id;
+  };
+  for (auto& storage: entries) {
+    if (storage.children.empty()) {
+      continue;
+    }
+    std::vector<uint32_t> sorted = storage.children;
+    std::sort(sorted.begin(), sorted.end(), [&](uint32_t a, uint32_t b) {
+      return entryLess(entries[a].name, entries[b].name);
+    });
+    std::vector<std::pair<uint32_t, int>> depths;
+    storage.child = build(sorted, 0, sorted.size(), 0, depths);
+    int maxDepth = 0;
+    for (auto const& d: depths) {
+      maxDepth = std::max(maxDepth, d.second);
+    }
+    for (auto const& d: depths) {
+      entries[d.first].red = d.second == maxDepth && maxDepth > 0;
+    }
+  }
+
+  // Lay out the sectors: big streams, mini stream, mini FAT,
+  // directory and finally the FAT itself.
+  std::vector<uint32_t> fat;
+  std::string body;
+  auto allocate = [&](std::string const& data) -> uint32_t {
+    size_t count = (data.size() + sectorSize - 1) / sectorSize;
+    if (count == 0) {
+      return ENDOFCHAIN;
+    }
+    uint32_t start = fat.size();
+    for (size_t i = 0; i < count; ++i) {
+      fat.push_back(i + 1 < count ? start + i + 1 : ENDOFCHAIN);
+    }
+    body += data;
+    padTo(body, sectorSize);
+    return start;
+  };
+
+  std::string miniStream;
+  std::vector<uint32_t> miniFat;
+  for (auto& e: entries) {
+    if (e.type != 2 || e.size == 0) {
+      continue;
+    }
+    if (e.size >= miniStreamCutoff) {
+      e.start = allocate(*e.data);
+      continue;
+    }
+    size_t count = (e.size + miniSectorSize - 1) / miniSectorSize;
+    e.start = miniFat.size();
+    for (size_t i = 0; i < count; ++i) {
+      miniFat.push_back(i + 1 < count ? e.start + i + 1 : ENDOFCHAIN);
+    }
+    miniStream += *e.data;
+    padTo(miniStream, miniSectorSize);
+  }
+  entries[0].start = allocate(miniStream);
+  entries[0].size = miniStream.size();
+
+  std::string miniFatData;
+  for (uint32_t id: miniFat) {
+    put32(miniFatData, id);
+  }
+  padTo(miniFatData, sectorSize, static_cast<char>(0xFF));
+  uint32_t miniFatStart = allocate(miniFatData);
+  size_t miniFatSectors = miniFatData.size() / sectorSize;
+
+  std::string directory;
+  for (auto const& e: entries) {
+    std::string entry;
+    for (size_t i = 0; i < 32; ++i) {
+      put16(entry, i < e.name.size() ? e.name[i] : 0);
+    }
+    put16(entry, (e.name.size() + 1) * 2);
+    entry += static_cast<char>(e.type);
+    entry += static_cast<char>(e.red ? 0 : 1);
+    put32(entry, e.left);
+    put32(entry, e.right);
+    put32(entry, e.child);
+    entry.append(16 + 4 + 8 + 8, 0);
+    put32(entry, e.type == 1 ? 0 : e.start);
+    put64(entry, e.size);
+    directory += entry;
+  }
+  // Unused entries.
+  while (directory.size() % sectorSize != 0) {
+    std::string entry(64 + 2 + 2, 0);
+    put32(entry, NOSTREAM);
+    put32(entry, NOSTREAM);
+    put32(entry, NOSTREAM);
+    entry.append(entrySize - entry.size(), 0);
+    directory += entry;
+  }
+  uint32_t directoryStart = allocate(directory);
+  size_t directorySectors = directory.size() / sectorSize;
+
+  // The FAT has to cover its own sectors.
+  size_t idsPerSector = sectorSize / 4;
+  size_t fatSectors = 0;
+  while (fatSectors * idsPerSector < fat.size() + fatSectors) {
+    ++fatSectors;
+  }
+  if (fatSectors > 109) {
+    throw std::length_error("File too big for a FAT without DIFAT sectors.");
+  }
+  uint32_t fatStart = fat.size();
+  for (size_t i = 0; i < fatSectors; ++i) {
+    fat.push_back(FATSECT);
+  }
+  fat.resize(fatSectors * idsPerSector, FREESECT);
+  for (uint32_t id: fat) {
+    put32(body, id);
+  }
+
+  // Header, padded to a full sector.
+  std::string file = "\xD0\xCF\x11\xE0\xA1\xB1\x1A\xE1";
+  file.append(16, 0);
+  put16(file, 0x3E);
+  put16(file, 4);
+  put16(file, 0xFFFE);
+  put16(file, 12);
+  put16(file, 6);
+  file.append(6, 0);
+  put32(file, directorySectors);
+  put32(file, fatSectors);
+  put32(file, directoryStart);
+  put32(file, 0);
+  put32(file, miniStreamCutoff);
+  put32(file, miniFatSectors ? miniFatStart : ENDOFCHAIN);
+  put32(file, miniFatSectors);
+  put32(file, ENDOFCHAIN);
+  put32(file, 0);
+  for (size_t i = 0; i < 109; ++i) {
+    put32(file, i < fatSectors ? fatStart + i : FREESECT);
+  }
+  padTo(file, sectorSize);
+  return file + body;
+}
+
+} // Namespace mswmm
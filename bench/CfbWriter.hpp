@@ -0,0 +1,49 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#ifndef _MSWMM_CFBWRITER_HPP
+#define _MSWMM_CFBWRITER_HPP
+
+#include <string>
+#include <vector>
+
+
+namespace mswmm {
+
+/**
+ * @brief Writes compound files (CFB version 4), just good enough to
+ * create test and benchmark input.
+ *
+ * Streams smaller than 4096 bytes go into the mini stream like in
+ * real files, and the directory is a proper red-black tree.
+ */
+class CfbWriter {
+  public:
+    void addStream(std::u16string const& path, std::string data);
+    std::string write() const;
+
+  private:
+    struct Stream {
+      std::u16string path;
+      std::string data;
+    };
+
+    std::vector<Stream> streams;
+};
+
+} // Namespace mswmm
+
+#endif
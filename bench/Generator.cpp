@@ -0,0 +1,227 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#include <vector>
+
+#include "Generator.hpp"
+#include "CfbWriter.hpp"
+
+
+namespace mswmm {
+
+/**
+ * @brief Generate a Producer.Dat like Movie Maker 6.0 writes it,
+ * but as UTF-8 and with arbitrarily many items.
+ *
+ * @param params Size of the project.
+ * @return std::string The XML.
+ */
+std::string generateProducerXml(GeneratorParams const& params) {
+  auto n = [](size_t i) { return std::to_string(i); };
+  size_t files = params.sourceFiles > 0 ? params.sourceFiles : 1;
+
+  // Fixed UIDs of the project skeleton, as in the example projects.
+  // Everything else is numbered from 20 onward.
+  size_t uid = 20;
+  std::vector<size_t> sourceUids;
+  std::vector<size_t> thumbUids;
+  for (size_t i = 0; i < files; ++i) {
+    sourceUids.push_back(uid++);
+    thumbUids.push_back(uid++);
+  }
+  size_t audioSourceUid = uid++;
+
+  struct Item {
+    size_t uid;
+    size_t clipUid;
+    size_t effectArrUid;
+    size_t firstEffectUid;
+  };
+  auto makeItems = [&](size_t count, size_t effects) {
+    std::vector<Item> items;
+    for (size_t i = 0; i < count; ++i) {
+      Item item;
+      item.uid = uid++;
+      item.clipUid = uid++;
+      item.effectArrUid = effects > 0 ? uid++ : 0;
+      item.firstEffectUid = uid;
+      uid += effects;
+      items.push_back(item);
+    }
+    return items;
+  };
+  std::vector<Item> videoItems = makeItems(params.items, params.effectsPerItem);
+  std::vector<Item> audioItems = makeItems(params.audioItems, 0);
+
+  std::string xml;
+  xml += "<MovieMaker FileVer=\"4\" MinFile=\"4\" BuildNum=\"1376\"><Project>";
+  xml += "<DataStr HOID=\"" + n(uid) + "\" FileHigh=\"" + n(files) + "\" DocumentGuid=\"{F13FDFF1-C2E5-455B-87A9-043EBE511A51}\">";
+  xml += "<ProducerProperties UID=\"1\" PrerollImage=\"0\" ProjectAspectRatioX=\"4\" ProjectAspectRatioY=\"3\">"
+         "<MetDat MDTag=\"Author\" MDVal=\"libmswmm\"/>"
+         "<MetDat MDTag=\"PresentationTitle\" MDVal=\"Generated project\"/>"
+         "<MetDat MDTag=\"Copyright\" MDVal=\"CC0\"/>"
+         "<MetDat MDTag=\"Rating\" MDVal=\"\"/>"
+         "<MetDat MDTag=\"Description\" MDVal=\"" + n(params.items) + " items\"/>"
+         "</ProducerProperties>";
+  xml += "<StrmArr UID=\"2\"><UID UID=\"3\"/><UID UID=\"11\"/></StrmArr>"
+         "<Stream UID=\"3\" StrmTyp=\"0\"><StrmTrks UID=\"4\"/></Stream>"
+         "<TrkArr UID=\"4\"><UID UID=\"5\"/><UID UID=\"8\"/></TrkArr>"
+         "<Track UID=\"5\" TrackTyp=\"0\" TrackFPS=\"25\" TrkVolume=\"1\"><TrkStream UID=\"3\"/><TrkClips UID=\"6\"/><TrkTransitions UID=\"7\"/></Track>";
+  xml += "<TIArr UID=\"6\">";
+  for (auto const& item: videoItems) {
+    xml += "<UID UID=\"" + n(item.uid) + "\"/>";
+  }
+  xml += "</TIArr><TiTransitionArr UID=\"7\"/>";
+  xml += "<Track UID=\"8\" TrackTyp=\"5\" TrackFPS=\"25\"><TrkStream UID=\"3\"/><TrkClips UID=\"9\"/><TrkTransitions UID=\"10\"/></Track>"
+         "<TIArr UID=\"9\"/><TiTransitionArr UID=\"10\"/>"
+         "<Stream UID=\"11\" StrmTyp=\"1\"><StrmTrks UID=\"12\"/></Stream>"
+         "<TrkArr UID=\"12\"><UID UID=\"13\"/></TrkArr>"
+         "<Track UID=\"13\" TrackTyp=\"1\" TrackFPS=\"25\" TrkVolume=\"1\"><TrkStream UID=\"11\"/><TrkClips UID=\"14\"/><TrkTransitions UID=\"15\"/></Track>";
+  xml += "<TIArr UID=\"14\">";
+  for (auto const& item: audioItems) {
+    xml += "<UID UID=\"" + n(item.uid) + "\"/>";
+  }
+  xml += "</TIArr><TiTransitionArr UID=\"15\"/>";
+  xml += "<SnapPointArray UID=\"16\"/>"
+         "<CustomFolder UID=\"17\" ClpNam=\"/\"><Srce UID=\"0\"/><Thmb UID=\"0\"/><ChildFolders UID=\"19\"/><ChildClips UID=\"18\"/><ParentFile UID=\"0\"/></CustomFolder>"
+         "<AVClipArr UID=\"18\"/><ChildFolders UID=\"19\"/>";
+
+  for (size_t i = 0; i < files; ++i) {
+    xml += "<AVSource UID=\"" + n(sourceUids[i]) + "\" RefDoc=\"1\" FileID=\"" + n(i+1) + "\" SrcAnalyszed=\"1\" "
+           "SrcModifyHigh=\"31015254\" SrcModifyLow=\"-962100480\" FileSize=\"" + n(100 + i % 400) + "\" "
+           "FileType=\"JPEG Image\" FileKind=\"4\" DateTakenHigh=\"0\" DateTakenLow=\"0\" SrcDuration=\"0\" SrcIsDV=\"0\" "
+           "SrcIsVideo=\"1\" SrcIsAudio=\"0\" SrcFrameRate=\"30.00003000003\" SrcHeight=\"768\" SrcWidth=\"1024\" "
+           "SrcVideoBitrate=\"0\" SrcAudioBitrate=\"0\" SrcAudioAnalyzed=\"0\" SrcVideoARX=\"1024\" SrcVideoARY=\"768\"/>";
+    xml += "<Thmb UID=\"" + n(thumbUids[i]) + "\" RefDoc=\"2\" ClipThumbnailFile=\"Thumbnails\\Data." + n(i+1) + "\"/>";
+  }
+  if (!audioItems.empty()) {
+    xml += "<AVSource UID=\"" + n(audioSourceUid) + "\" RefDoc=\"1\" FileID=\"" + n(files+1) + "\" SrcAnalyszed=\"1\" "
+           "SrcModifyHigh=\"31015436\" SrcModifyLow=\"750111224\" FileSize=\"76\" FileType=\"MP3 Format Sound\" FileKind=\"3\" "
+           "DateTakenHigh=\"0\" DateTakenLow=\"0\" SrcDuration=\"9.762875\" SrcIsDV=\"0\" SrcIsVideo=\"0\" SrcIsAudio=\"1\" "
+           "SrcFrameRate=\"0\" SrcHeight=\"0\" SrcWidth=\"0\" SrcVideoBitrate=\"0\" SrcAudioBitrate=\"64000\" "
+           "SrcAudioAnalyzed=\"1\" SrcVideoARX=\"0\" SrcVideoARY=\"0\"/>";
+  }
+
+  for (size_t i = 0; i < videoItems.size(); ++i) {
+    auto const& item = videoItems[i];
+    size_t file = i % files;
+    xml += "<TmlnStillItem UID=\"" + n(item.uid) + "\" TmlnSrt=\"" + n(i*5) + "\" TmlnEnd=\"" + n(i*5 + 5) + "\" "
+           "ClipSpeed=\"1\" ClpSrt=\"0\" ClpEnd=\"5\" OrgClpSrt=\"0\" OrgClpEnd=\"5\" ClpThumb=\"0\" ClpStretch=\"2\" "
+           "TmlnMute=\"0\" TmlnFadeIn=\"0\" TmlnFadeOut=\"0\" ClipVolume=\"1\" ClipLimitClipping=\"0\">"
+           "<ClipTrack UID=\"5\"/><ClipWMItem UID=\"" + n(item.clipUid) + "\"/><TiEffectArr UID=\"" + n(item.effectArrUid) + "\"/>"
+           "<TAVTransition UID=\"0\"/><TAVTransitionRight UID=\"0\"/><Thmb UID=\"" + n(thumbUids[file]) + "\"/></TmlnStillItem>";
+    xml += "<ClipStill UID=\"" + n(item.clipUid) + "\" ClpNam=\"picture " + n(file+1) + "\" ClpSrt=\"0\" ClpEnd=\"0\" ClpThumb=\"0\" "
+           "DateTakenHigh=\"0\" DateTakenLow=\"0\" ClipIsDVClip=\"0\" AEStartTime=\"0\" AEEndTime=\"0\">"
+           "<Srce UID=\"" + n(sourceUids[file]) + "\"/><Thmb UID=\"" + n(thumbUids[file]) + "\"/><ParentFile UID=\"0\"/></ClipStill>";
+    if (params.effectsPerItem > 0) {
+      xml += "<TiEffectArr UID=\"" + n(item.effectArrUid) + "\">";
+      for (size_t e = 0; e < params.effectsPerItem; ++e) {
+        xml += "<UID UID=\"" + n(item.firstEffectUid + e) + "\"/>";
+      }
+      xml += "</TiEffectArr>";
+      for (size_t e = 0; e < params.effectsPerItem; ++e) {
+        bool in = e % 2 == 0;
+        std::string name = in ? "Fade In, From Black" : "Fade Out, To Black";
+        xml += "<TiEffect UID=\"" + n(item.firstEffectUid + e) + "\" TmlnSrt=\"0\" TmlnEnd=\"0.04\" ClipSpeed=\"1\" TiEffectDuration=\"" + n(e+1) + "\">"
+               "<ClipTrack UID=\"5\"/><ClipWMItem UID=\"0\"/>"
+               "<TiEffectPtr TFXName=\"" + name + "\" TFXGuid=\"TFX\\" + name + "\" TFXID=\"\" TFXEffectType=\"0\" TFXImage=\"10\" TFXSpeed=\"1\" TFXDuration=\"0\" TFXEffect=\"1\">"
+               "<FXParamList FXParamName=\"Animation(0.000000,8)\" FXParamValue=\"FX\"/>"
+               "<FXParamList FXParamName=\"FXFile(0.000000,8)\" FXParamValue=\"Parity.fx\"/>"
+               "<FXParamList FXParamName=\"Technique(0.000000,8)\" FXParamValue=\"Fade\"/>"
+               "<FXParamList FXParamName=\"3:Semantics/FadeColor(0.000000,4100)\" FXParamValue=\"" + (in ? "0, 0, 0, 1" : "0, 0, 0, 0") + "\"/>"
+               "<FXParamList FXParamName=\"3:Semantics/FadeColor(1.000000,4100)\" FXParamValue=\"" + (in ? "0, 0, 0, 0" : "0, 0, 0, 1") + "\"/>"
+               "</TiEffectPtr><TEItem UID=\"" + n(item.uid) + "\"/></TiEffect>";
+      }
+    }
+  }
+
+  for (size_t i = 0; i < audioItems.size(); ++i) {
+    auto const& item = audioItems[i];
+    float start = i * 9.762875f;
+    xml += "<TmlnAudioItem UID=\"" + n(item.uid) + "\" TmlnSrt=\"" + std::to_string(start) + "\" TmlnEnd=\"" + std::to_string(start + 9.762875f) + "\" "
+           "ClipSpeed=\"1\" ClpSrt=\"0\" ClpEnd=\"9.762875\" OrgClpSrt=\"0\" OrgClpEnd=\"9.762875\" ClpThumb=\"0\" ClpStretch=\"2\" "
+           "TmlnMute=\"0\" TmlnFadeIn=\"1\" TmlnFadeOut=\"1\" ClipVolume=\"0.48\" ClipLimitClipping=\"0\">"
+           "<ClipTrack UID=\"13\"/><ClipWMItem UID=\"" + n(item.clipUid) + "\"/><TiEffectArr UID=\"0\"/>"
+           "<TAVTransition UID=\"0\"/><TAVTransitionRight UID=\"0\"/><Thmb UID=\"0\"/></TmlnAudioItem>";
+    xml += "<ClipAudio UID=\"" + n(item.clipUid) + "\" ClpNam=\"sound\" ClpSrt=\"0\" ClpEnd=\"9.762875\" ClpThumb=\"0\" "
+           "DateTakenHigh=\"0\" DateTakenLow=\"0\" ClipIsDVClip=\"0\" AEStartTime=\"0\" AEEndTime=\"9.762875\">"
+           "<Srce UID=\"" + n(audioSourceUid) + "\"/><Thmb UID=\"0\"/><ParentFile UID=\"0\"/></ClipAudio>";
+  }
+
+  for (size_t i = 0; i < files; ++i) {
+    xml += "<FileInfo SrceFn=\"@:MyPictures\\generated\\picture-" + n(i+1) + ".jpg\" FileRelative=\"0\" FileUnique=\"0\" "
+           "FileID=\"" + n(i+1) + "\" FileOID=\"" + n(sourceUids[i]) + "\" LinkPath=\"ShellLink\\Data." + n(files + i + 1) + "\"/>";
+  }
+  if (!audioItems.empty()) {
+    xml += "<FileInfo SrceFn=\"@:MyMusic\\generated\\sound.mp3\" FileRelative=\"0\" FileUnique=\"0\" "
+           "FileID=\"" + n(files+1) + "\" FileOID=\"" + n(audioSourceUid) + "\" LinkPath=\"ShellLink\\Data." + n(2*files + 1) + "\"/>";
+  }
+
+  xml += "</DataStr><ProjectProps UID=\"1\"/><Timeline NormalizeAudio=\"0\"><StrmArr UID=\"2\"/><SnapPointArray UID=\"16\"/></Timeline>"
+         "<ProjColl><CustomFolder UID=\"17\"/></ProjColl><MetDat UID=\"0\"/></Project></MovieMaker>";
+  return xml;
+}
+
+
+
+/**
+ * @brief Generate a complete .MSWMM file.
+ *
+ * Besides Producer.Dat, the file contains a thumbnail and a ShellLink
+ * stream per source file, so the directory looks like the real thing.
+ * Their content is only a placeholder.
+ *
+ * @param params Size of the project.
+ * @return std::string The content of the file.
+ */
+std::string generateProject(GeneratorParams const& params) {
+  std::string xml = generateProducerXml(params) + "\r\n";
+
+  // Producer.Dat is zero terminated UTF-16LE. The generated XML is
+  // ASCII only, so widening is enough.
+  std::string producerDat;
+  producerDat.reserve(xml.size() * 2 + 2);
+  for (char c: xml) {
+    producerDat += c;
+    producerDat += '\0';
+  }
+  producerDat.append(2, '\0');
+
+  CfbWriter writer;
+  writer.addStream(u"ProducerData\\Producer.Dat", std::move(producerDat));
+  size_t files = params.sourceFiles > 0 ? params.sourceFiles : 1;
+  size_t links = files + (params.audioItems > 0 ? 1 : 0);
+  auto name = [](size_t i) {
+    std::string n = "Data." + std::to_string(i);
+    return std::u16string(n.begin(), n.end());
+  };
+  for (size_t i = 0; i < files; ++i) {
+    // Start and end of a JPEG file, with some room in between.
+    std::string thumbnail = "\xFF\xD8\xFF\xE0";
+    thumbnail.append(2000, '\0');
+    thumbnail += "\xFF\xD9";
+    writer.addStream(u"ProducerData\\Thumbnails\\" + name(i+1), std::move(thumbnail));
+  }
+  for (size_t i = 0; i < links; ++i) {
+    // Header of a ShellLink without any further structures.
+    std::string link("\x4C\0\0\0\x01\x14\x02\0\0\0\0\0\xC0\0\0\0\0\0\0\x46", 20);
+    link.append(76 - link.size(), '\0');
+    writer.addStream(u"ProducerData\\ShellLink\\" + name(files + i + 1), std::move(link));
+  }
+  return writer.write();
+}
+
+} // Namespace mswmm
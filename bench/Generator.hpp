@@ -0,0 +1,44 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#ifndef _MSWMM_GENERATOR_HPP
+#define _MSWMM_GENERATOR_HPP
+
+#include <string>
+#include <cstddef>
+
+
+namespace mswmm {
+
+struct GeneratorParams {
+  // Pictures on the video timeline, each 5s long, one after another.
+  size_t items = 100;
+  // Effects applied to every picture.
+  size_t effectsPerItem = 0;
+  // Distinct pictures the timeline items are taken from.
+  size_t sourceFiles = 10;
+  // Sound clips on the audio timeline, all from one extra file.
+  size_t audioItems = 0;
+};
+
+
+
+std::string generateProducerXml(GeneratorParams const& params);
+std::string generateProject(GeneratorParams const& params);
+
+} // Namespace mswmm
+
+#endif
@@ -0,0 +1,580 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#include <new>
+#include <atomic>
+#include <memory>
+#include <cstdlib>
+#include <sstream>
+#include <unordered_map>
+#include <memory_resource>
+
+#include <benchmark/benchmark.h>
+#include <compoundfilereader.h>
+#ifdef MSWMM_WITH_QT
+#include <qdom.h>
+#include <QString>
+#endif
+
+#include "Project.hpp"
+#include "XmlTree.hpp"
+#include "XmlReader.hpp"
+#include "CompoundFile.hpp"
+#include "Utf.hpp"
+#include "Generator.hpp"
+#include "Export.hpp"
+#include "Snapshot.hpp"
+#include "ArchiveIndex.hpp"
+#include "Render.hpp"
+
+
+// Count heap allocations, so the benchmarks can report them. Allocations
+// Qt does with malloc() internally are not included. All forms of new
+// and delete are replaced, so they stay matched; they are not inlined,
+// as the compiler would pair the malloc() of one with the free() of
+// another otherwise.
+static std::atomic<size_t> allocationCount(0);
+
+#if defined(__GNUC__) || defined(__clang__)
+#define BENCH_NOINLINE __attribute__((noinline))
+#else
+#define BENCH_NOINLINE
+#endif
+
+BENCH_NOINLINE static void* countedAlloc(size_t size, size_t alignment) {
+  allocationCount.fetch_add(1, std::memory_order_relaxed);
+  size = size ? size : 1;
+  if (alignment <= alignof(std::max_align_t)) {
+    return std::malloc(size);
+  }
+  // aligned_alloc() needs a multiple of the alignment.
+  return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+BENCH_NOINLINE static void countedFree(void* p) noexcept {
+  std::free(p);
+}
+
+static void* countedNew(size_t size, size_t alignment) {
+  if (void* p = countedAlloc(size, alignment)) {
+    return p;
+  }
+  throw std::bad_alloc();
+}
+
+constexpr size_t defaultAlignment = alignof(std::max_align_t);
+
+BENCH_NOINLINE void* operator new(size_t size) { return countedNew(size, defaultAlignment); }
+BENCH_NOINLINE void* operator new[](size_t size) { return countedNew(size, defaultAlignment); }
+BENCH_NOINLINE void* operator new(size_t size, std::align_val_t a) { return countedNew(size, static_cast<size_t>(a)); }
+BENCH_NOINLINE void* operator new[](size_t size, std::align_val_t a) { return countedNew(size, static_cast<size_t>(a)); }
+BENCH_NOINLINE void* operator new(size_t size, std::nothrow_t const&) noexcept { return countedAlloc(size, defaultAlignment); }
+BENCH_NOINLINE void* operator new[](size_t size, std::nothrow_t const&) noexcept { return countedAlloc(size, defaultAlignment); }
+BENCH_NOINLINE void* operator new(size_t size, std::align_val_t a, std::nothrow_t const&) noexcept {
+  return countedAlloc(size, static_cast<size_t>(a));
+}
+BENCH_NOINLINE void* operator new[](size_t size, std::align_val_t a, std::nothrow_t const&) noexcept {
+  return countedAlloc(size, static_cast<size_t>(a));
+}
+
+BENCH_NOINLINE void operator delete(void* p) noexcept { countedFree(p); }
+BENCH_NOINLINE void operator delete[](void* p) noexcept { countedFree(p); }
+BENCH_NOINLINE void operator delete(void* p, size_t) noexcept { countedFree(p); }
+BENCH_NOINLINE void operator delete[](void* p, size_t) noexcept { countedFree(p); }
+BENCH_NOINLINE void operator delete(void* p, std::align_val_t) noexcept { countedFree(p); }
+BENCH_NOINLINE void operator delete[](void* p, std::align_val_t) noexcept { countedFree(p); }
+BENCH_NOINLINE void operator delete(void* p, size_t, std::align_val_t) noexcept { countedFree(p); }
+BENCH_NOINLINE void operator delete[](void* p, size_t, std::align_val_t) noexcept { countedFree(p); }
+BENCH_NOINLINE void operator delete(void* p, std::nothrow_t const&) noexcept { countedFree(p); }
+BENCH_NOINLINE void operator delete[](void* p, std::nothrow_t const&) noexcept { countedFree(p); }
+BENCH_NOINLINE void operator delete(void* p, std::align_val_t, std::nothrow_t const&) noexcept { countedFree(p); }
+BENCH_NOINLINE void operator delete[](void* p, std::align_val_t, std::nothrow_t const&) noexcept { countedFree(p); }
+
+
+
+namespace {
+
+using namespace mswmm;
+
+// Generated projects are cached, as generating them takes longer than
+// most of the benchmarks.
+std::string const& project(size_t items, size_t effects = 0) {
+  static std::unordered_map<size_t, std::string> projects;
+  size_t key = items * 16 + effects;
+  auto it = projects.find(key);
+  if (it == projects.end()) {
+    GeneratorParams params;
+    params.items = items;
+    params.effectsPerItem = effects;
+    params.sourceFiles = items / 4 + 1;
+    params.audioItems = items / 10;
+    it = projects.emplace(key, generateProject(params)).first;
+  }
+  return it->second;
+}
+
+
+
+// The generated XML is ASCII only, so widening is enough.
+std::u16string producerXml(size_t items, size_t effects = 0) {
+  GeneratorParams params;
+  params.items = items;
+  params.effectsPerItem = effects;
+  params.sourceFiles = items / 4 + 1;
+  params.audioItems = items / 10;
+  std::string xml = generateProducerXml(params);
+  return std::u16string(xml.begin(), xml.end());
+}
+
+
+
+// Sections are extracted lazily, so touch all of them.
+void extractAll(Project const& project) {
+  benchmark::DoNotOptimize(project.metadata());
+  benchmark::DoNotOptimize(project.sourceFiles().size());
+  benchmark::DoNotOptimize(project.videoTimeline().size());
+  benchmark::DoNotOptimize(project.audioTimeline().size());
+}
+
+
+
+void countAllocations(benchmark::State& state, size_t start) {
+  state.counters["allocs"] = benchmark::Counter(
+    allocationCount.load() - start, benchmark::Counter::kAvgIterations);
+}
+
+
+
+// Stage 1: opening the container and finding Producer.Dat.
+void BM_CfbFindStream(benchmark::State& state) {
+  std::string const& data = project(state.range(0));
+  for (auto _: state) {
+    CFB::CompoundFileReader reader(data.data(), data.size());
+    benchmark::DoNotOptimize(findStream(reader, u"ProducerData\\Producer.Dat"));
+  }
+}
+BENCHMARK(BM_CfbFindStream)->Arg(100)->Arg(10000);
+
+
+
+// The same, but visiting every entry like the code before the directory
+// tree lookup did.
+void BM_CfbEnumFiles(benchmark::State& state) {
+  std::string const& data = project(state.range(0));
+  for (auto _: state) {
+    CFB::CompoundFileReader reader(data.data(), data.size());
+    CFB::COMPOUND_FILE_ENTRY const* found = nullptr;
+    reader.EnumFiles(reader.GetRootEntry(), -1,
+      [&](CFB::COMPOUND_FILE_ENTRY const* entry, CFB::utf16string const&, int) {
+        if (reader.IsStream(entry) && compareEntryName(entry, u"Producer.Dat") == 0) {
+          found = entry;
+        }
+      });
+    benchmark::DoNotOptimize(found);
+  }
+}
+BENCHMARK(BM_CfbEnumFiles)->Arg(100)->Arg(10000);
+
+
+
+#ifdef MSWMM_WITH_QT
+
+// Stage 2: decoding the UTF-16 stream. Loading only trims it and
+// parses it in place; copying it into a QString is the old way.
+void BM_DecodeUtf16(benchmark::State& state) {
+  std::string const& data = project(state.range(0));
+  CFB::CompoundFileReader reader(data.data(), data.size());
+  auto entry = findStream(reader, u"ProducerData\\Producer.Dat");
+  std::vector<char16_t> buffer(entry->size / 2);
+  reader.ReadFile(entry, 0, reinterpret_cast<char*>(buffer.data()), entry->size);
+  for (auto _: state) {
+    QString xml = QString::fromUtf16(buffer.data(), buffer.size()).trimmed();
+    benchmark::DoNotOptimize(xml);
+  }
+  state.SetBytesProcessed(state.iterations() * entry->size);
+}
+BENCHMARK(BM_DecodeUtf16)->Arg(100)->Arg(10000);
+
+#endif
+
+
+
+// Converting UTF-16 to UTF-8, as done for all names and values.
+// The second argument is the percentage of non-ASCII characters.
+void BM_AppendUtf8(benchmark::State& state) {
+  std::u16string text(state.range(0), u'a');
+  for (size_t i = 0; state.range(1) > 0 && i < text.size(); i += 100 / state.range(1)) {
+    text[i] = u'\u00e4';
+  }
+  std::string target;
+  for (auto _: state) {
+    target.clear();
+    appendUtf8(target, text);
+    benchmark::DoNotOptimize(target);
+  }
+  state.SetBytesProcessed(state.iterations() * text.size() * 2);
+}
+BENCHMARK(BM_AppendUtf8)->Args({16, 0})->Args({4096, 0})->Args({4096, 1})->Args({4096, 20});
+
+
+
+// Stage 3: parsing the XML into the element tree.
+void BM_ParseXml(benchmark::State& state) {
+  std::u16string xml = producerXml(state.range(0));
+  size_t start = allocationCount.load();
+  for (auto _: state) {
+    XmlTree tree;
+    readXml(xml, tree);
+    benchmark::DoNotOptimize(tree);
+  }
+  countAllocations(state, start);
+  state.SetBytesProcessed(state.iterations() * xml.size() * 2);
+}
+BENCHMARK(BM_ParseXml)->Arg(100)->Arg(10000);
+
+
+
+#ifdef MSWMM_WITH_QT
+
+// The same with Qt's pull parser.
+void BM_ParseXmlQtStream(benchmark::State& state) {
+  std::u16string text = producerXml(state.range(0));
+  QString xml = QString::fromUtf16(text.data(), text.size());
+  size_t start = allocationCount.load();
+  for (auto _: state) {
+    XmlTree tree;
+    readXmlStream(xml, tree);
+    benchmark::DoNotOptimize(tree);
+  }
+  countAllocations(state, start);
+  state.SetBytesProcessed(state.iterations() * xml.size() * 2);
+}
+BENCHMARK(BM_ParseXmlQtStream)->Arg(100)->Arg(10000);
+
+
+
+// Building a DOM instead, as XmlParser::DOM does.
+void BM_ParseXmlDom(benchmark::State& state) {
+  std::u16string text = producerXml(state.range(0));
+  QString xml = QString::fromUtf16(text.data(), text.size());
+  for (auto _: state) {
+    QDomDocument doc;
+    doc.setContent(xml, false, nullptr, nullptr, nullptr);
+    benchmark::DoNotOptimize(doc);
+  }
+  state.SetBytesProcessed(state.iterations() * xml.size() * 2);
+}
+BENCHMARK(BM_ParseXmlDom)->Arg(100)->Arg(10000);
+
+#endif
+
+
+
+// Stage 4: building the timelines out of the element tree.
+void BM_AnalyzeXml(benchmark::State& state) {
+  XmlTree tree;
+  readXml(producerXml(state.range(0), state.range(1)), tree);
+  for (auto _: state) {
+    state.PauseTiming();
+    XmlTree copy(tree);
+    state.ResumeTiming();
+    Project project(std::move(copy));
+    extractAll(project);
+  }
+}
+BENCHMARK(BM_AnalyzeXml)->Args({100, 0})->Args({1000, 2})->Args({10000, 0});
+
+
+
+// Extracting the video timeline through the UID index, as
+// Project::videoTimeline() does. The index is built anew in each
+// iteration, as it would be for every opened project.
+void BM_VideoTimeline(benchmark::State& state) {
+  XmlTree tree;
+  readXml(producerXml(state.range(0)), tree);
+  std::unique_ptr<Project> project;
+  for (auto _: state) {
+    state.PauseTiming();
+    project.reset();
+    project = std::make_unique<Project>(XmlTree(tree));
+    state.ResumeTiming();
+    benchmark::DoNotOptimize(project->videoTimeline().size());
+  }
+}
+BENCHMARK(BM_VideoTimeline)->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+
+
+// The same chain of lookups, from the timeline item over the ClipWMItem
+// and the AVSource to the FileInfo, with the linear search of
+// Project::getTagWithAttr() the code used before the UID index.
+XmlTree::Element findLinear(XmlTree::Element parent, std::string_view tag, std::string_view attr, std::string_view value) {
+  auto n = parent.firstChildElement(tag);
+  while (!n.isNull() && !(n.hasAttribute(attr) && n.attribute(attr) == value)) {
+    n = n.nextSiblingElement(tag);
+  }
+  return n;
+}
+
+
+
+void BM_VideoTimelineLinear(benchmark::State& state) {
+  XmlTree tree;
+  readXml(producerXml(state.range(0)), tree);
+  auto dataStr = tree.documentElement().firstChildElement("Project").firstChildElement("DataStr");
+  for (auto _: state) {
+    Timeline timeline;
+    auto track = findLinear(dataStr, "Track", "TrackTyp", "0");
+    auto items = findLinear(dataStr, "TIArr", "UID", track.firstChildElement("TrkClips").attribute("UID"));
+    for (auto n = items.firstChildElement("UID"); !n.isNull(); n = n.nextSiblingElement("UID")) {
+      auto tmlnItem = findLinear(dataStr, "", "UID", n.attribute("UID"));
+      auto clipItem = findLinear(dataStr, "", "UID", tmlnItem.firstChildElement("ClipWMItem").attribute("UID"));
+      auto avSource = findLinear(dataStr, "AVSource", "UID", clipItem.firstChildElement("Srce").attribute("UID"));
+      auto fileInfo = findLinear(dataStr, "FileInfo", "FileID", avSource.attribute("FileID"));
+      TimelineItem& ti = timeline.addItem(ItemType::VIDEO);
+      ti.timelineStart = tmlnItem.floatAttribute("TmlnSrt");
+      ti.timelineEnd = tmlnItem.floatAttribute("TmlnEnd");
+      ti.srcPath = timeline.intern(fileInfo.attribute("SrceFn"));
+    }
+    benchmark::DoNotOptimize(timeline.size());
+  }
+}
+BENCHMARK(BM_VideoTimelineLinear)->Arg(1000)->Arg(10000)->Unit(benchmark::kMillisecond);
+
+
+
+// All stages together, from the file content to the finished project.
+void BM_LoadProject(benchmark::State& state) {
+  std::string const& data = project(state.range(0), 1);
+  size_t start = allocationCount.load();
+  for (auto _: state) {
+    Project project(data.data(), data.size());
+    extractAll(project);
+  }
+  countAllocations(state, start);
+}
+BENCHMARK(BM_LoadProject)->Arg(100)->Arg(10000);
+
+
+
+// The same with statistics collected, to see what they cost.
+void BM_LoadProjectStats(benchmark::State& state) {
+  std::string const& data = project(state.range(0), 1);
+  LoadOptions options;
+  options.collectStats = true;
+  for (auto _: state) {
+    Project project(data.data(), data.size(), options);
+    extractAll(project);
+    benchmark::DoNotOptimize(project.stats());
+  }
+}
+BENCHMARK(BM_LoadProjectStats)->Arg(100)->Arg(10000);
+
+
+
+// Only the list of source files, as a dependency scan needs it.
+void BM_LoadSourceFiles(benchmark::State& state) {
+  std::string const& data = project(state.range(0), 1);
+  for (auto _: state) {
+    Project project(data.data(), data.size());
+    benchmark::DoNotOptimize(project.sourceFiles().size());
+  }
+}
+BENCHMARK(BM_LoadSourceFiles)->Arg(100)->Arg(10000);
+
+
+
+// The same with all memory of the project taken from an arena.
+void BM_LoadProjectArena(benchmark::State& state) {
+  std::string const& data = project(state.range(0), 1);
+  std::pmr::monotonic_buffer_resource arena(data.size() * 4);
+  LoadOptions options;
+  options.memoryResource = &arena;
+  size_t start = allocationCount.load();
+  for (auto _: state) {
+    {
+      Project project(data.data(), data.size(), options);
+      extractAll(project);
+    }
+    arena.release();
+  }
+  countAllocations(state, start);
+}
+BENCHMARK(BM_LoadProjectArena)->Arg(100)->Arg(10000);
+
+
+
+// Finding what plays at a time, as when scrubbing through a project.
+void BM_IntervalQuery(benchmark::State& state) {
+  std::string const& data = project(state.range(0));
+  Project project(data.data(), data.size());
+  IntervalIndex const& intervals = project.intervals();
+  float length = project.videoTimeline()[project.videoTimeline().size() - 1].timelineEnd;
+  float time = 0;
+  for (auto _: state) {
+    benchmark::DoNotOptimize(intervals.at(time));
+    time += 0.37f;
+    if (time > length) {
+      time = 0;
+    }
+  }
+}
+BENCHMARK(BM_IntervalQuery)->Arg(100)->Arg(10000);
+
+
+
+// Output stages.
+void BM_GenerateFfmpegCommand(benchmark::State& state) {
+  std::string const& data = project(state.range(0));
+  Project project(data.data(), data.size());
+  PathSubstitutions substitutions({
+    {"@:MyPictures\\", "/home/user/Pictures/"},
+    {"@:MyMusic\\", "/home/user/Music/"},
+    {"\\", "/"}
+  });
+  for (auto _: state) {
+    benchmark::DoNotOptimize(project.generateFfmpegCommand(substitutions));
+  }
+}
+BENCHMARK(BM_GenerateFfmpegCommand)->Arg(100)->Arg(10000);
+
+
+
+// Rewriting paths with many remapping rules, as in batch conversions:
+// drive letters plus the given number of folder rules.
+void BM_SubstitutePaths(benchmark::State& state) {
+  std::vector<std::pair<std::string, std::string>> rules;
+  for (char drive = 'C'; drive <= 'Z'; ++drive) {
+    rules.push_back({std::string(1, drive) + ":\\", std::string("/mnt/") + char(drive - 'A' + 'a') + "/"});
+  }
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    rules.push_back({"\\Folder" + std::to_string(i) + "\\", "/folder-" + std::to_string(i) + "/"});
+  }
+  rules.push_back({"\\", "/"});
+  PathSubstitutions substitutions(rules);
+
+  std::vector<std::string> paths;
+  for (int i = 0; i < 1000; ++i) {
+    paths.push_back(std::string(1, 'C' + i % 24) + ":\\Users\\user\\Folder" + std::to_string(i % 500) +
+                    "\\Holiday " + std::to_string(i) + "\\DSC_" + std::to_string(1000 + i) + ".JPG");
+  }
+  for (auto _: state) {
+    for (auto const& path: paths) {
+      benchmark::DoNotOptimize(substitutions.apply(path));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * paths.size());
+}
+BENCHMARK(BM_SubstitutePaths)->Arg(10)->Arg(500);
+
+
+
+void BM_PrintInfo(benchmark::State& state) {
+  std::string const& data = project(state.range(0));
+  Project project(data.data(), data.size());
+  for (auto _: state) {
+    std::ostringstream out;
+    project.printMetadata(out);
+    project.printFiles(out);
+    project.printMediaTimeline(out, TrackType::VIDEO);
+    project.printMediaTimeline(out, TrackType::AUDIO);
+    benchmark::DoNotOptimize(out);
+  }
+}
+BENCHMARK(BM_PrintInfo)->Arg(100)->Arg(10000);
+
+
+
+// The structured exports of what BM_PrintInfo prints.
+void BM_ExportJson(benchmark::State& state) {
+  std::string const& data = project(state.range(0), 2);
+  Project project(data.data(), data.size());
+  for (auto _: state) {
+    benchmark::DoNotOptimize(exportJson(project));
+  }
+}
+BENCHMARK(BM_ExportJson)->Arg(100)->Arg(10000);
+
+
+
+void BM_ExportSnapshot(benchmark::State& state) {
+  std::string const& data = project(state.range(0), 2);
+  Project project(data.data(), data.size());
+  for (auto _: state) {
+    benchmark::DoNotOptimize(exportSnapshot(project));
+  }
+}
+BENCHMARK(BM_ExportSnapshot)->Arg(100)->Arg(10000);
+
+
+
+// Reading all items in place, as a downstream service would.
+void BM_ReadSnapshot(benchmark::State& state) {
+  std::string const& data = project(state.range(0), 2);
+  std::string snapshot = exportSnapshot(Project(data.data(), data.size()));
+  for (auto _: state) {
+    Snapshot view(snapshot.data(), snapshot.size());
+    float end = 0;
+    for (size_t i = 0; i < view.itemCount(TrackType::VIDEO); ++i) {
+      SnapshotItem item = view.item(TrackType::VIDEO, i);
+      end += item.timelineEnd + item.srcPath.size();
+    }
+    benchmark::DoNotOptimize(end);
+  }
+}
+BENCHMARK(BM_ReadSnapshot)->Arg(100)->Arg(10000);
+
+
+
+// Queries of an archive index of many projects, which all use the
+// source files of the same project.
+void BM_ArchiveIndexLookup(benchmark::State& state) {
+  std::string const& data = project(100);
+  Project project(data.data(), data.size());
+  ArchiveIndexBuilder builder;
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    builder.addProject("archive/" + std::to_string(i) + ".MSWMM", project);
+  }
+  std::string index = builder.write();
+  std::string media(project.videoTimeline().srcPath(project.videoTimeline()[0]));
+  std::string path = "archive/" + std::to_string(state.range(0) / 2) + ".MSWMM";
+  for (auto _: state) {
+    ArchiveIndex view(index.data(), index.size());
+    ArchiveMedia mediaFile = view.mediaFile(*view.findMedia(media));
+    ArchiveProject archiveProject = view.project(*view.findProject(path));
+    benchmark::DoNotOptimize(mediaFile.projectCount + archiveProject.mediaCount);
+  }
+}
+BENCHMARK(BM_ArchiveIndexLookup)->Arg(1000)->Arg(100000);
+
+
+
+void BM_PrintXml(benchmark::State& state) {
+  std::string const& data = project(state.range(0));
+  Project project(data.data(), data.size());
+  for (auto _: state) {
+    std::ostringstream out;
+    project.printXml(out);
+    benchmark::DoNotOptimize(out);
+  }
+}
+BENCHMARK(BM_PrintXml)->Arg(100)->Arg(10000);
+
+} // Namespace
+
+
+
+BENCHMARK_MAIN();
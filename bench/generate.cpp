@@ -0,0 +1,57 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#include <string>
+#include <fstream>
+#include <iostream>
+
+#include "Generator.hpp"
+
+
+void printUsage(char const* name) {
+  std::cout << "Usage: " << name << " <output file> [items] [effects per item] [source files] [audio items]\n"
+            << "Write a synthetic .MSWMM project, e.g. for benchmarking.\n";
+}
+
+
+
+int main(int argc, char* argv[]) {
+  if (argc < 2 || argc > 6) {
+    printUsage(argv[0]);
+    return 1;
+  }
+
+  mswmm::GeneratorParams params;
+  size_t* values[] = {&params.items, &params.effectsPerItem, &params.sourceFiles, &params.audioItems};
+  for (int i = 2; i < argc; ++i) {
+    try {
+      *values[i-2] = std::stoul(argv[i]);
+    }
+    catch (std::exception const&) {
+      printUsage(argv[0]);
+      return 1;
+    }
+  }
+
+  std::ofstream file(argv[1], std::ios::binary);
+  if (!file) {
+    std::cerr << "Could not open " << argv[1] << " for writing.\n";
+    return 1;
+  }
+  std::string project = mswmm::generateProject(params);
+  file.write(project.data(), project.size());
+  return file ? 0 : 1;
+}
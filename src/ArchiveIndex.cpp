@@ -0,0 +1,574 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#include <cctype>
+#include <algorithm>
+#include <filesystem>
+
+#include "ArchiveIndex.hpp"
+#include "Error.hpp"
+#include "Hash.hpp"
+#include "Json.hpp"
+
+
+namespace mswmm {
+
+namespace fs = std::filesystem;
+
+// "MSWMMAI" and a format version.
+static constexpr uint64_t magic = 0x01'49'41'4D'4D'57'53'4DULL;
+static constexpr size_t headerSize = 48;
+static constexpr size_t projectSize = 40;
+static constexpr size_t mediaSize = 32;
+static constexpr size_t referenceSize = 4;
+
+
+
+/**
+ * @brief Bring a path of a media file into the form the archive index
+ * uses, so that all spellings of it that Windows accepts are equal:
+ * backslashes as separators, no repeated or trailing separators, and
+ * ASCII letters in lower case.
+ */
+std::string normalizeMediaPath(std::string_view path) {
+  std::string normalized;
+  normalized.reserve(path.size());
+  for (size_t i = 0; i < path.size(); ++i) {
+    char c = path[i] == '/' ? '\\' : path[i];
+    // The double backslash of UNC paths is kept.
+    if (c == '\\' && i > 1 && normalized.back() == '\\') {
+      continue;
+    }
+    normalized += static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  }
+  if (normalized.size() > 1 && normalized.back() == '\\') {
+    normalized.pop_back();
+  }
+  return normalized;
+}
+
+
+
+/**
+ * @param data The index. It is not copied and has to stay valid as
+ * long as the index and everything read from it is used.
+ * @param length The length of the buffer, at least that of the index.
+ */
+ArchiveIndex::ArchiveIndex(char const* data, size_t length) : data(data), length(length) {
+  BinaryReader header(data, length);
+  if (length < headerSize || header.u64() != magic) {
+    throw CorruptFileError("Not an archive index or unsupported version.");
+  }
+  uint32_t total = header.u32();
+  if (total < headerSize || total > length) {
+    throw CorruptFileError("Truncated archive index.");
+  }
+  this->length = total;
+
+  projects = array(16, projectSize);
+  media = array(24, mediaSize);
+  projectMediaList = array(32, referenceSize);
+  mediaProjectList = array(40, referenceSize);
+}
+
+
+
+ArchiveProject ArchiveIndex::project(size_t i) const {
+  BinaryReader r(record(projects, projectSize, i), projectSize);
+  ArchiveProject project;
+  project.path = string(r);
+  project.fileSize = r.u64();
+  project.fileTime = r.u64();
+  project.failed = r.u32() & 1;
+  project.firstMedia = r.u32();
+  project.mediaCount = r.u32();
+  if (project.firstMedia > projectMediaList.count || project.mediaCount > projectMediaList.count - project.firstMedia) {
+    throw CorruptFileError("Invalid project in archive index.");
+  }
+  return project;
+}
+
+
+
+ArchiveMedia ArchiveIndex::mediaFile(size_t i) const {
+  BinaryReader r(record(media, mediaSize, i), mediaSize);
+  ArchiveMedia mediaFile;
+  mediaFile.path = string(r);
+  mediaFile.originalPath = string(r);
+  mediaFile.fileSizeKiB = r.u64();
+  mediaFile.firstProject = r.u32();
+  mediaFile.projectCount = r.u32();
+  if (mediaFile.firstProject > mediaProjectList.count
+      || mediaFile.projectCount > mediaProjectList.count - mediaFile.firstProject) {
+    throw CorruptFileError("Invalid media file in archive index.");
+  }
+  return mediaFile;
+}
+
+
+
+/**
+ * @brief Get a media file used by a project.
+ *
+ * @param i Smaller than project.mediaCount.
+ * @return uint32_t The index of the media file, see mediaFile().
+ */
+uint32_t ArchiveIndex::projectMedia(ArchiveProject const& project, size_t i) const {
+  return reference(projectMediaList, size_t(project.firstMedia) + i, media.count);
+}
+
+
+
+/**
+ * @brief Get a project using a media file.
+ *
+ * @param i Smaller than mediaFile.projectCount.
+ * @return uint32_t The index of the project, see project().
+ */
+uint32_t ArchiveIndex::mediaProject(ArchiveMedia const& mediaFile, size_t i) const {
+  return reference(mediaProjectList, size_t(mediaFile.firstProject) + i, projects.count);
+}
+
+
+
+/**
+ * @brief Find a project by its path. Projects are stored by their
+ * absolute path, so a relative one is taken from the current
+ * directory.
+ */
+std::optional<uint32_t> ArchiveIndex::findProject(std::string_view path) const {
+  return find(projects, projectSize, absolutePath(std::string(path)));
+}
+
+
+
+/**
+ * @brief Find a media file by its path, in any spelling.
+ */
+std::optional<uint32_t> ArchiveIndex::findMedia(std::string_view path) const {
+  return find(media, mediaSize, normalizeMediaPath(path));
+}
+
+
+
+/**
+ * @brief Read the count and offset of an array from the header, and
+ * check that the array lies within the index.
+ */
+ArchiveIndex::Array ArchiveIndex::array(size_t offset, size_t recordSize) const {
+  BinaryReader r(data + offset, length - offset);
+  Array a;
+  a.count = r.u32();
+  a.offset = r.u32();
+  if (a.offset > length || a.count > (length - a.offset) / recordSize) {
+    throw CorruptFileError("Invalid array in archive index.");
+  }
+  return a;
+}
+
+
+
+char const* ArchiveIndex::record(Array const& array, size_t recordSize, size_t i) const {
+  if (i >= array.count) {
+    throw CorruptFileError("Index out of range in archive index.");
+  }
+  return data + array.offset + i * recordSize;
+}
+
+
+
+uint32_t ArchiveIndex::reference(Array const& array, size_t i, size_t limit) const {
+  BinaryReader r(record(array, referenceSize, i), referenceSize);
+  uint32_t value = r.u32();
+  if (value >= limit) {
+    throw CorruptFileError("Invalid reference in archive index.");
+  }
+  return value;
+}
+
+
+
+/**
+ * @brief Read a string reference and check that the string lies
+ * within the index and is zero terminated.
+ */
+std::string_view ArchiveIndex::string(BinaryReader& reader) const {
+  uint32_t offset = reader.u32();
+  uint32_t stringLength = reader.u32();
+  if (offset >= length || stringLength >= length - offset || data[offset + stringLength] != '\0') {
+    throw CorruptFileError("Invalid string in archive index.");
+  }
+  return std::string_view(data + offset, stringLength);
+}
+
+
+
+/**
+ * @brief The path a project or media record starts with.
+ */
+std::string_view ArchiveIndex::key(Array const& array, size_t recordSize, size_t i) const {
+  BinaryReader r(record(array, recordSize, i), recordSize);
+  return string(r);
+}
+
+
+
+std::optional<uint32_t> ArchiveIndex::find(Array const& array, size_t recordSize, std::string_view path) const {
+  size_t low = 0;
+  size_t high = array.count;
+  while (low < high) {
+    size_t middle = low + (high - low) / 2;
+    if (key(array, recordSize, middle) < path) {
+      low = middle + 1;
+    }
+    else {
+      high = middle;
+    }
+  }
+  if (low < array.count && key(array, recordSize, low) == path) {
+    return low;
+  }
+  return std::nullopt;
+}
+
+
+
+/**
+ * @param previous The index to update; may be null to start anew. It
+ * is copied, so it may be closed afterwards, e.g. before the new
+ * index replaces it.
+ */
+ArchiveIndexBuilder::ArchiveIndexBuilder(ArchiveIndex const* previous) {
+  if (!previous) {
+    return;
+  }
+  for (size_t i = 0; i < previous->projectCount(); ++i) {
+    ArchiveProject project = previous->project(i);
+    ProjectEntry& entry = projects[std::string(project.path)];
+    entry.fileSize = project.fileSize;
+    entry.fileTime = project.fileTime;
+    entry.failed = project.failed;
+    for (size_t k = 0; k < project.mediaCount; ++k) {
+      ArchiveMedia mediaFile = previous->mediaFile(previous->projectMedia(project, k));
+      entry.media.push_back(intern(mediaFile.originalPath, mediaFile.fileSizeKiB));
+    }
+  }
+}
+
+
+
+/**
+ * @brief Bring the index up to date with the project files of the
+ * archive.
+ *
+ * @param files All project files of the archive. Projects in the
+ * index that are not among them are removed. They are keyed by their
+ * absolute path, so the same file given differently, e.g. relative
+ * to another directory, is still found.
+ * @return std::vector<std::string> The absolute paths of the files
+ * that are new or changed since they were indexed, by size or
+ * modification time. Pass them to addProject() or addFailure().
+ */
+std::vector<std::string> ArchiveIndexBuilder::update(std::vector<std::string> const& files) {
+  std::lock_guard<std::mutex> lock(mutex);
+  std::map<std::string, ProjectEntry> kept;
+  std::vector<std::string> changed;
+  for (auto const& file: files) {
+    std::string path = absolutePath(file);
+    std::error_code error;
+    uint64_t fileSize = fs::file_size(path, error);
+    uint64_t fileTime = error ? 0 : fs::last_write_time(path, error).time_since_epoch().count();
+    auto it = projects.find(path);
+    if (!error && it != projects.end() && it->second.fileSize == fileSize && it->second.fileTime == fileTime) {
+      kept.insert(projects.extract(it));
+      continue;
+    }
+    // The size and time from before loading; if the file changes in
+    // the meantime, it is just loaded again next time.
+    ProjectEntry& entry = kept[path];
+    entry.fileSize = fileSize;
+    entry.fileTime = fileTime;
+    changed.push_back(path);
+  }
+  projects = std::move(kept);
+  return changed;
+}
+
+
+
+/**
+ * @brief Set the media files a project uses: its source files and
+ * the files of its timeline items.
+ *
+ * @param path The path of the project file, e.g. as returned by
+ * update().
+ * @param project The loaded project. Throws whatever extracting its
+ * sections throws.
+ */
+void ArchiveIndexBuilder::addProject(std::string const& path, Project const& project) {
+  // The sizes of the files are only stored with the timeline items.
+  std::vector<std::pair<std::string_view, uint64_t>> files;
+  for (Timeline const* timeline: {&project.videoTimeline(), &project.audioTimeline()}) {
+    for (auto const& item: *timeline) {
+      if (item.hasSource()) {
+        files.emplace_back(timeline->srcPath(item), item.fileSizeKiB);
+      }
+    }
+  }
+  for (auto const& file: project.sourceFiles()) {
+    files.emplace_back(file, 0);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  ProjectEntry& indexed = entry(path);
+  indexed.failed = false;
+  indexed.media.clear();
+  for (auto const& [file, fileSizeKiB]: files) {
+    indexed.media.push_back(intern(file, fileSizeKiB));
+  }
+  std::sort(indexed.media.begin(), indexed.media.end());
+  indexed.media.erase(std::unique(indexed.media.begin(), indexed.media.end()), indexed.media.end());
+}
+
+
+
+/**
+ * @brief Record that a project could not be loaded. It is tried again
+ * once it changes.
+ */
+void ArchiveIndexBuilder::addFailure(std::string const& path) {
+  std::lock_guard<std::mutex> lock(mutex);
+  ProjectEntry& project = entry(path);
+  project.failed = true;
+  project.media.clear();
+}
+
+
+
+size_t ArchiveIndexBuilder::projectCount() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return projects.size();
+}
+
+
+
+/**
+ * @brief Get the entry of a project, adding it with the current size
+ * and time of the file if update() didn't.
+ */
+ArchiveIndexBuilder::ProjectEntry& ArchiveIndexBuilder::entry(std::string const& file) {
+  std::string path = absolutePath(file);
+  auto [it, inserted] = projects.try_emplace(path);
+  if (inserted) {
+    std::error_code error;
+    it->second.fileSize = fs::file_size(path, error);
+    if (!error) {
+      it->second.fileTime = fs::last_write_time(path, error).time_since_epoch().count();
+    }
+  }
+  return it->second;
+}
+
+
+
+uint32_t ArchiveIndexBuilder::intern(std::string_view originalPath, uint64_t fileSizeKiB) {
+  std::string path = normalizeMediaPath(originalPath);
+  auto [it, inserted] = mediaIds.try_emplace(path, media.size());
+  if (inserted) {
+    media.push_back({std::move(path), std::string(originalPath), fileSizeKiB});
+  }
+  else if (media[it->second].fileSizeKiB == 0) {
+    media[it->second].fileSizeKiB = fileSizeKiB;
+  }
+  return it->second;
+}
+
+
+
+/**
+ * @brief Write the index, see ArchiveIndex for the layout. Media files
+ * that no project uses anymore are left out.
+ */
+std::string ArchiveIndexBuilder::write() const {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  // Number the media files in use by their path, and count the
+  // projects using each.
+  std::vector<uint32_t> used;
+  std::vector<uint32_t> users(media.size(), 0);
+  size_t referenceCount = 0;
+  for (auto const& [path, project]: projects) {
+    for (uint32_t id: project.media) {
+      if (users[id]++ == 0) {
+        used.push_back(id);
+      }
+    }
+    referenceCount += project.media.size();
+  }
+  std::sort(used.begin(), used.end(), [this](uint32_t a, uint32_t b) { return media[a].path < media[b].path; });
+  std::vector<uint32_t> number(media.size(), 0);
+  std::vector<uint32_t> firstProject(media.size(), 0);
+  uint32_t first = 0;
+  for (uint32_t i = 0; i < used.size(); ++i) {
+    number[used[i]] = i;
+    firstProject[used[i]] = first;
+    first += users[used[i]];
+  }
+
+  size_t projectsOffset = headerSize;
+  size_t mediaOffset = projectsOffset + projects.size() * projectSize;
+  size_t projectMediaOffset = mediaOffset + used.size() * mediaSize;
+  size_t mediaProjectsOffset = projectMediaOffset + referenceCount * referenceSize;
+  size_t stringsOffset = mediaProjectsOffset + referenceCount * referenceSize;
+
+  std::string index;
+  index.reserve(stringsOffset);
+  BinaryWriter writer(index);
+  std::string strings;
+  auto writeString = [&](std::string_view str) {
+    writer.u32(stringsOffset + strings.size());
+    writer.u32(str.size());
+    strings += str;
+    strings += '\0';
+  };
+
+  writer.u64(magic);
+  // The total length is filled in at the end.
+  writer.u32(0);
+  writer.u32(0);
+  writer.u32(projects.size());
+  writer.u32(projectsOffset);
+  writer.u32(used.size());
+  writer.u32(mediaOffset);
+  writer.u32(referenceCount);
+  writer.u32(projectMediaOffset);
+  writer.u32(referenceCount);
+  writer.u32(mediaProjectsOffset);
+
+  uint32_t firstMedia = 0;
+  for (auto const& [path, project]: projects) {
+    writeString(path);
+    writer.u64(project.fileSize);
+    writer.u64(project.fileTime);
+    writer.u32(project.failed ? 1 : 0);
+    writer.u32(firstMedia);
+    writer.u32(project.media.size());
+    writer.u32(0);
+    firstMedia += project.media.size();
+  }
+
+  for (uint32_t id: used) {
+    writeString(media[id].path);
+    writeString(media[id].originalPath);
+    writer.u64(media[id].fileSizeKiB);
+    writer.u32(firstProject[id]);
+    writer.u32(users[id]);
+  }
+
+  // Projects are written in order, so the projects of each media file
+  // come out sorted.
+  std::vector<uint32_t> mediaProjects(referenceCount);
+  uint32_t projectNumber = 0;
+  for (auto const& [path, project]: projects) {
+    std::vector<uint32_t> numbers;
+    for (uint32_t id: project.media) {
+      numbers.push_back(number[id]);
+      mediaProjects[firstProject[id]++] = projectNumber;
+    }
+    std::sort(numbers.begin(), numbers.end());
+    for (uint32_t n: numbers) {
+      writer.u32(n);
+    }
+    ++projectNumber;
+  }
+  for (uint32_t n: mediaProjects) {
+    writer.u32(n);
+  }
+
+  index += strings;
+  uint32_t length = index.size();
+  for (int i = 0; i < 4; ++i) {
+    index[8 + i] = static_cast<char>(length >> (8*i));
+  }
+  return index;
+}
+
+
+
+/**
+ * @brief Load a project into an archive index and report it as a
+ * single line of JSON. Suitable as a BatchJob.
+ *
+ * @param path Path to the .MSWMM file.
+ * @param builder The index to add the project to.
+ * @param options Options for loading the project.
+ * @param failed Set to whether the project could not be loaded. It is
+ * recorded in the index as well.
+ * @return std::string A JSON object, terminated by a newline.
+ */
+std::string indexProject(std::string const& path, ArchiveIndexBuilder& builder,
+                         LoadOptions const& options, bool& failed)
+{
+  std::string json = "{\"path\":";
+  appendJsonString(json, path);
+
+  try {
+    Project project(path, options);
+    builder.addProject(path, project);
+    json += ",\"indexed\":true";
+    failed = false;
+  }
+  catch (std::exception const& e) {
+    builder.addFailure(path);
+    appendJsonField(json, "error", e.what());
+    failed = true;
+  }
+
+  json += "}\n";
+  return json;
+}
+
+
+
+/**
+ * @brief Find the media files of an archive that don't exist anymore.
+ *
+ * @param index The archive index.
+ * @param mediaRoot If not null, media files are looked for below it,
+ * see MediaIndex::resolve(). Otherwise they have to exist at their
+ * original path.
+ * @return std::vector<uint32_t> The indices of the missing media files.
+ */
+std::vector<uint32_t> findMissingMedia(ArchiveIndex const& index, MediaIndex const* mediaRoot) {
+  std::vector<uint32_t> missing;
+  for (uint32_t i = 0; i < index.mediaCount(); ++i) {
+    ArchiveMedia mediaFile = index.mediaFile(i);
+    bool found;
+    if (mediaRoot) {
+      found = mediaRoot->resolve(mediaFile.originalPath, nullptr, mediaFile.fileSizeKiB).match != MatchType::NONE;
+    }
+    else {
+      std::error_code error;
+      found = fs::exists(std::string(mediaFile.originalPath), error);
+    }
+    if (!found) {
+      missing.push_back(i);
+    }
+  }
+  return missing;
+}
+
+} // Namespace mswmm
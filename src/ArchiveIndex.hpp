@@ -0,0 +1,181 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#ifndef _MSWMM_ARCHIVEINDEX_HPP
+#define _MSWMM_ARCHIVEINDEX_HPP
+
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+
+#include "Binary.hpp"
+#include "Project.hpp"
+#include "MediaIndex.hpp"
+
+
+namespace mswmm {
+
+std::string normalizeMediaPath(std::string_view path);
+
+
+
+struct ArchiveProject {
+  std::string_view path;
+  uint64_t fileSize;
+  uint64_t fileTime;
+  // The project could not be loaded; it is tried again once it changes.
+  bool failed;
+  uint32_t firstMedia;
+  uint32_t mediaCount;
+};
+
+
+
+struct ArchiveMedia {
+  // Normalized, see normalizeMediaPath().
+  std::string_view path;
+  // As stored in the first project using it.
+  std::string_view originalPath;
+  uint64_t fileSizeKiB;
+  uint32_t firstProject;
+  uint32_t projectCount;
+};
+
+
+
+/**
+ * @brief Read-only view of an archive index written by
+ * ArchiveIndexBuilder: which media files all projects of an archive
+ * use, and which projects use a media file.
+ *
+ * Like a Snapshot, the index is used in place, typically from a
+ * MappedFile, so opening it costs nothing and a query only touches
+ * the records it needs. Projects and media files are sorted by path
+ * and found by binary search. Media paths are normalized, so the
+ * different spellings Windows allows for a path are the same file.
+ *
+ * Layout, little endian, with offsets relative to the start of the
+ * index and strings as (u32 offset, u32 length), zero terminated:
+ * - Header, 48 bytes: u64 magic, u32 total length, u32 flags (none
+ *   yet), then (u32 count, u32 offset) of the projects, the media
+ *   files, the media of each project and the projects of each media
+ *   file.
+ * - Project, 40 bytes: its path, u64 file size, u64 modification
+ *   time, u32 flags (bit 0: failed to load), u32 first and u32 count
+ *   of its entries in the project media list.
+ * - Media file, 32 bytes: normalized and original path, u64 size in
+ *   KiB, u32 first and u32 count of its entries in the media project
+ *   list.
+ * - Project media and media projects, 4 bytes each: u32 index of a
+ *   media file or of a project.
+ * - Strings.
+ *
+ * Malformed indexes make the accessors throw a CorruptFileError.
+ */
+class ArchiveIndex {
+  public:
+    ArchiveIndex(char const* data, size_t length);
+
+    size_t projectCount() const { return projects.count; }
+    ArchiveProject project(size_t i) const;
+    size_t mediaCount() const { return media.count; }
+    ArchiveMedia mediaFile(size_t i) const;
+    uint32_t projectMedia(ArchiveProject const& project, size_t i) const;
+    uint32_t mediaProject(ArchiveMedia const& mediaFile, size_t i) const;
+    std::optional<uint32_t> findProject(std::string_view path) const;
+    std::optional<uint32_t> findMedia(std::string_view path) const;
+
+  private:
+    struct Array {
+      uint32_t count;
+      uint32_t offset;
+    };
+
+    Array array(size_t offset, size_t recordSize) const;
+    char const* record(Array const& array, size_t recordSize, size_t i) const;
+    uint32_t reference(Array const& array, size_t i, size_t limit) const;
+    std::string_view string(BinaryReader& reader) const;
+    std::string_view key(Array const& array, size_t recordSize, size_t i) const;
+    std::optional<uint32_t> find(Array const& array, size_t recordSize, std::string_view path) const;
+
+    char const* data;
+    size_t length;
+    Array projects;
+    Array media;
+    Array projectMediaList;
+    Array mediaProjectList;
+};
+
+
+
+/**
+ * @brief Builds an archive index, incrementally from a previous one.
+ *
+ * update() compares the project files of the archive with those in
+ * the index by size and modification time. Only the new and changed
+ * ones have to be loaded and passed to addProject(), which may be
+ * called from several threads at once, e.g. by the jobs of a batch
+ * run. Projects that are gone are dropped, and so are media files no
+ * project uses anymore.
+ */
+class ArchiveIndexBuilder {
+  public:
+    explicit ArchiveIndexBuilder(ArchiveIndex const* previous = nullptr);
+
+    std::vector<std::string> update(std::vector<std::string> const& files);
+    void addProject(std::string const& path, Project const& project);
+    void addFailure(std::string const& path);
+    size_t projectCount() const;
+    std::string write() const;
+
+  private:
+    struct ProjectEntry {
+      uint64_t fileSize = 0;
+      uint64_t fileTime = 0;
+      bool failed = false;
+      std::vector<uint32_t> media;
+    };
+
+    struct MediaEntry {
+      std::string path;
+      std::string originalPath;
+      uint64_t fileSizeKiB;
+    };
+
+    ProjectEntry& entry(std::string const& file);
+    uint32_t intern(std::string_view originalPath, uint64_t fileSizeKiB);
+
+    mutable std::mutex mutex;
+    // Sorted by path, as the index is.
+    std::map<std::string, ProjectEntry> projects;
+    std::vector<MediaEntry> media;
+    std::unordered_map<std::string, uint32_t> mediaIds;
+};
+
+
+
+std::string indexProject(std::string const& path, ArchiveIndexBuilder& builder,
+                         LoadOptions const& options, bool& failed);
+std::vector<uint32_t> findMissingMedia(ArchiveIndex const& index, MediaIndex const* mediaRoot);
+
+} // Namespace mswmm
+
+#endif
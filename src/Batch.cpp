@@ -0,0 +1,255 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#include <map>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <fstream>
+#include <optional>
+#include <algorithm>
+#include <filesystem>
+#include <memory_resource>
+
+#include "Batch.hpp"
+#include "Json.hpp"
+
+
+namespace mswmm {
+
+// Initial size of the arena of every batch worker. Bigger projects
+// make the arena grow, which is fine.
+static constexpr size_t arenaSize = 4 * 1024 * 1024;
+
+
+
+/**
+ * @brief Load a project and summarize it as a single line of JSON.
+ *
+ * @param path Path to the .MSWMM file.
+ * @param options Options for loading the project.
+ * @param failed Set to whether the project could not be loaded.
+ * @return std::string A JSON object, terminated by a newline. If the
+ * file can't be loaded, the object contains the error message.
+ */
+static std::string analyzeFile(std::string const& path, LoadOptions const& options, bool& failed) {
+  std::string json = "{\"path\":";
+  appendJsonString(json, path);
+
+  try {
+    Project project(path, options);
+
+    Metadata const& metadata = project.metadata();
+    json += ",\"aspectRatio\":[" + std::to_string(metadata.aspectRatio.x) +
+            "," + std::to_string(metadata.aspectRatio.y) + "]";
+    appendJsonField(json, "author", metadata.author);
+    appendJsonField(json, "title", metadata.title);
+    appendJsonField(json, "description", metadata.description);
+    appendJsonField(json, "copyright", metadata.copyright);
+    appendJsonField(json, "rating", metadata.rating);
+
+    json += ",\"files\":[";
+    for (size_t i = 0; i < project.sourceFiles().size(); ++i) {
+      if (i != 0) {
+        json += ',';
+      }
+      appendJsonString(json, project.sourceFiles()[i]);
+    }
+    json += ']';
+
+    float duration = 0;
+    for (auto const& ti: project.videoTimeline()) {
+      duration = std::max(duration, ti.timelineEnd);
+    }
+    for (auto const& ti: project.audioTimeline()) {
+      duration = std::max(duration, ti.timelineEnd);
+    }
+    json += ",\"videoItems\":" + std::to_string(project.videoTimeline().size());
+    json += ",\"audioItems\":" + std::to_string(project.audioTimeline().size());
+    json += ",\"hasTitleSequences\":";
+    json += project.hasTitleSequences() ? "true" : "false";
+    json += ",\"duration\":";
+    appendJsonNumber(json, duration);
+    failed = false;
+  }
+  catch (std::exception const& e) {
+    appendJsonField(json, "error", e.what());
+    failed = true;
+  }
+
+  json += "}\n";
+  return json;
+}
+
+
+
+/**
+ * @brief Get the project files to process in a batch run.
+ *
+ * @param path Either a directory, which is searched recursively for
+ * .MSWMM files, a single .MSWMM file, or a text file listing one
+ * project path per line.
+ * @return std::vector<std::string> The paths of the project files.
+ */
+std::vector<std::string> collectProjectFiles(std::string const& path) {
+  namespace fs = std::filesystem;
+  std::vector<std::string> files;
+
+  auto isProject = [](fs::path const& p) {
+    std::string ext = p.extension().string();
+    std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+    return ext == ".mswmm";
+  };
+
+  if (fs::is_directory(path)) {
+    auto options = fs::directory_options::skip_permission_denied;
+    for (auto const& entry: fs::recursive_directory_iterator(path, options)) {
+      if (entry.is_regular_file() && isProject(entry.path())) {
+        files.push_back(entry.path().string());
+      }
+    }
+    // Directory iteration order is arbitrary; make output reproducible.
+    std::sort(files.begin(), files.end());
+  }
+  else if (isProject(path)) {
+    files.push_back(path);
+  }
+  else {
+    std::ifstream list(path);
+    if (!list.good()) {
+      throw std::runtime_error("Can't open file list '" + path + "'.");
+    }
+    std::string line;
+    while (std::getline(list, line)) {
+      if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+      }
+      if (!line.empty()) {
+        files.push_back(line);
+      }
+    }
+  }
+  return files;
+}
+
+
+
+/**
+ * @brief Load many projects in parallel and write one JSON object
+ * per project and line. Errors of single files are reported in their
+ * JSON object and don't stop the run.
+ *
+ * @param files Paths of the project files.
+ * @param options Number of threads, output order and load options.
+ * @param target Stream the JSON lines are written to.
+ * @return size_t The number of files that could not be loaded.
+ */
+size_t runBatch(std::vector<std::string> const& files, BatchOptions const& options, std::ostream& target) {
+  return runBatch(files, options, target, analyzeFile);
+}
+
+
+
+/**
+ * @brief Run a job on many projects in parallel and write the results
+ * in input order or as they are ready.
+ *
+ * @param files Paths of the project files.
+ * @param options Number of threads, output order, load options and
+ * the trace file.
+ * @param target Stream the results are written to.
+ * @param job What to do with every file. It is called from several
+ * threads at once.
+ * @return size_t The number of files the job failed on.
+ */
+size_t runBatch(std::vector<std::string> const& files, BatchOptions const& options, std::ostream& target, BatchJob const& job) {
+  // Fail before the work is done if the trace can't be written.
+  std::ofstream traceFile;
+  std::optional<TraceWriter> trace;
+  if (!options.traceFile.empty()) {
+    traceFile.open(options.traceFile, std::ios_base::out | std::ios_base::binary);
+    if (!traceFile.good()) {
+      throw std::runtime_error("Can't open trace file '" + options.traceFile + "'.");
+    }
+    trace.emplace();
+  }
+
+  unsigned int threadCount = options.threads;
+  if (threadCount == 0) {
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  }
+  threadCount = std::min<size_t>(threadCount, files.size());
+
+  std::atomic<size_t> nextFile = 0;
+  std::atomic<size_t> failures = 0;
+  std::mutex outputMutex;
+  // Results that are done, but wait for earlier ones in ordered mode.
+  std::map<size_t, std::string> pending;
+  size_t nextToWrite = 0;
+
+  auto work = [&]() {
+    // Every worker loads its projects into its own arena, which is
+    // reset after each file, so loading mostly doesn't need malloc.
+    std::vector<char> arenaBuffer(arenaSize);
+    std::pmr::monotonic_buffer_resource arena(arenaBuffer.data(), arenaBuffer.size());
+    LoadOptions loadOptions = options.loadOptions;
+    loadOptions.memoryResource = &arena;
+    if (trace) {
+      loadOptions.collectStats = true;
+      loadOptions.statsCallback = [&](LoadStats const& stats) { trace->add(stats); };
+    }
+
+    while (true) {
+      size_t i = nextFile++;
+      if (i >= files.size()) {
+        break;
+      }
+      bool failed;
+      std::string result = job(files[i], loadOptions, failed);
+      arena.release();
+      if (failed) {
+        ++failures;
+      }
+
+      std::lock_guard<std::mutex> lock(outputMutex);
+      if (!options.ordered) {
+        target << result;
+        continue;
+      }
+      pending.emplace(i, std::move(result));
+      while (!pending.empty() && pending.begin()->first == nextToWrite) {
+        target << pending.begin()->second;
+        pending.erase(pending.begin());
+        ++nextToWrite;
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (unsigned int i = 0; i < threadCount; ++i) {
+    threads.emplace_back(work);
+  }
+  for (auto& t: threads) {
+    t.join();
+  }
+  target.flush();
+  if (trace) {
+    traceFile << trace->json();
+  }
+  return failures;
+}
+
+} // Namespace mswmm
@@ -0,0 +1,56 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#ifndef _MSWMM_BATCH_HPP
+#define _MSWMM_BATCH_HPP
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <functional>
+
+#include "Project.hpp"
+
+
+namespace mswmm {
+
+struct BatchOptions {
+  // Number of worker threads; 0 means one per hardware thread.
+  unsigned int threads = 0;
+  // Write results in the order of the input files. Otherwise they are
+  // written as soon as they are ready.
+  bool ordered = true;
+  LoadOptions loadOptions;
+  // If set, the loading stages of all projects are written to this
+  // file as a Chrome trace, see TraceWriter.
+  std::string traceFile;
+};
+
+
+
+// Processes one file of a batch run and returns its result, usually a
+// line of JSON. Sets the flag if the file could not be processed.
+using BatchJob = std::function<std::string(std::string const& path, LoadOptions const& options, bool& failed)>;
+
+
+
+std::vector<std::string> collectProjectFiles(std::string const& path);
+size_t runBatch(std::vector<std::string> const& files, BatchOptions const& options, std::ostream& target);
+size_t runBatch(std::vector<std::string> const& files, BatchOptions const& options, std::ostream& target, BatchJob const& job);
+
+} // Namespace mswmm
+
+#endif
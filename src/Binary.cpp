@@ -0,0 +1,86 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#include "Binary.hpp"
+
+
+namespace mswmm {
+
+void BinaryWriter::f32(float value) {
+  uint32_t bits;
+  std::memcpy(&bits, &value, sizeof(bits));
+  u32(bits);
+}
+
+
+
+void BinaryWriter::string(std::string_view value) {
+  u32(value.size());
+  target.append(value.data(), value.size());
+}
+
+
+
+void BinaryWriter::integer(uint64_t value, int bytes) {
+  for (int i = 0; i < bytes; ++i) {
+    target += static_cast<char>(value >> (8*i));
+  }
+}
+
+
+
+float BinaryReader::f32() {
+  uint32_t bits = u32();
+  float value;
+  std::memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+
+
+/**
+ * @brief Read a length prefixed string.
+ *
+ * @return std::string_view The string; it points into the buffer read from.
+ */
+std::string_view BinaryReader::string() {
+  size_t length = u32();
+  return std::string_view(take(length), length);
+}
+
+
+
+uint64_t BinaryReader::integer(int bytes) {
+  auto data = reinterpret_cast<unsigned char const*>(take(bytes));
+  uint64_t value = 0;
+  for (int i = 0; i < bytes; ++i) {
+    value |= static_cast<uint64_t>(data[i]) << (8*i);
+  }
+  return value;
+}
+
+
+
+char const* BinaryReader::take(size_t length) {
+  if (static_cast<size_t>(end - position) < length) {
+    throw CorruptFileError("Unexpected end of binary data.");
+  }
+  char const* data = position;
+  position += length;
+  return data;
+}
+
+} // Namespace mswmm
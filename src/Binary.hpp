@@ -0,0 +1,77 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#ifndef _MSWMM_BINARY_HPP
+#define _MSWMM_BINARY_HPP
+
+#include <string>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#include "Error.hpp"
+
+
+namespace mswmm {
+
+/**
+ * @brief Appends little endian integers, floats and length prefixed
+ * strings to a byte string.
+ */
+class BinaryWriter {
+  public:
+    explicit BinaryWriter(std::string& target) : target(target) {}
+
+    void u8(uint8_t value) { target += static_cast<char>(value); }
+    void u32(uint32_t value) { integer(value, 4); }
+    void u64(uint64_t value) { integer(value, 8); }
+    void f32(float value);
+    void string(std::string_view value);
+
+  private:
+    void integer(uint64_t value, int bytes);
+
+    std::string& target;
+};
+
+
+
+/**
+ * @brief Reads what a BinaryWriter wrote. Reading past the end throws
+ * a CorruptFileError.
+ */
+class BinaryReader {
+  public:
+    BinaryReader(char const* data, size_t length) : position(data), end(data + length) {}
+
+    uint8_t u8() { return static_cast<uint8_t>(integer(1)); }
+    uint32_t u32() { return static_cast<uint32_t>(integer(4)); }
+    uint64_t u64() { return integer(8); }
+    float f32();
+    std::string_view string();
+    bool atEnd() const { return position == end; }
+
+  private:
+    uint64_t integer(int bytes);
+    char const* take(size_t length);
+
+    char const* position;
+    char const* end;
+};
+
+} // Namespace mswmm
+
+#endif
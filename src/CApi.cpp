@@ -0,0 +1,306 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#include <new>
+#include <string>
+#include <exception>
+
+#include "mswmm.h"
+#include "Project.hpp"
+
+
+// The opaque handle of the C interface.
+struct mswmm_project {
+  template<typename... Args>
+  explicit mswmm_project(Args&&... args) : project(std::forward<Args>(args)...) {}
+
+  mswmm::Project project;
+};
+
+
+
+namespace {
+
+// Per thread, so threads reading the same project don't overwrite
+// each other's messages.
+thread_local std::string lastError;
+
+
+
+mswmm_status fail(mswmm_status status, char const* message) {
+  lastError = message;
+  return status;
+}
+
+
+
+/**
+ * @brief Run a function of the C interface, turning exceptions into
+ * status codes, as they must not cross into C.
+ */
+template<typename Function>
+mswmm_status guard(Function function) {
+  try {
+    function();
+    return MSWMM_OK;
+  }
+  catch (std::bad_alloc const&) {
+    return fail(MSWMM_ERROR_MEMORY, "Out of memory.");
+  }
+  catch (mswmm::CorruptFileError const& e) {
+    return fail(MSWMM_ERROR_CORRUPT, e.what());
+  }
+  catch (std::exception const& e) {
+    return fail(MSWMM_ERROR, e.what());
+  }
+  catch (...) {
+    return fail(MSWMM_ERROR, "Unknown error.");
+  }
+}
+
+
+
+mswmm_string view(std::string_view str) {
+  // Empty strings of the library may have no storage at all.
+  return {str.empty() ? "" : str.data(), str.size()};
+}
+
+
+
+mswmm::Timeline const* timeline(mswmm::Project const& project, mswmm_track track) {
+  switch (track) {
+    case MSWMM_TRACK_VIDEO:
+      return &project.videoTimeline();
+    case MSWMM_TRACK_AUDIO:
+      return &project.audioTimeline();
+    case MSWMM_TRACK_TITLE:
+      return &project.titleTimeline();
+  }
+  return nullptr;
+}
+
+
+
+/**
+ * @brief Look up an item, checking the track and the index.
+ */
+mswmm::TimelineItem const* item(mswmm::Timeline const*& items, mswmm_project const* project,
+                                mswmm_track track, size_t i)
+{
+  items = project ? timeline(project->project, track) : nullptr;
+  if (!items || i >= items->size()) {
+    return nullptr;
+  }
+  return &(*items)[i];
+}
+
+} // Namespace
+
+
+
+int mswmm_api_version(void) {
+  return MSWMM_API_VERSION;
+}
+
+
+
+/**
+ * @brief The message of the last error on this thread.
+ */
+char const* mswmm_last_error(void) {
+  return lastError.c_str();
+}
+
+
+
+/**
+ * @brief Open a project file. Free it with mswmm_free().
+ */
+mswmm_status mswmm_open_file(char const* path, mswmm_project** project) {
+  if (!path || !project) {
+    return fail(MSWMM_ERROR_ARGUMENT, "Null argument.");
+  }
+  *project = nullptr;
+  mswmm::LoadOptions options;
+  options.memoryMap = true;
+  return guard([&] { *project = new mswmm_project(std::string(path), options); });
+}
+
+
+
+/**
+ * @brief Open a project from the content of a file. The buffer is
+ * not needed anymore afterwards. Free the project with mswmm_free().
+ */
+mswmm_status mswmm_open_memory(void const* data, size_t length, mswmm_project** project) {
+  if (!data || !project) {
+    return fail(MSWMM_ERROR_ARGUMENT, "Null argument.");
+  }
+  *project = nullptr;
+  return guard([&] { *project = new mswmm_project(static_cast<char const*>(data), length); });
+}
+
+
+
+/**
+ * @brief Free a project and all strings read from it. Null is ignored.
+ */
+void mswmm_free(mswmm_project* project) {
+  delete project;
+}
+
+
+
+mswmm_status mswmm_get_metadata(mswmm_project const* project, mswmm_metadata* metadata) {
+  if (!project || !metadata) {
+    return fail(MSWMM_ERROR_ARGUMENT, "Null argument.");
+  }
+  return guard([&] {
+    mswmm::Metadata const& m = project->project.metadata();
+    metadata->aspect_ratio_x = m.aspectRatio.x;
+    metadata->aspect_ratio_y = m.aspectRatio.y;
+    metadata->author = view(m.author);
+    metadata->title = view(m.title);
+    metadata->description = view(m.description);
+    metadata->copyright = view(m.copyright);
+    metadata->rating = view(m.rating);
+  });
+}
+
+
+
+mswmm_status mswmm_source_file_count(mswmm_project const* project, size_t* count) {
+  if (!project || !count) {
+    return fail(MSWMM_ERROR_ARGUMENT, "Null argument.");
+  }
+  return guard([&] { *count = project->project.sourceFiles().size(); });
+}
+
+
+
+mswmm_status mswmm_get_source_file(mswmm_project const* project, size_t i, mswmm_string* path) {
+  if (!project || !path) {
+    return fail(MSWMM_ERROR_ARGUMENT, "Null argument.");
+  }
+  mswmm_status status = MSWMM_OK;
+  mswmm_status error = guard([&] {
+    auto const& files = project->project.sourceFiles();
+    if (i >= files.size()) {
+      status = fail(MSWMM_ERROR_ARGUMENT, "Source file index out of range.");
+      return;
+    }
+    *path = view(files[i]);
+  });
+  return error != MSWMM_OK ? error : status;
+}
+
+
+
+mswmm_status mswmm_item_count(mswmm_project const* project, mswmm_track track, size_t* count) {
+  if (!project || !count) {
+    return fail(MSWMM_ERROR_ARGUMENT, "Null argument.");
+  }
+  mswmm_status status = MSWMM_OK;
+  mswmm_status error = guard([&] {
+    mswmm::Timeline const* items = timeline(project->project, track);
+    if (!items) {
+      status = fail(MSWMM_ERROR_ARGUMENT, "Unknown track.");
+      return;
+    }
+    *count = items->size();
+  });
+  return error != MSWMM_OK ? error : status;
+}
+
+
+
+mswmm_status mswmm_get_item(mswmm_project const* project, mswmm_track track, size_t i, mswmm_item* item) {
+  if (!item) {
+    return fail(MSWMM_ERROR_ARGUMENT, "Null argument.");
+  }
+  mswmm_status status = MSWMM_OK;
+  mswmm_status error = guard([&] {
+    mswmm::Timeline const* items;
+    mswmm::TimelineItem const* ti = ::item(items, project, track, i);
+    if (!ti) {
+      status = fail(MSWMM_ERROR_ARGUMENT, "Invalid project, track or item index.");
+      return;
+    }
+    item->type = static_cast<uint32_t>(ti->type);
+    item->flags = (ti->isMuted ? MSWMM_ITEM_MUTED : 0) | (ti->fadesIn ? MSWMM_ITEM_FADES_IN : 0)
+                | (ti->fadesOut ? MSWMM_ITEM_FADES_OUT : 0);
+    item->timeline_start = ti->timelineStart;
+    item->timeline_end = ti->timelineEnd;
+    item->source_start = ti->sourceStart;
+    item->source_end = ti->sourceEnd;
+    item->volume = ti->volume;
+    item->width = ti->srcSizePx.x;
+    item->height = ti->srcSizePx.y;
+    item->file_size_kib = ti->fileSizeKiB;
+    item->name = view(items->name(*ti));
+    item->source_path = view(items->srcPath(*ti));
+    item->thumbnail = view(items->thumbnail(*ti));
+    item->link = view(items->link(*ti));
+    item->transition = view(items->transition(*ti));
+    item->effect_count = ti->effectCount;
+    item->parameter_count = ti->parameterCount;
+  });
+  return error != MSWMM_OK ? error : status;
+}
+
+
+
+mswmm_status mswmm_get_effect(mswmm_project const* project, mswmm_track track, size_t item,
+                              size_t i, mswmm_string* guid)
+{
+  if (!guid) {
+    return fail(MSWMM_ERROR_ARGUMENT, "Null argument.");
+  }
+  mswmm_status status = MSWMM_OK;
+  mswmm_status error = guard([&] {
+    mswmm::Timeline const* items;
+    mswmm::TimelineItem const* ti = ::item(items, project, track, item);
+    if (!ti || i >= ti->effectCount) {
+      status = fail(MSWMM_ERROR_ARGUMENT, "Invalid project, track, item or effect index.");
+      return;
+    }
+    *guid = view(items->effect(*ti, i));
+  });
+  return error != MSWMM_OK ? error : status;
+}
+
+
+
+mswmm_status mswmm_get_parameter(mswmm_project const* project, mswmm_track track, size_t item,
+                                 size_t i, mswmm_string* name, mswmm_string* value)
+{
+  if (!name || !value) {
+    return fail(MSWMM_ERROR_ARGUMENT, "Null argument.");
+  }
+  mswmm_status status = MSWMM_OK;
+  mswmm_status error = guard([&] {
+    mswmm::Timeline const* items;
+    mswmm::TimelineItem const* ti = ::item(items, project, track, item);
+    if (!ti || i >= ti->parameterCount) {
+      status = fail(MSWMM_ERROR_ARGUMENT, "Invalid project, track, item or parameter index.");
+      return;
+    }
+    auto [parameterName, parameterValue] = items->parameter(*ti, i);
+    *name = view(parameterName);
+    *value = view(parameterValue);
+  });
+  return error != MSWMM_OK ? error : status;
+}
@@ -0,0 +1,228 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#include <algorithm>
+#include <unordered_set>
+
+#include "CompoundFile.hpp"
+#include "Utf.hpp"
+
+
+namespace mswmm {
+
+// Entry IDs that don't point to another entry.
+static constexpr uint32_t NOSTREAM = 0xFFFFFFFF;
+// Upper bound for steps taken through one storage, so corrupt files
+// with cycles in the directory can't make a lookup hang.
+static constexpr unsigned int maxSteps = 1024;
+// Streams are copied in chunks of this size.
+static constexpr size_t chunkSize = 64 * 1024;
+
+
+
+/**
+ * @brief Convert a UTF-16 code unit to upper case the way CFB name
+ * comparisons do, for the Latin-1 range. Other characters are left
+ * untouched.
+ */
+static char16_t toUpper(char16_t c) {
+  if (c >= u'a' && c <= u'z') {
+    return c - (u'a' - u'A');
+  }
+  if (c >= 0xE0 && c <= 0xFE && c != 0xF7) {
+    return c - 0x20;
+  }
+  if (c == 0xFF) {
+    return 0x178;
+  }
+  return c;
+}
+
+
+
+/**
+ * @brief Compare the name of a directory entry to a name, using the
+ * ordering of the red-black tree in CFB containers.
+ *
+ * @return int Less than, equal to or greater than zero if the entry
+ * name is ordered before, equal to or after the given name.
+ */
+int compareEntryName(CFB::COMPOUND_FILE_ENTRY const* entry, std::u16string_view name) {
+  // The name length includes the zero termination and is in bytes.
+  size_t entryLength = entry->nameLen >= 2 ? entry->nameLen/2 - 1 : 0;
+  if (entryLength > 31) {
+    entryLength = 31;
+  }
+  if (entryLength != name.length()) {
+    return entryLength < name.length() ? -1 : 1;
+  }
+  for (size_t i = 0; i < entryLength; ++i) {
+    char16_t a = toUpper(static_cast<char16_t>(entry->name[i]));
+    char16_t b = toUpper(name[i]);
+    if (a != b) {
+      return a < b ? -1 : 1;
+    }
+  }
+  return 0;
+}
+
+
+
+/**
+ * @brief Find a direct child of a storage by name.
+ *
+ * @param reader The CFB container.
+ * @param storage The storage (or the root entry) to search.
+ * @param name The name of the child, compared case-insensitively.
+ * @return CFB::COMPOUND_FILE_ENTRY const* The child, or nullptr.
+ */
+CFB::COMPOUND_FILE_ENTRY const* findChild(CFB::CompoundFileReader const& reader,
+                                          CFB::COMPOUND_FILE_ENTRY const* storage,
+                                          std::u16string_view name)
+{
+  uint32_t id = storage->childID;
+  for (unsigned int i = 0; id != NOSTREAM && i < maxSteps; ++i) {
+    auto entry = reader.GetEntry(id);
+    if (!entry) {
+      return nullptr;
+    }
+    int cmp = compareEntryName(entry, name);
+    if (cmp == 0) {
+      return entry;
+    }
+    id = (cmp > 0) ? entry->leftSiblingID : entry->rightSiblingID;
+  }
+  return nullptr;
+}
+
+
+
+/**
+ * @brief Find a storage or stream by its path.
+ *
+ * @param reader The CFB container.
+ * @param path Backslash separated path, e.g. u"ProducerData\\Producer.Dat".
+ * @return CFB::COMPOUND_FILE_ENTRY const* The entry, or nullptr.
+ */
+CFB::COMPOUND_FILE_ENTRY const* findEntry(CFB::CompoundFileReader const& reader, std::u16string_view path) {
+  auto entry = reader.GetRootEntry();
+  while (entry && !path.empty()) {
+    size_t separator = path.find(u'\\');
+    entry = findChild(reader, entry, path.substr(0, separator));
+    if (separator == std::u16string_view::npos) {
+      break;
+    }
+    path.remove_prefix(separator + 1);
+  }
+  return entry;
+}
+
+
+
+/**
+ * @brief Find a stream by its path.
+ *
+ * @param reader The CFB container.
+ * @param path Backslash separated path, e.g. u"ProducerData\\Producer.Dat".
+ * @return CFB::COMPOUND_FILE_ENTRY const* The stream, or nullptr if
+ * there is no entry with that path or if it isn't a stream.
+ */
+CFB::COMPOUND_FILE_ENTRY const* findStream(CFB::CompoundFileReader const& reader, std::u16string_view path) {
+  auto entry = findEntry(reader, path);
+  if (entry && !reader.IsStream(entry)) {
+    return nullptr;
+  }
+  return entry;
+}
+
+
+
+/**
+ * @brief Get all direct children of a storage, in the order of the
+ * red-black tree, i.e. sorted by name length and then by name.
+ *
+ * @param reader The CFB container.
+ * @param storage The storage (or the root entry) to list.
+ * @return std::vector<CFB::COMPOUND_FILE_ENTRY const*> The children.
+ * Entries that are reachable more than once in corrupt files are only
+ * listed once.
+ */
+std::vector<CFB::COMPOUND_FILE_ENTRY const*> listChildren(CFB::CompoundFileReader const& reader,
+                                                          CFB::COMPOUND_FILE_ENTRY const* storage)
+{
+  std::vector<CFB::COMPOUND_FILE_ENTRY const*> children;
+  std::vector<CFB::COMPOUND_FILE_ENTRY const*> path;
+  std::unordered_set<uint32_t> visited;
+
+  // In-order traversal without recursion, so deep trees in corrupt
+  // files can't overflow the stack.
+  uint32_t id = storage->childID;
+  while (true) {
+    while (id != NOSTREAM && visited.insert(id).second) {
+      auto entry = reader.GetEntry(id);
+      if (!entry) {
+        break;
+      }
+      path.push_back(entry);
+      id = entry->leftSiblingID;
+    }
+    if (path.empty()) {
+      break;
+    }
+    auto entry = path.back();
+    path.pop_back();
+    children.push_back(entry);
+    id = entry->rightSiblingID;
+  }
+  return children;
+}
+
+
+
+/**
+ * @brief Get the name of a directory entry as UTF-8.
+ */
+std::string entryName(CFB::COMPOUND_FILE_ENTRY const* entry) {
+  size_t length = entry->nameLen >= 2 ? entry->nameLen/2 - 1 : 0;
+  if (length > 31) {
+    length = 31;
+  }
+  std::u16string name(entry->name, entry->name + length);
+  std::string result;
+  appendUtf8(result, name);
+  return result;
+}
+
+
+
+/**
+ * @brief Write the content of a stream to an output stream, one chunk
+ * at a time, so it never has to be in memory as a whole.
+ *
+ * @param reader The CFB container.
+ * @param stream The stream to copy.
+ * @param target Where to write the content to.
+ */
+void copyStream(CFB::CompoundFileReader const& reader, CFB::COMPOUND_FILE_ENTRY const* stream, std::ostream& target) {
+  std::vector<char> buffer(std::min<uint64_t>(stream->size, chunkSize));
+  for (uint64_t offset = 0; offset < stream->size; offset += buffer.size()) {
+    size_t length = std::min<uint64_t>(stream->size - offset, buffer.size());
+    reader.ReadFile(stream, offset, buffer.data(), length);
+    target.write(buffer.data(), length);
+  }
+}
+
+} // Namespace mswmm
@@ -0,0 +1,49 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#ifndef _MSWMM_COMPOUNDFILE_HPP
+#define _MSWMM_COMPOUNDFILE_HPP
+
+#include <string>
+#include <vector>
+#include <ostream>
+#include <string_view>
+
+#include "compoundfilereader.h"
+
+
+namespace mswmm {
+
+// Helpers for looking up entries in a CFB container by path. The
+// children of a storage form a red-black tree, ordered first by name
+// length and then by the upper case names, so a lookup only visits a
+// logarithmic number of entries, without any allocations or UTF-8
+// conversions.
+
+int compareEntryName(CFB::COMPOUND_FILE_ENTRY const* entry, std::u16string_view name);
+CFB::COMPOUND_FILE_ENTRY const* findChild(CFB::CompoundFileReader const& reader,
+                                          CFB::COMPOUND_FILE_ENTRY const* storage,
+                                          std::u16string_view name);
+CFB::COMPOUND_FILE_ENTRY const* findEntry(CFB::CompoundFileReader const& reader, std::u16string_view path);
+CFB::COMPOUND_FILE_ENTRY const* findStream(CFB::CompoundFileReader const& reader, std::u16string_view path);
+std::vector<CFB::COMPOUND_FILE_ENTRY const*> listChildren(CFB::CompoundFileReader const& reader,
+                                                          CFB::COMPOUND_FILE_ENTRY const* storage);
+std::string entryName(CFB::COMPOUND_FILE_ENTRY const* entry);
+void copyStream(CFB::CompoundFileReader const& reader, CFB::COMPOUND_FILE_ENTRY const* stream, std::ostream& target);
+
+} // Namespace mswmm
+
+#endif
@@ -0,0 +1,321 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#ifndef _MSWMM_EFFECTS_HPP
+#define _MSWMM_EFFECTS_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "StringTable.hpp"
+
+
+namespace mswmm {
+
+/**
+ * @brief The effects and transitions built into Movie Maker.
+ * The values are indices into effectRegistry.
+ */
+enum class EffectId : uint8_t {
+  NONE,
+  UNKNOWN,
+  // Effects
+  BLUR,
+  BRIGHTNESS_DECREASE,
+  BRIGHTNESS_INCREASE,
+  EASE_IN,
+  EASE_OUT,
+  FADE_IN_FROM_BLACK,
+  FADE_IN_FROM_WHITE,
+  FADE_OUT_TO_BLACK,
+  FADE_OUT_TO_WHITE,
+  FILM_AGE_OLD,
+  FILM_AGE_OLDER,
+  FILM_AGE_OLDEST,
+  FILM_GRAIN,
+  GRAYSCALE,
+  HUE_CYCLE,
+  MIRROR_HORIZONTAL,
+  MIRROR_VERTICAL,
+  PIXELATE,
+  POSTERIZE,
+  ROTATE_90,
+  ROTATE_180,
+  ROTATE_270,
+  SEPIA_TONE,
+  SLOW_DOWN_HALF,
+  SPEED_UP_DOUBLE,
+  THRESHOLD,
+  WARP,
+  WATERCOLOR,
+  // Transitions
+  BARS,
+  BARS_HORIZONTAL,
+  CHECKERBOARD,
+  CIRCLE,
+  DIAGONAL_BOX_OUT,
+  DIAGONAL_DOWN_RIGHT,
+  DIAMOND,
+  DISSOLVE_ROUGH,
+  EYE,
+  FADE,
+  FAN_IN,
+  FAN_OUT,
+  HEART,
+  IRIS,
+  KEYHOLE,
+  PIXELATE_TRANSITION,
+  RECTANGLE,
+  REVEAL_DOWN,
+  REVEAL_RIGHT,
+  ROLL,
+  SHATTER_IN,
+  SLIDE,
+  SLIDE_UP,
+  SPIRAL,
+  SPLIT_HORIZONTAL,
+  SPLIT_VERTICAL,
+  STAR,
+  SWEEP_IN,
+  SWEEP_OUT,
+  WHEEL,
+  WIPE_DOWN,
+  WIPE_RIGHT,
+  ZIG_ZAG_HORIZONTAL,
+  ZIG_ZAG_VERTICAL,
+  COUNT
+};
+
+
+
+/**
+ * @brief How an effect is rendered, which also tells what
+ * EffectInfo::filter contains.
+ */
+enum class EffectType : uint8_t {
+  // Not rendered; the filter is empty.
+  NONE,
+  // A filter chain applied to the whole item, e.g. "hflip".
+  FILTER,
+  // A fade from the color in the filter, at the start of the item.
+  FADE_IN,
+  // A fade to the color in the filter, at the end of the item.
+  FADE_OUT,
+  // The name of an xfade transition, empty if there is no similar one.
+  TRANSITION
+};
+
+
+
+struct EffectInfo {
+  EffectId id;
+  EffectType type;
+  // The TFXGuid in the project file; TFXEffectType tells effects and
+  // transitions of the same name apart.
+  std::string_view guid;
+  std::string_view filter;
+
+  constexpr bool isTransition() const { return type == EffectType::TRANSITION; }
+};
+
+
+
+/**
+ * @brief An effect applied to a timeline item, or the transition to it.
+ */
+struct Effect {
+  EffectId id;
+  // The TFXGuid of UNKNOWN effects, in the string table of the
+  // timeline. Known effects take it from the registry.
+  StringId guid;
+};
+
+
+
+/**
+ * @brief All built-in effects and transitions, indexed by EffectId.
+ *
+ * The GUIDs are those of Movie Maker 2 and 6, see the MSDN reference
+ * in file-format-notes.md. The filters only approximate most effects,
+ * and some have no counterpart in ffmpeg at all.
+ */
+inline constexpr std::array<EffectInfo, static_cast<size_t>(EffectId::COUNT)> effectRegistry = {{
+  {EffectId::NONE,                EffectType::NONE,       "", ""},
+  {EffectId::UNKNOWN,             EffectType::NONE,       "", ""},
+  {EffectId::BLUR,                EffectType::FILTER,     "TFX\\Blur", "boxblur=4"},
+  {EffectId::BRIGHTNESS_DECREASE, EffectType::FILTER,     "TFX\\Brightness, Decrease", "eq=brightness=-0.25"},
+  {EffectId::BRIGHTNESS_INCREASE, EffectType::FILTER,     "TFX\\Brightness, Increase", "eq=brightness=0.25"},
+  {EffectId::EASE_IN,             EffectType::NONE,       "TFX\\Ease In", ""},
+  {EffectId::EASE_OUT,            EffectType::NONE,       "TFX\\Ease Out", ""},
+  {EffectId::FADE_IN_FROM_BLACK,  EffectType::FADE_IN,    "TFX\\Fade In, From Black", "black"},
+  {EffectId::FADE_IN_FROM_WHITE,  EffectType::FADE_IN,    "TFX\\Fade In, From White", "white"},
+  {EffectId::FADE_OUT_TO_BLACK,   EffectType::FADE_OUT,   "TFX\\Fade Out, To Black", "black"},
+  {EffectId::FADE_OUT_TO_WHITE,   EffectType::FADE_OUT,   "TFX\\Fade Out, To White", "white"},
+  {EffectId::FILM_AGE_OLD,        EffectType::FILTER,     "TFX\\Film Age, Old", "hue=s=0.6,noise=alls=10:allf=t"},
+  {EffectId::FILM_AGE_OLDER,      EffectType::FILTER,     "TFX\\Film Age, Older", "hue=s=0.3,noise=alls=20:allf=t"},
+  {EffectId::FILM_AGE_OLDEST,     EffectType::FILTER,     "TFX\\Film Age, Oldest", "hue=s=0,noise=alls=30:allf=t"},
+  {EffectId::FILM_GRAIN,          EffectType::FILTER,     "TFX\\Film Grain", "noise=alls=20:allf=t"},
+  {EffectId::GRAYSCALE,           EffectType::FILTER,     "TFX\\Grayscale", "hue=s=0"},
+  {EffectId::HUE_CYCLE,           EffectType::FILTER,     "TFX\\Hue, Cycles Entire Color Spectrum", "hue=H=2*PI*t/5"},
+  {EffectId::MIRROR_HORIZONTAL,   EffectType::FILTER,     "TFX\\Mirror, Horizontal", "hflip"},
+  {EffectId::MIRROR_VERTICAL,     EffectType::FILTER,     "TFX\\Mirror, Vertical", "vflip"},
+  {EffectId::PIXELATE,            EffectType::FILTER,     "TFX\\Pixelate", "pixelize=w=16:h=16"},
+  {EffectId::POSTERIZE,           EffectType::FILTER,     "TFX\\Posterize", "elbg=codebook_length=16"},
+  {EffectId::ROTATE_90,           EffectType::FILTER,     "TFX\\Rotate 90", "transpose=1"},
+  {EffectId::ROTATE_180,          EffectType::FILTER,     "TFX\\Rotate 180", "hflip,vflip"},
+  {EffectId::ROTATE_270,          EffectType::FILTER,     "TFX\\Rotate 270", "transpose=2"},
+  {EffectId::SEPIA_TONE,          EffectType::FILTER,     "TFX\\Sepia Tone",
+                                  "colorchannelmixer=.393:.769:.189:0:.349:.686:.168:0:.272:.534:.131"},
+  // Movie Maker already stretches the item on the timeline.
+  {EffectId::SLOW_DOWN_HALF,      EffectType::NONE,       "TFX\\Slow Down, Half", ""},
+  {EffectId::SPEED_UP_DOUBLE,     EffectType::NONE,       "TFX\\Speed Up, Double", ""},
+  {EffectId::THRESHOLD,           EffectType::FILTER,     "TFX\\Threshold", "hue=s=0,lutyuv=y=if(gt(val\\,128)\\,235\\,16)"},
+  {EffectId::WARP,                EffectType::NONE,       "TFX\\Warp", ""},
+  {EffectId::WATERCOLOR,          EffectType::FILTER,     "TFX\\Watercolor", "smartblur=lr=3:ls=0.8"},
+  {EffectId::BARS,                EffectType::TRANSITION, "TFX\\Bars", "hlslice"},
+  {EffectId::BARS_HORIZONTAL,     EffectType::TRANSITION, "TFX\\Bars, Horizontal", "vuslice"},
+  {EffectId::CHECKERBOARD,        EffectType::TRANSITION, "TFX\\Checkerboard, Across", ""},
+  {EffectId::CIRCLE,              EffectType::TRANSITION, "TFX\\Circle", "circleopen"},
+  {EffectId::DIAGONAL_BOX_OUT,    EffectType::TRANSITION, "TFX\\Diagonal, Box Out", "rectcrop"},
+  {EffectId::DIAGONAL_DOWN_RIGHT, EffectType::TRANSITION, "TFX\\Diagonal, Down Right", "diagbr"},
+  {EffectId::DIAMOND,             EffectType::TRANSITION, "TFX\\Diamond", "rectcrop"},
+  {EffectId::DISSOLVE_ROUGH,      EffectType::TRANSITION, "TFX\\Dissolve, Rough", "dissolve"},
+  {EffectId::EYE,                 EffectType::TRANSITION, "TFX\\Eye", "horzopen"},
+  {EffectId::FADE,                EffectType::TRANSITION, "TFX\\Fade", "fade"},
+  {EffectId::FAN_IN,              EffectType::TRANSITION, "TFX\\Fan, In", "radial"},
+  {EffectId::FAN_OUT,             EffectType::TRANSITION, "TFX\\Fan, Out", "radial"},
+  {EffectId::HEART,               EffectType::TRANSITION, "TFX\\Heart", "circleopen"},
+  {EffectId::IRIS,                EffectType::TRANSITION, "TFX\\Iris", "circleopen"},
+  {EffectId::KEYHOLE,             EffectType::TRANSITION, "TFX\\Keyhole", "circleopen"},
+  {EffectId::PIXELATE_TRANSITION, EffectType::TRANSITION, "TFX\\Pixelate", "pixelize"},
+  {EffectId::RECTANGLE,           EffectType::TRANSITION, "TFX\\Rectangle", "rectcrop"},
+  {EffectId::REVEAL_DOWN,         EffectType::TRANSITION, "TFX\\Reveal, Down", "slidedown"},
+  {EffectId::REVEAL_RIGHT,        EffectType::TRANSITION, "TFX\\Reveal, Right", "slideright"},
+  {EffectId::ROLL,                EffectType::TRANSITION, "TFX\\Roll", "smoothleft"},
+  {EffectId::SHATTER_IN,          EffectType::TRANSITION, "TFX\\Shatter, In", ""},
+  {EffectId::SLIDE,               EffectType::TRANSITION, "TFX\\Slide", "slideleft"},
+  {EffectId::SLIDE_UP,            EffectType::TRANSITION, "TFX\\Slide, Up", "slideup"},
+  {EffectId::SPIRAL,              EffectType::TRANSITION, "TFX\\Spiral", ""},
+  {EffectId::SPLIT_HORIZONTAL,    EffectType::TRANSITION, "TFX\\Split, Horizontal", "horzopen"},
+  {EffectId::SPLIT_VERTICAL,      EffectType::TRANSITION, "TFX\\Split, Vertical", "vertopen"},
+  {EffectId::STAR,                EffectType::TRANSITION, "TFX\\Star", "circleopen"},
+  {EffectId::SWEEP_IN,            EffectType::TRANSITION, "TFX\\Sweep, In", "radial"},
+  {EffectId::SWEEP_OUT,           EffectType::TRANSITION, "TFX\\Sweep, Out", "radial"},
+  {EffectId::WHEEL,               EffectType::TRANSITION, "TFX\\Wheel, 4 Spokes", "radial"},
+  {EffectId::WIPE_DOWN,           EffectType::TRANSITION, "TFX\\Wipe, Normal Down", "wipedown"},
+  {EffectId::WIPE_RIGHT,          EffectType::TRANSITION, "TFX\\Wipe, Normal Right", "wiperight"},
+  {EffectId::ZIG_ZAG_HORIZONTAL,  EffectType::TRANSITION, "TFX\\Zig Zag, Horizontal", ""},
+  {EffectId::ZIG_ZAG_VERTICAL,    EffectType::TRANSITION, "TFX\\Zig Zag, Vertical", ""}
+}};
+
+
+
+constexpr EffectInfo const& effectInfo(EffectId id) {
+  return effectRegistry[static_cast<size_t>(id)];
+}
+
+
+
+namespace detail {
+
+// Transitions sort after effects, then by GUID.
+constexpr bool effectLess(EffectInfo const& a, bool transition, std::string_view guid) {
+  return a.isTransition() != transition ? !a.isTransition() : a.guid < guid;
+}
+
+
+
+/**
+ * @brief The known effects, sorted for binary search by findEffect().
+ * Built at compile time, so the registry can stay in EffectId order.
+ */
+constexpr std::array<EffectId, effectRegistry.size() - 2> sortEffects() {
+  std::array<EffectId, effectRegistry.size() - 2> sorted{};
+  for (size_t i = 0; i < sorted.size(); ++i) {
+    EffectInfo const& info = effectRegistry[i + 2];
+    size_t j = i;
+    for (; j > 0 && !effectLess(effectInfo(sorted[j-1]), info.isTransition(), info.guid); --j) {
+      sorted[j] = sorted[j-1];
+    }
+    sorted[j] = info.id;
+  }
+  return sorted;
+}
+
+inline constexpr auto effectsByGuid = sortEffects();
+
+
+
+constexpr bool isRegistryValid() {
+  for (size_t i = 0; i < effectRegistry.size(); ++i) {
+    if (effectRegistry[i].id != static_cast<EffectId>(i)) {
+      return false;
+    }
+  }
+  for (size_t i = 1; i < effectsByGuid.size(); ++i) {
+    EffectInfo const& info = effectInfo(effectsByGuid[i]);
+    if (!effectLess(effectInfo(effectsByGuid[i-1]), info.isTransition(), info.guid)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static_assert(isRegistryValid(), "Effect registry out of order or with duplicate GUIDs.");
+
+} // Namespace detail
+
+
+
+/**
+ * @brief Look up an effect or transition by its TFXGuid.
+ *
+ * @param guid The TFXGuid, e.g. "TFX\\Fade".
+ * @param transition If the TFXEffectType is 1.
+ * @return EffectId UNKNOWN if the GUID is not a built-in one.
+ */
+constexpr EffectId findEffect(std::string_view guid, bool transition) {
+  size_t first = 0;
+  size_t count = detail::effectsByGuid.size();
+  while (count > 0) {
+    size_t step = count / 2;
+    if (detail::effectLess(effectInfo(detail::effectsByGuid[first + step]), transition, guid)) {
+      first += step + 1;
+      count -= step + 1;
+    }
+    else {
+      count = step;
+    }
+  }
+  if (first < detail::effectsByGuid.size()) {
+    EffectInfo const& info = effectInfo(detail::effectsByGuid[first]);
+    if (info.isTransition() == transition && info.guid == guid) {
+      return info.id;
+    }
+  }
+  return EffectId::UNKNOWN;
+}
+
+static_assert(findEffect("TFX\\Fade", true) == EffectId::FADE);
+static_assert(findEffect("TFX\\Pixelate", false) == EffectId::PIXELATE);
+static_assert(findEffect("TFX\\Pixelate", true) == EffectId::PIXELATE_TRANSITION);
+static_assert(findEffect("TFX\\Fade", false) == EffectId::UNKNOWN);
+
+} // Namespace mswmm
+
+#endif
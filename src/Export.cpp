@@ -0,0 +1,171 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#include "Export.hpp"
+#include "Json.hpp"
+
+
+namespace mswmm {
+
+static char const* typeName(ItemType type) {
+  switch (type) {
+    case ItemType::TITLE: return "title";
+    case ItemType::STILL: return "still";
+    case ItemType::VIDEO: return "video";
+    case ItemType::AUDIO: return "audio";
+  }
+  return "";
+}
+
+
+
+static void appendNumberField(std::string& target, char const* key, float value) {
+  target += ",\"";
+  target += key;
+  target += "\":";
+  appendJsonNumber(target, value);
+}
+
+
+
+/**
+ * @brief Append the items of a timeline as a JSON array.
+ *
+ * Like Timeline::printItem(), every item only gets the fields that
+ * are meaningful for its type. Effects and the transition are given
+ * by their TFXGuid, the parameters of titles as [name, value] pairs
+ * in document order.
+ */
+void appendJson(std::string& target, Timeline const& timeline) {
+  target += '[';
+  bool first = true;
+  for (auto const& item: timeline) {
+    if (!first) {
+      target += ',';
+    }
+    first = false;
+
+    target += "{\"type\":\"";
+    target += typeName(item.type);
+    target += '"';
+    appendNumberField(target, "start", item.timelineStart);
+    appendNumberField(target, "end", item.timelineEnd);
+
+    if (item.hasSource()) {
+      appendJsonField(target, "name", timeline.name(item));
+      appendJsonField(target, "path", timeline.srcPath(item));
+      appendJsonField(target, "link", timeline.link(item));
+      target += ",\"fileSizeKiB\":";
+      appendJsonNumber(target, static_cast<uint64_t>(item.fileSizeKiB));
+    }
+    if (item.type == ItemType::STILL || item.type == ItemType::VIDEO) {
+      appendJsonField(target, "thumbnail", timeline.thumbnail(item));
+      target += ",\"size\":[";
+      appendJsonNumber(target, static_cast<uint64_t>(item.srcSizePx.x));
+      target += ',';
+      appendJsonNumber(target, static_cast<uint64_t>(item.srcSizePx.y));
+      target += ']';
+    }
+    if (item.type == ItemType::VIDEO || item.type == ItemType::AUDIO) {
+      appendNumberField(target, "sourceStart", item.sourceStart);
+      appendNumberField(target, "sourceEnd", item.sourceEnd);
+    }
+    if (item.type == ItemType::AUDIO) {
+      appendNumberField(target, "volume", item.volume);
+      target += ",\"muted\":";
+      target += item.isMuted ? "true" : "false";
+      target += ",\"fadesIn\":";
+      target += item.fadesIn ? "true" : "false";
+      target += ",\"fadesOut\":";
+      target += item.fadesOut ? "true" : "false";
+    }
+
+    if (item.transition.id != EffectId::NONE) {
+      appendJsonField(target, "transition", timeline.transition(item));
+    }
+    if (item.effectCount > 0) {
+      target += ",\"effects\":[";
+      for (size_t e = 0; e < item.effectCount; ++e) {
+        if (e != 0) {
+          target += ',';
+        }
+        appendJsonString(target, timeline.effect(item, e));
+      }
+      target += ']';
+    }
+    if (item.parameterCount > 0) {
+      target += ",\"parameters\":[";
+      for (size_t p = 0; p < item.parameterCount; ++p) {
+        auto [name, value] = timeline.parameter(item, p);
+        target += p == 0 ? "[" : ",[";
+        appendJsonString(target, name);
+        target += ',';
+        appendJsonString(target, value);
+        target += ']';
+      }
+      target += ']';
+    }
+    target += '}';
+  }
+  target += ']';
+}
+
+
+
+/**
+ * @brief Export the whole model of a project as one JSON object:
+ * metadata, source files and all timelines with their effects.
+ * This extracts all sections of the project.
+ *
+ * @return std::string The JSON object, without a trailing newline.
+ */
+std::string exportJson(Project const& project) {
+  std::string json;
+  // Most of the output are the timelines; this saves the first few
+  // reallocations.
+  json.reserve(256 * (1 + project.videoTimeline().size() + project.audioTimeline().size()));
+
+  Metadata const& metadata = project.metadata();
+  json += "{\"metadata\":{\"aspectRatio\":[";
+  appendJsonNumber(json, static_cast<uint64_t>(metadata.aspectRatio.x));
+  json += ',';
+  appendJsonNumber(json, static_cast<uint64_t>(metadata.aspectRatio.y));
+  json += ']';
+  appendJsonField(json, "author", metadata.author);
+  appendJsonField(json, "title", metadata.title);
+  appendJsonField(json, "description", metadata.description);
+  appendJsonField(json, "copyright", metadata.copyright);
+  appendJsonField(json, "rating", metadata.rating);
+  json += "},\"files\":[";
+  for (size_t i = 0; i < project.sourceFiles().size(); ++i) {
+    if (i != 0) {
+      json += ',';
+    }
+    appendJsonString(json, project.sourceFiles()[i]);
+  }
+  json += "],\"hasTitleSequences\":";
+  json += project.hasTitleSequences() ? "true" : "false";
+  json += ",\"timelines\":{\"video\":";
+  appendJson(json, project.videoTimeline());
+  json += ",\"audio\":";
+  appendJson(json, project.audioTimeline());
+  json += ",\"title\":";
+  appendJson(json, project.titleTimeline());
+  json += "}}";
+  return json;
+}
+
+} // Namespace mswmm
@@ -0,0 +1,32 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#ifndef _MSWMM_EXPORT_HPP
+#define _MSWMM_EXPORT_HPP
+
+#include <string>
+
+#include "Project.hpp"
+
+
+namespace mswmm {
+
+std::string exportJson(Project const& project);
+void appendJson(std::string& target, Timeline const& timeline);
+
+} // Namespace mswmm
+
+#endif
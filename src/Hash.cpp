@@ -0,0 +1,107 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+
+#include "Hash.hpp"
+
+
+namespace mswmm {
+
+/**
+ * @brief A fast, non-cryptographic 64 bit hash (MurmurHash64A).
+ *
+ * It processes eight bytes per step, so hashing a Producer.Dat takes
+ * a small fraction of the time parsing it does. Unaligned data is
+ * fine; the result is the same on all little endian machines.
+ *
+ * @param data The bytes to hash.
+ * @param length Number of bytes.
+ * @param seed Start value, to get independent hashes of the same data.
+ * @return uint64_t The hash.
+ */
+uint64_t hashBytes(void const* data, size_t length, uint64_t seed) {
+  constexpr uint64_t m = 0xc6a4a7935bd1e995ULL;
+  constexpr int r = 47;
+  auto bytes = static_cast<unsigned char const*>(data);
+  uint64_t h = seed ^ (length * m);
+
+  size_t blocks = length / 8;
+  for (size_t i = 0; i < blocks; ++i) {
+    uint64_t k;
+    std::memcpy(&k, bytes + i*8, 8);
+    k *= m;
+    k ^= k >> r;
+    k *= m;
+    h ^= k;
+    h *= m;
+  }
+
+  auto tail = bytes + blocks*8;
+  switch (length & 7) {
+    case 7: h ^= uint64_t(tail[6]) << 48; [[fallthrough]];
+    case 6: h ^= uint64_t(tail[5]) << 40; [[fallthrough]];
+    case 5: h ^= uint64_t(tail[4]) << 32; [[fallthrough]];
+    case 4: h ^= uint64_t(tail[3]) << 24; [[fallthrough]];
+    case 3: h ^= uint64_t(tail[2]) << 16; [[fallthrough]];
+    case 2: h ^= uint64_t(tail[1]) << 8; [[fallthrough]];
+    case 1: h ^= uint64_t(tail[0]);
+            h *= m;
+  }
+
+  h ^= h >> r;
+  h *= m;
+  h ^= h >> r;
+  return h;
+}
+
+
+
+/**
+ * @brief Get the absolute, lexically normal path of a file, so that
+ * the different ways to give the same path are one key.
+ *
+ * @param path Path to the file; it doesn't have to exist.
+ * @return std::string The absolute path, or the path as it is if the
+ * current directory can't be determined.
+ */
+std::string absolutePath(std::string const& path) {
+  std::error_code error;
+  return std::filesystem::absolute(path, error).lexically_normal().string();
+}
+
+
+
+/**
+ * @brief Hash the absolute path of a file, e.g. to name files that
+ * belong to it in another directory.
+ *
+ * @param path Path to the file; it doesn't have to exist.
+ * @return std::string The hash as 16 hexadecimal digits.
+ */
+std::string hashPath(std::string const& path) {
+  std::string key = absolutePath(path);
+  uint64_t hash = hashBytes(key.data(), key.size());
+  std::string hex(16, '0');
+  for (int i = 0; i < 16; ++i) {
+    hex[i] = "0123456789abcdef"[(hash >> (60 - 4*i)) & 0xf];
+  }
+  return hex;
+}
+
+} // Namespace mswmm
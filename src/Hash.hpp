@@ -0,0 +1,33 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#ifndef _MSWMM_HASH_HPP
+#define _MSWMM_HASH_HPP
+
+#include <string>
+#include <cstddef>
+#include <cstdint>
+
+
+namespace mswmm {
+
+uint64_t hashBytes(void const* data, size_t length, uint64_t seed = 0);
+std::string absolutePath(std::string const& path);
+std::string hashPath(std::string const& path);
+
+} // Namespace mswmm
+
+#endif
@@ -0,0 +1,108 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+#include "IntervalIndex.hpp"
+
+
+namespace mswmm {
+
+/**
+ * @brief Index the items of some tracks, replacing what was indexed
+ * before.
+ *
+ * @param tracks The timelines to index and their track types.
+ */
+void IntervalIndex::build(std::initializer_list<std::pair<TrackType, Timeline const*>> tracks) {
+  intervals.clear();
+  for (auto const& [track, timeline]: tracks) {
+    for (size_t i = 0; i < timeline->size(); ++i) {
+      TimelineItem const& item = (*timeline)[i];
+      intervals.push_back({item.timelineStart, item.timelineEnd, track, static_cast<uint32_t>(i)});
+    }
+  }
+  // Stable, so items starting at the same time stay in track order.
+  std::stable_sort(intervals.begin(), intervals.end(), [](Interval const& a, Interval const& b) {
+    return a.start < b.start;
+  });
+
+  // The node of the range [begin, end) is its middle; fill the
+  // subtrees bottom up.
+  maxEnds.assign(intervals.size(), 0);
+  auto fill = [this](auto& self, size_t begin, size_t end) -> float {
+    if (begin >= end) {
+      return -std::numeric_limits<float>::infinity();
+    }
+    size_t middle = begin + (end - begin) / 2;
+    float maxEnd = std::max({intervals[middle].end, self(self, begin, middle), self(self, middle + 1, end)});
+    maxEnds[middle] = maxEnd;
+    return maxEnd;
+  };
+  fill(fill, 0, intervals.size());
+}
+
+
+
+/**
+ * @brief Find the items playing at a point in time, i.e. starting
+ * at or before it and ending after it.
+ *
+ * @return std::vector<Interval> The items, ordered by their start.
+ */
+std::vector<IntervalIndex::Interval> IntervalIndex::at(float time) const {
+  return overlapping(time, std::nextafter(time, std::numeric_limits<float>::infinity()));
+}
+
+
+
+/**
+ * @brief Find the items playing during a time range, i.e. starting
+ * before its end and ending after its start.
+ *
+ * @return std::vector<Interval> The items, ordered by their start.
+ */
+std::vector<IntervalIndex::Interval> IntervalIndex::overlapping(float start, float end) const {
+  std::vector<Interval> result;
+  collect(0, intervals.size(), start, end, result);
+  return result;
+}
+
+
+
+void IntervalIndex::collect(size_t begin, size_t end, float start, float stop, std::vector<Interval>& result) const {
+  while (begin < end) {
+    size_t middle = begin + (end - begin) / 2;
+    // Nothing in this subtree lasts until the range.
+    if (maxEnds[middle] <= start) {
+      return;
+    }
+    collect(begin, middle, start, stop, result);
+    // Everything from here on starts too late.
+    if (intervals[middle].start >= stop) {
+      return;
+    }
+    if (intervals[middle].end > start) {
+      result.push_back(intervals[middle]);
+    }
+    // Continue with the right subtree without recursing.
+    begin = middle + 1;
+  }
+}
+
+} // Namespace mswmm
@@ -0,0 +1,73 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#ifndef _MSWMM_INTERVALINDEX_HPP
+#define _MSWMM_INTERVALINDEX_HPP
+
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <initializer_list>
+#include <memory_resource>
+
+#include "Timeline.hpp"
+
+
+namespace mswmm {
+
+enum class TrackType;
+
+
+
+/**
+ * @brief Finds the timeline items playing at a time or during a time
+ * range, across all tracks of a project.
+ *
+ * The items are sorted by their start, and the sorted array is used
+ * as an implicit balanced search tree, in which every node knows the
+ * latest end in its subtree. A query only descends into subtrees
+ * that can contain matches, so it takes logarithmic time plus the
+ * number of items found.
+ */
+class IntervalIndex {
+  public:
+    struct Interval {
+      float start;
+      float end;
+      TrackType track;
+      // Index of the item in the timeline of its track.
+      uint32_t item;
+    };
+
+    explicit IntervalIndex(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+      : intervals(resource), maxEnds(resource) {}
+
+    void build(std::initializer_list<std::pair<TrackType, Timeline const*>> tracks);
+    std::vector<Interval> at(float time) const;
+    std::vector<Interval> overlapping(float start, float end) const;
+    size_t size() const { return intervals.size(); }
+
+  private:
+    void collect(size_t begin, size_t end, float start, float stop, std::vector<Interval>& result) const;
+
+    std::pmr::vector<Interval> intervals;
+    // The latest end in the subtree rooted at each node.
+    std::pmr::vector<float> maxEnds;
+};
+
+} // Namespace mswmm
+
+#endif
@@ -0,0 +1,90 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#include <cmath>
+#include <charconv>
+
+#include "Json.hpp"
+
+
+namespace mswmm {
+
+/**
+ * @brief Append a string as a quoted and escaped JSON string.
+ */
+void appendJsonString(std::string& target, std::string_view str) {
+  static char const hex[] = "0123456789abcdef";
+  target += '"';
+  for (char c: str) {
+    switch (c) {
+      case '"':  target += "\\\""; break;
+      case '\\': target += "\\\\"; break;
+      case '\n': target += "\\n";  break;
+      case '\r': target += "\\r";  break;
+      case '\t': target += "\\t";  break;
+      default:
+        if (static_cast<unsigned char>(c) < 0x20) {
+          target += "\\u00";
+          target += hex[c >> 4];
+          target += hex[c & 0xF];
+        }
+        else {
+          target += c;
+        }
+    }
+  }
+  target += '"';
+}
+
+
+
+/**
+ * @brief Append a string member of an object, preceded by a comma.
+ */
+void appendJsonField(std::string& target, char const* key, std::string_view value) {
+  target += ",\"";
+  target += key;
+  target += "\":";
+  appendJsonString(target, value);
+}
+
+
+
+/**
+ * @brief Append a number with the fewest digits that read back as the
+ * same float, so 4.76 isn't written as 4.76000023.
+ * JSON has no infinity or NaN, so they are written as null.
+ */
+void appendJsonNumber(std::string& target, float value) {
+  if (!std::isfinite(value)) {
+    target += "null";
+    return;
+  }
+  // Not printf, which would write a decimal comma in some locales.
+  char buffer[32];
+  auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+  target.append(buffer, result.ptr);
+}
+
+
+
+void appendJsonNumber(std::string& target, uint64_t value) {
+  char buffer[24];
+  auto result = std::to_chars(buffer, buffer + sizeof(buffer), value);
+  target.append(buffer, result.ptr);
+}
+
+} // Namespace mswmm
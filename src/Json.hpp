@@ -0,0 +1,34 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#ifndef _MSWMM_JSON_HPP
+#define _MSWMM_JSON_HPP
+
+#include <string>
+#include <cstdint>
+#include <string_view>
+
+
+namespace mswmm {
+
+void appendJsonString(std::string& target, std::string_view str);
+void appendJsonField(std::string& target, char const* key, std::string_view value);
+void appendJsonNumber(std::string& target, float value);
+void appendJsonNumber(std::string& target, uint64_t value);
+
+} // Namespace mswmm
+
+#endif
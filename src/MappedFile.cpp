@@ -0,0 +1,92 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#else
+#include <fstream>
+#include <iterator>
+#endif
+
+#include "MappedFile.hpp"
+
+
+namespace mswmm {
+
+#ifndef _WIN32
+
+MappedFile::MappedFile(std::string const& path) : address(nullptr), length(0) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("Can't open file '" + path + "'.");
+  }
+
+  struct stat info;
+  if (fstat(fd, &info) != 0) {
+    close(fd);
+    throw std::runtime_error("Can't get size of file '" + path + "'.");
+  }
+  length = info.st_size;
+
+  // Empty files can't be mapped, but they are not valid CFB files
+  // anyway, which the caller will notice.
+  if (length > 0) {
+    void* mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+      close(fd);
+      throw std::runtime_error("Can't map file '" + path + "' into memory.");
+    }
+    // Sectors of a compound file are scattered, so read-ahead would
+    // mostly fetch thumbnails and links nobody asked for.
+    madvise(mapping, length, MADV_RANDOM);
+    address = static_cast<char const*>(mapping);
+  }
+  close(fd);
+}
+
+
+
+MappedFile::~MappedFile() {
+  if (address) {
+    munmap(const_cast<char*>(address), length);
+  }
+}
+
+#else
+
+MappedFile::MappedFile(std::string const& path) : address(nullptr), length(0) {
+  std::ifstream file(path, std::ios_base::in | std::ios_base::binary);
+  if (!file.good()) {
+    throw std::runtime_error("Can't open file '" + path + "'.");
+  }
+  buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  address = buffer.data();
+  length = buffer.size();
+}
+
+
+
+MappedFile::~MappedFile() {
+}
+
+#endif
+
+} // Namespace mswmm
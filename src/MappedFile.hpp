@@ -0,0 +1,55 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#ifndef _MSWMM_MAPPEDFILE_HPP
+#define _MSWMM_MAPPEDFILE_HPP
+
+#include <string>
+#include <vector>
+#include <cstddef>
+
+
+namespace mswmm {
+
+/**
+ * @brief A read-only memory mapping of a whole file.
+ *
+ * Pages are only read from disk when they are accessed, so parsing a
+ * compound file from the mapping only loads the sectors of the
+ * streams that are actually read. Windows isn't supported, so the
+ * whole file is read into a buffer there instead.
+ */
+class MappedFile {
+  public:
+    MappedFile(std::string const& path);
+    MappedFile(MappedFile const&) = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
+    ~MappedFile();
+
+    char const* data() const { return address; }
+    size_t size() const { return length; }
+
+  private:
+    char const* address;
+    size_t length;
+#ifdef _WIN32
+    std::vector<char> buffer;
+#endif
+};
+
+} // Namespace mswmm
+
+#endif
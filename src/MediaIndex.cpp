@@ -0,0 +1,294 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#include <cctype>
+#include <algorithm>
+#include <stdexcept>
+#include <filesystem>
+#include <unordered_set>
+
+#include "MediaIndex.hpp"
+#include "MappedFile.hpp"
+#include "Error.hpp"
+#include "Json.hpp"
+
+
+namespace mswmm {
+
+static std::string_view fileName(std::string_view path) {
+  size_t separator = path.find_last_of("\\/");
+  return separator == std::string_view::npos ? path : path.substr(separator + 1);
+}
+
+
+
+static std::string lowerCase(std::string_view str) {
+  std::string lower(str);
+  for (char& c: lower) {
+    c = std::tolower(static_cast<unsigned char>(c));
+  }
+  return lower;
+}
+
+
+
+static std::string extension(std::string_view path) {
+  std::string_view name = fileName(path);
+  size_t dot = name.rfind('.');
+  return dot == std::string_view::npos ? std::string() : lowerCase(name.substr(dot));
+}
+
+
+
+/**
+ * @brief Count the trailing directories two paths have in common,
+ * ignoring case and the kind of separators.
+ */
+static size_t commonDirectories(std::string_view a, std::string_view b) {
+  a = a.substr(0, a.size() - fileName(a).size());
+  b = b.substr(0, b.size() - fileName(b).size());
+  size_t count = 0;
+  while (!a.empty() && !b.empty()) {
+    a.remove_suffix(1);
+    b.remove_suffix(1);
+    std::string_view dirA = fileName(a);
+    std::string_view dirB = fileName(b);
+    if (dirA.empty() || lowerCase(dirA) != lowerCase(dirB)) {
+      break;
+    }
+    ++count;
+    a.remove_suffix(dirA.size());
+    b.remove_suffix(dirB.size());
+  }
+  return count;
+}
+
+
+
+/**
+ * @brief Index all regular files below a directory.
+ *
+ * @param root The media root. Directories that can't be read are
+ * skipped.
+ */
+MediaIndex::MediaIndex(std::string const& root) {
+  namespace fs = std::filesystem;
+  if (!fs::is_directory(root)) {
+    throw std::runtime_error("'" + root + "' is not a directory.");
+  }
+
+  auto options = fs::directory_options::skip_permission_denied;
+  for (auto const& entry: fs::recursive_directory_iterator(root, options)) {
+    std::error_code error;
+    if (!entry.is_regular_file(error)) {
+      continue;
+    }
+    uint64_t size = entry.file_size(error);
+    if (error) {
+      continue;
+    }
+    files.push_back({entry.path().string(), size});
+  }
+  // Directory order is arbitrary; sorting makes ties resolve the same
+  // way on every run.
+  std::sort(files.begin(), files.end(), [](File const& a, File const& b) { return a.path < b.path; });
+
+  for (uint32_t i = 0; i < files.size(); ++i) {
+    byName.emplace(lowerCase(fileName(files[i].path)), i);
+    // Links only store the lower 32 bits of the size.
+    bySize.emplace(files[i].size & UINT32_MAX, i);
+  }
+}
+
+
+
+/**
+ * @brief Find a source file of a project in the index.
+ *
+ * Files with the same name are matched by their exact size if the
+ * link is known, and by their size in KiB otherwise. If several files
+ * match equally well, the one sharing most trailing directories with
+ * the original path wins. A file that was renamed is only found if it
+ * is the only one with its exact size and extension.
+ *
+ * @param originalPath The path stored in the project (SrceFn).
+ * @param link The shell link of the source file; may be null.
+ * @param fileSizeKiB The size stored in the project, in KiB.
+ * @return Resolution The file found, if any.
+ */
+Resolution MediaIndex::resolve(std::string_view originalPath, ShellLink const* link, size_t fileSizeKiB) const {
+  // The link has the full original path, while SrceFn may start with
+  // a shell folder like "@:MyPictures".
+  std::string_view reference = originalPath;
+  if (link && !link->localPath.empty()) {
+    reference = link->localPath;
+  }
+  uint64_t exactSize = link ? link->fileSize : 0;
+
+  Resolution best;
+  size_t bestDirectories = 0;
+  auto range = byName.equal_range(lowerCase(fileName(reference)));
+  for (auto it = range.first; it != range.second; ++it) {
+    File const& file = files[it->second];
+    MatchType match;
+    if (exactSize != 0 && (file.size & UINT32_MAX) == exactSize) {
+      match = MatchType::NAME_AND_SIZE;
+    }
+    else if (file.size / 1024 == fileSizeKiB) {
+      match = MatchType::NAME_AND_KIB;
+    }
+    else {
+      continue;
+    }
+    size_t directories = commonDirectories(reference, file.path);
+    bool better = best.match == MatchType::NONE
+                  || static_cast<int>(match) < static_cast<int>(best.match)
+                  || (match == best.match && directories > bestDirectories)
+                  || (match == best.match && directories == bestDirectories && file.path < best.path);
+    if (better) {
+      best = {file.path, match};
+      bestDirectories = directories;
+    }
+  }
+  if (best.match != MatchType::NONE || exactSize == 0) {
+    return best;
+  }
+
+  std::string wantedExtension = extension(reference);
+  File const* candidate = nullptr;
+  auto sizeRange = bySize.equal_range(exactSize);
+  for (auto it = sizeRange.first; it != sizeRange.second; ++it) {
+    File const& file = files[it->second];
+    if (extension(file.path) != wantedExtension) {
+      continue;
+    }
+    if (candidate) {
+      // Ambiguous, so better not guess.
+      return best;
+    }
+    candidate = &file;
+  }
+  if (candidate) {
+    best = {candidate->path, MatchType::SIZE};
+  }
+  return best;
+}
+
+
+
+static char const* matchName(MatchType match) {
+  switch (match) {
+    case MatchType::NAME_AND_SIZE: return "name+size";
+    case MatchType::NAME_AND_KIB:  return "name+kib";
+    case MatchType::SIZE:          return "size";
+    default:                       return "none";
+  }
+}
+
+
+
+/**
+ * @brief Read the shell links of all source files of a project,
+ * resolve them against a media index and describe the result as a
+ * single line of JSON. Suitable as a BatchJob.
+ *
+ * @param path Path to the .MSWMM file.
+ * @param index The media root to search; if null, the links are only
+ * read.
+ * @param options Options for loading the project.
+ * @param failed Set to whether the project could not be read.
+ * Unresolved source files are not a failure.
+ * @return std::string A JSON object, terminated by a newline.
+ */
+std::string resolveSources(std::string const& path, MediaIndex const* index,
+                           LoadOptions const& options, bool& failed)
+{
+  static char const hex[] = "0123456789ABCDEF";
+  std::string json = "{\"path\":";
+  appendJsonString(json, path);
+
+  try {
+    MappedFile file(path);
+    char const* data = file.data();
+    size_t length = file.size();
+    Project project(data, length, options);
+    CFB::CompoundFileReader reader(data, length);
+
+    // Only appended once everything worked, so an error can't leave
+    // the JSON half written.
+    std::string sources;
+    size_t unresolved = 0;
+    std::unordered_set<std::string_view> seen;
+    for (Timeline const* timeline: {&project.videoTimeline(), &project.audioTimeline()}) {
+      for (auto const& item: *timeline) {
+        std::string_view srcPath = timeline->srcPath(item);
+        if (!item.hasSource() || !seen.insert(srcPath).second) {
+          continue;
+        }
+
+        sources += seen.size() == 1 ? "{\"file\":" : ",{\"file\":";
+        appendJsonString(sources, srcPath);
+        appendJsonField(sources, "link", timeline->link(item));
+        std::optional<ShellLink> link;
+        try {
+          link = readShellLink(reader, timeline->link(item));
+        }
+        catch (CorruptFileError const& e) {
+          // The project itself is fine, so just report the link.
+          appendJsonField(sources, "linkError", e.what());
+        }
+        if (link) {
+          appendJsonField(sources, "target", link->localPath.empty() ? link->networkPath : link->localPath);
+          sources += ",\"size\":" + std::to_string(link->fileSize);
+          std::string serial;
+          for (int shift = 28; shift >= 0; shift -= 4) {
+            serial += hex[link->driveSerialNumber >> shift & 0xF];
+          }
+          appendJsonField(sources, "volumeSerial", serial);
+          if (!link->machineId.empty()) {
+            appendJsonField(sources, "machine", link->machineId);
+            appendJsonField(sources, "objectId", formatGuid(link->objectId));
+          }
+        }
+        if (index) {
+          Resolution resolution = index->resolve(srcPath, link ? &*link : nullptr, item.fileSizeKiB);
+          if (resolution.match == MatchType::NONE) {
+            ++unresolved;
+          }
+          else {
+            appendJsonField(sources, "resolved", resolution.path);
+          }
+          appendJsonField(sources, "match", matchName(resolution.match));
+        }
+        sources += '}';
+      }
+    }
+    json += ",\"sources\":[" + sources + ']';
+    if (index) {
+      json += ",\"unresolved\":" + std::to_string(unresolved);
+    }
+    failed = false;
+  }
+  catch (std::exception const& e) {
+    appendJsonField(json, "error", e.what());
+    failed = true;
+  }
+
+  json += "}\n";
+  return json;
+}
+
+} // Namespace mswmm
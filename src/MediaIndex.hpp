@@ -0,0 +1,82 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#ifndef _MSWMM_MEDIAINDEX_HPP
+#define _MSWMM_MEDIAINDEX_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+
+#include "Project.hpp"
+#include "ShellLink.hpp"
+
+
+namespace mswmm {
+
+enum class MatchType {
+  NONE,
+  NAME_AND_SIZE, // Same file name and exact size, as stored in the link
+  NAME_AND_KIB,  // Same file name and size in KiB, as stored in the XML
+  SIZE           // Renamed, but the only file with the exact size and extension
+};
+
+
+
+struct Resolution {
+  std::string path;
+  MatchType match = MatchType::NONE;
+};
+
+
+
+/**
+ * @brief The files below a media root, to find the source files of
+ * projects that were moved to another place or machine.
+ *
+ * The directory tree is walked once on construction; afterwards,
+ * resolving a source file only takes hash lookups by file name and
+ * size, and never touches the file system. Several threads can
+ * resolve at once.
+ */
+class MediaIndex {
+  public:
+    explicit MediaIndex(std::string const& root);
+    size_t size() const { return files.size(); }
+    Resolution resolve(std::string_view originalPath, ShellLink const* link, size_t fileSizeKiB) const;
+
+  private:
+    struct File {
+      std::string path;
+      uint64_t size;
+    };
+
+    std::vector<File> files;
+    // Indices into files, by lower case file name and by exact size.
+    std::unordered_multimap<std::string, uint32_t> byName;
+    std::unordered_multimap<uint64_t, uint32_t> bySize;
+};
+
+
+
+std::string resolveSources(std::string const& path, MediaIndex const* index,
+                           LoadOptions const& options, bool& failed);
+
+} // Namespace mswmm
+
+#endif
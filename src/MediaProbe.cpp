@@ -0,0 +1,845 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <filesystem>
+
+#include "MediaProbe.hpp"
+#include "ParseCache.hpp"
+#include "Binary.hpp"
+#include "Error.hpp"
+#include "Json.hpp"
+
+
+namespace mswmm {
+
+namespace fs = std::filesystem;
+
+// "MSWMMMP" and a format version.
+static constexpr uint64_t magic = 0x01'50'4D'4D'4D'57'53'4DULL;
+
+
+
+/**
+ * @brief Reads small pieces of a file at arbitrary offsets, so only
+ * the headers of a media file are read, not its whole content.
+ */
+class HeaderReader {
+  public:
+    explicit HeaderReader(std::string const& path)
+      : file(path, std::ios_base::in | std::ios_base::binary), length(0)
+    {
+      if (file.good()) {
+        file.seekg(0, std::ios_base::end);
+        length = file.tellg();
+      }
+    }
+
+    bool isOpen() const { return file.is_open(); }
+    uint64_t size() const { return length; }
+
+    /**
+     * @brief Read bytes from the file. Throws a CorruptFileError if
+     * they are not all there.
+     *
+     * @return std::string_view The bytes, valid until the next read.
+     */
+    std::string_view read(uint64_t offset, size_t count) {
+      if (offset > length || count > length - offset) {
+        throw CorruptFileError("Truncated header.");
+      }
+      buffer.resize(count);
+      file.clear();
+      file.seekg(offset);
+      file.read(buffer.data(), count);
+      if (static_cast<size_t>(file.gcount()) != count) {
+        throw CorruptFileError("Can't read header.");
+      }
+      return buffer;
+    }
+
+    /**
+     * @brief Read up to count bytes, fewer at the end of the file.
+     */
+    std::string_view readSome(uint64_t offset, size_t count) {
+      if (offset >= length) {
+        return {};
+      }
+      return read(offset, std::min<uint64_t>(count, length - offset));
+    }
+
+  private:
+    std::ifstream file;
+    uint64_t length;
+    std::string buffer;
+};
+
+
+
+static uint64_t le(std::string_view data, size_t offset, int bytes) {
+  uint64_t value = 0;
+  for (int i = bytes - 1; i >= 0; --i) {
+    value = value << 8 | static_cast<uint8_t>(data[offset + i]);
+  }
+  return value;
+}
+
+
+
+static uint64_t be(std::string_view data, size_t offset, int bytes) {
+  uint64_t value = 0;
+  for (int i = 0; i < bytes; ++i) {
+    value = value << 8 | static_cast<uint8_t>(data[offset + i]);
+  }
+  return value;
+}
+
+
+
+/**
+ * @brief Find the first start of frame marker of a JPEG, skipping
+ * all other segments, e.g. EXIF data with its thumbnail.
+ */
+static void probeJpeg(HeaderReader& reader, MediaInfo& info) {
+  uint64_t offset = 2;
+  while (true) {
+    std::string_view marker = reader.read(offset, 2);
+    if (static_cast<uint8_t>(marker[0]) != 0xFF) {
+      throw CorruptFileError("Invalid JPEG marker.");
+    }
+    uint8_t type = marker[1];
+    // Fill bytes, and markers without a segment.
+    if (type == 0xFF) {
+      ++offset;
+      continue;
+    }
+    if (type == 0x01 || (type >= 0xD0 && type <= 0xD7)) {
+      offset += 2;
+      continue;
+    }
+    if (type == 0xD9 || type == 0xDA) {
+      throw CorruptFileError("No JPEG frame header.");
+    }
+    uint64_t length = be(reader.read(offset + 2, 2), 0, 2);
+    // SOF0 to SOF15, except DHT, JPG and DAC, which share the range.
+    if (type >= 0xC0 && type <= 0xCF && type != 0xC4 && type != 0xC8 && type != 0xCC) {
+      std::string_view frame = reader.read(offset + 4, 5);
+      info.dimensions = {be(frame, 3, 2), be(frame, 1, 2)};
+      info.hasVideo = true;
+      return;
+    }
+    offset += 2 + length;
+  }
+}
+
+
+
+static void probePng(HeaderReader& reader, MediaInfo& info) {
+  std::string_view header = reader.read(8, 16);
+  if (header.substr(4, 4) != "IHDR") {
+    throw CorruptFileError("No PNG image header.");
+  }
+  info.dimensions = {be(header, 8, 4), be(header, 12, 4)};
+  info.hasVideo = true;
+}
+
+
+
+static void probeGif(HeaderReader& reader, MediaInfo& info) {
+  std::string_view header = reader.read(6, 4);
+  info.dimensions = {le(header, 0, 2), le(header, 2, 2)};
+  info.hasVideo = true;
+}
+
+
+
+static void probeBmp(HeaderReader& reader, MediaInfo& info) {
+  std::string_view header = reader.read(14, 12);
+  if (le(header, 0, 4) == 12) {
+    // BITMAPCOREHEADER of OS/2 bitmaps.
+    info.dimensions = {le(header, 4, 2), le(header, 6, 2)};
+  }
+  else {
+    // The height is negative for top-down bitmaps.
+    int32_t width = static_cast<int32_t>(le(header, 4, 4));
+    int32_t height = static_cast<int32_t>(le(header, 8, 4));
+    info.dimensions = {static_cast<size_t>(std::abs(static_cast<int64_t>(width))),
+                       static_cast<size_t>(std::abs(static_cast<int64_t>(height)))};
+  }
+  info.hasVideo = true;
+}
+
+
+
+/**
+ * @brief The fields of an MPEG audio frame header.
+ */
+struct MpegFrame {
+  int version;    // 1, 2, or 3 for MPEG 2.5
+  int layer;      // 1 to 3
+  unsigned int bitrate;    // In bits per second
+  unsigned int sampleRate;
+  unsigned int samples;    // Per frame
+  bool mono;
+  size_t length;  // Of the whole frame, in bytes
+};
+
+
+
+static bool parseMpegFrame(std::string_view data, size_t offset, MpegFrame& frame) {
+  static constexpr unsigned int bitrates[5][15] = {
+    {0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448}, // MPEG 1, layer I
+    {0, 32, 48, 56,  64,  80,  96, 112, 128, 160, 192, 224, 256, 320, 384}, // MPEG 1, layer II
+    {0, 32, 40, 48,  56,  64,  80,  96, 112, 128, 160, 192, 224, 256, 320}, // MPEG 1, layer III
+    {0, 32, 48, 56,  64,  80,  96, 112, 128, 144, 160, 176, 192, 224, 256}, // MPEG 2 and 2.5, layer I
+    {0,  8, 16, 24,  32,  40,  48,  56,  64,  80,  96, 112, 128, 144, 160}  // MPEG 2 and 2.5, layer II and III
+  };
+  static constexpr unsigned int sampleRates[3] = {44100, 48000, 32000};
+
+  if (offset + 4 > data.size()) {
+    return false;
+  }
+  uint32_t header = be(data, offset, 4);
+  if ((header & 0xFFE00000) != 0xFFE00000) {
+    return false;
+  }
+  unsigned int versionBits = header >> 19 & 3;
+  unsigned int layerBits = header >> 17 & 3;
+  unsigned int bitrateIndex = header >> 12 & 15;
+  unsigned int rateIndex = header >> 10 & 3;
+  // Free format bitrates are not supported.
+  if (versionBits == 1 || layerBits == 0 || bitrateIndex == 0 || bitrateIndex == 15 || rateIndex == 3) {
+    return false;
+  }
+  frame.version = versionBits == 3 ? 1 : versionBits == 2 ? 2 : 3;
+  frame.layer = 4 - layerBits;
+  size_t table = frame.version == 1 ? frame.layer - 1 : frame.layer == 1 ? 3 : 4;
+  frame.bitrate = bitrates[table][bitrateIndex] * 1000;
+  frame.sampleRate = sampleRates[rateIndex] >> (frame.version - 1);
+  frame.mono = (header >> 6 & 3) == 3;
+  bool padding = header >> 9 & 1;
+  if (frame.layer == 1) {
+    frame.samples = 384;
+    frame.length = (12 * frame.bitrate / frame.sampleRate + padding) * 4;
+  }
+  else {
+    frame.samples = frame.layer == 3 && frame.version != 1 ? 576 : 1152;
+    frame.length = frame.samples / 8 * frame.bitrate / frame.sampleRate + padding;
+  }
+  return true;
+}
+
+
+
+/**
+ * @brief Find the first MPEG audio frame after the ID3v2 tag, and get
+ * the duration from the Xing or VBRI header of variable bitrate files
+ * or from the size of the file otherwise.
+ *
+ * @param start Where the ID3v2 tag ends.
+ */
+static void probeMp3(HeaderReader& reader, MediaInfo& info, uint64_t start) {
+  // Frames are searched for in the first 64 KiB, and two consecutive
+  // ones must be found, so random bytes aren't taken for a frame.
+  std::string_view data = reader.readSome(start, 65536);
+  MpegFrame frame, next;
+  size_t offset = 0;
+  for (; offset + 4 <= data.size(); ++offset) {
+    if (parseMpegFrame(data, offset, frame)
+        && (offset + frame.length + 4 > data.size() || parseMpegFrame(data, offset + frame.length, next))) {
+      break;
+    }
+  }
+  if (offset + 4 > data.size()) {
+    throw CorruptFileError("No MPEG audio frame.");
+  }
+  info.format = MediaFormat::MP3;
+  info.hasAudio = true;
+
+  size_t xing = offset + 4 + (frame.version == 1 ? (frame.mono ? 17 : 32) : (frame.mono ? 9 : 17));
+  size_t vbri = offset + 4 + 32;
+  uint64_t frames = 0;
+  if (xing + 12 <= data.size() && (data.substr(xing, 4) == "Xing" || data.substr(xing, 4) == "Info")
+      && (be(data, xing + 4, 4) & 1)) {
+    frames = be(data, xing + 8, 4);
+  }
+  else if (vbri + 18 <= data.size() && data.substr(vbri, 4) == "VBRI") {
+    frames = be(data, vbri + 14, 4);
+  }
+  if (frames > 0) {
+    info.duration = static_cast<double>(frames) * frame.samples / frame.sampleRate;
+    return;
+  }
+
+  // Constant bitrate; an ID3v1 tag at the end is no audio.
+  uint64_t audioSize = reader.size() - start - offset;
+  if (reader.size() >= 128 && reader.read(reader.size() - 128, 3) == "TAG") {
+    audioSize -= std::min<uint64_t>(128, audioSize);
+  }
+  info.duration = static_cast<double>(audioSize) * 8 / frame.bitrate;
+}
+
+
+
+static void probeWav(HeaderReader& reader, MediaInfo& info) {
+  uint64_t byteRate = 0;
+  uint64_t offset = 12;
+  while (offset + 8 <= reader.size()) {
+    std::string_view chunk = reader.read(offset, 8);
+    uint64_t length = le(chunk, 4, 4);
+    if (chunk.substr(0, 4) == "fmt ") {
+      byteRate = le(reader.read(offset + 8, 12), 8, 4);
+    }
+    else if (chunk.substr(0, 4) == "data") {
+      info.hasAudio = true;
+      if (byteRate > 0) {
+        // The size is wrong in files that were not finished.
+        length = std::min(length, reader.size() - offset - 8);
+        info.duration = static_cast<double>(length) / byteRate;
+      }
+      return;
+    }
+    offset += 8 + length + (length & 1);
+  }
+}
+
+
+
+/**
+ * @brief Read the main header and the stream headers in the hdrl list
+ * of an AVI file.
+ */
+static void probeAvi(HeaderReader& reader, MediaInfo& info) {
+  std::string_view list = reader.read(12, 12);
+  if (list.substr(0, 4) != "LIST" || list.substr(8, 4) != "hdrl") {
+    throw CorruptFileError("No AVI header list.");
+  }
+  uint64_t end = std::min(reader.size(), 20 + le(list, 4, 4));
+  double totalFrames = 0;
+  double frameDuration = 0;
+
+  // The stream lists are nested in hdrl; descending into every list
+  // walks them as well.
+  uint64_t offset = 24;
+  while (offset + 8 <= end) {
+    std::string_view chunk = reader.read(offset, 8);
+    std::string id(chunk.substr(0, 4));
+    uint64_t length = le(chunk, 4, 4);
+    if (id == "LIST") {
+      offset += 12;
+      continue;
+    }
+    if (id == "avih" && length >= 40) {
+      std::string_view header = reader.read(offset + 8, 40);
+      frameDuration = le(header, 0, 4) / 1e6;
+      totalFrames = le(header, 16, 4);
+      info.dimensions = {le(header, 32, 4), le(header, 36, 4)};
+    }
+    else if (id == "strh" && length >= 36) {
+      std::string_view header = reader.read(offset + 8, 36);
+      std::string_view type = header.substr(0, 4);
+      uint64_t scale = le(header, 20, 4);
+      uint64_t rate = le(header, 24, 4);
+      uint64_t streamLength = le(header, 32, 4);
+      if (type == "vids") {
+        info.hasVideo = true;
+        // avih only counts the frames in the first RIFF chunk of
+        // large OpenDML files, the stream header all of them.
+        if (rate > 0) {
+          info.duration = static_cast<double>(streamLength) * scale / rate;
+        }
+      }
+      else if (type == "auds") {
+        info.hasAudio = true;
+      }
+    }
+    offset += 8 + length + (length & 1);
+  }
+  if (info.duration == 0) {
+    info.duration = totalFrames * frameDuration;
+  }
+}
+
+
+
+// GUIDs of the ASF objects, in the byte order of the file.
+static constexpr char asfHeader[] = "\x30\x26\xB2\x75\x8E\x66\xCF\x11\xA6\xD9\x00\xAA\x00\x62\xCE\x6C";
+static constexpr char asfFileProperties[] = "\xA1\xDC\xAB\x8C\x47\xA9\xCF\x11\x8E\xE4\x00\xC0\x0C\x20\x53\x65";
+static constexpr char asfStreamProperties[] = "\x91\x07\xDC\xB7\xB7\xA9\xCF\x11\x8E\xE6\x00\xC0\x0C\x20\x53\x65";
+static constexpr char asfAudioMedia[] = "\x40\x9E\x69\xF8\x4D\x5B\xCF\x11\xA8\xFD\x00\x80\x5F\x5C\x44\x2B";
+static constexpr char asfVideoMedia[] = "\xC0\xEF\x19\xBC\x4D\x5B\xCF\x11\xA8\xFD\x00\x80\x5F\x5C\x44\x2B";
+
+
+
+static bool isGuid(std::string_view data, size_t offset, char const* guid) {
+  return std::memcmp(data.data() + offset, guid, 16) == 0;
+}
+
+
+
+/**
+ * @brief Read the file and stream properties in the header object of
+ * an ASF file, i.e. WMV or WMA. Streams declared only in the header
+ * extension are not found.
+ */
+static void probeAsf(HeaderReader& reader, MediaInfo& info) {
+  std::string_view header = reader.read(0, 30);
+  uint64_t end = std::min(reader.size(), le(header, 16, 8));
+  uint64_t objectCount = le(header, 24, 4);
+
+  uint64_t offset = 30;
+  for (uint64_t i = 0; i < objectCount && offset + 24 <= end; ++i) {
+    std::string_view object = reader.read(offset, 24);
+    uint64_t length = le(object, 16, 8);
+    if (length < 24) {
+      throw CorruptFileError("Invalid ASF object.");
+    }
+    if (isGuid(object, 0, asfFileProperties)) {
+      std::string_view properties = reader.read(offset + 24, 80);
+      uint64_t playDuration = le(properties, 40, 8);
+      uint64_t preroll = le(properties, 56, 8);
+      bool broadcast = le(properties, 64, 4) & 1;
+      if (!broadcast) {
+        // 100 ns units, and the preroll in milliseconds.
+        info.duration = std::max(0.0, playDuration / 1e7 - preroll / 1e3);
+      }
+    }
+    else if (isGuid(object, 0, asfStreamProperties)) {
+      std::string_view properties = reader.read(offset + 24, 54);
+      if (isGuid(properties, 0, asfAudioMedia)) {
+        info.hasAudio = true;
+      }
+      else if (isGuid(properties, 0, asfVideoMedia)) {
+        info.hasVideo = true;
+        // The type specific data starts with the encoded image size.
+        std::string_view video = reader.read(offset + 78, 8);
+        info.dimensions = {le(video, 0, 4), le(video, 4, 4)};
+      }
+    }
+    offset += length;
+  }
+}
+
+
+
+char const* formatName(MediaFormat format) {
+  switch (format) {
+    case MediaFormat::JPEG: return "jpeg";
+    case MediaFormat::PNG:  return "png";
+    case MediaFormat::GIF:  return "gif";
+    case MediaFormat::BMP:  return "bmp";
+    case MediaFormat::MP3:  return "mp3";
+    case MediaFormat::WAV:  return "wav";
+    case MediaFormat::AVI:  return "avi";
+    case MediaFormat::ASF:  return "asf";
+    default:                return "unknown";
+  }
+}
+
+
+
+/**
+ * @brief Get the format, dimensions, duration and streams of a media
+ * file from its headers, without decoding anything.
+ *
+ * The format is recognized by the content, not by the extension. For
+ * formats that are not known, and for files with broken headers, only
+ * the size is set.
+ *
+ * @param path Path to the media file.
+ * @return MediaInfo What was found out; MediaInfo::found is false if
+ * the file can't be opened.
+ */
+MediaInfo probeMedia(std::string const& path) {
+  MediaInfo info;
+  HeaderReader reader(path);
+  if (!reader.isOpen()) {
+    return info;
+  }
+  info.found = true;
+  info.fileSize = reader.size();
+
+  try {
+    std::string_view magic = reader.readSome(0, 16);
+    auto startsWith = [&](std::string_view prefix) {
+      return magic.substr(0, prefix.size()) == prefix;
+    };
+    if (startsWith("\xFF\xD8\xFF")) {
+      info.format = MediaFormat::JPEG;
+      probeJpeg(reader, info);
+    }
+    else if (startsWith("\x89PNG\r\n\x1A\n")) {
+      info.format = MediaFormat::PNG;
+      probePng(reader, info);
+    }
+    else if (startsWith("GIF87a") || startsWith("GIF89a")) {
+      info.format = MediaFormat::GIF;
+      probeGif(reader, info);
+    }
+    else if (startsWith("BM")) {
+      info.format = MediaFormat::BMP;
+      probeBmp(reader, info);
+    }
+    else if (startsWith("RIFF") && magic.size() >= 12 && magic.substr(8, 4) == "WAVE") {
+      info.format = MediaFormat::WAV;
+      probeWav(reader, info);
+    }
+    else if (startsWith("RIFF") && magic.size() >= 12 && magic.substr(8, 4) == "AVI ") {
+      info.format = MediaFormat::AVI;
+      probeAvi(reader, info);
+    }
+    else if (magic.size() == 16 && isGuid(magic, 0, asfHeader)) {
+      info.format = MediaFormat::ASF;
+      probeAsf(reader, info);
+    }
+    else if (startsWith("ID3") && magic.size() >= 10) {
+      // The size of the tag is stored in 7 bits per byte.
+      uint64_t size = 0;
+      for (int i = 6; i < 10; ++i) {
+        size = size << 7 | (magic[i] & 0x7F);
+      }
+      bool footer = magic[5] & 0x10;
+      probeMp3(reader, info, 10 + size + (footer ? 10 : 0));
+    }
+    else if (magic.size() >= 2 && static_cast<uint8_t>(magic[0]) == 0xFF && (magic[1] & 0xE0) == 0xE0) {
+      probeMp3(reader, info, 0);
+    }
+  }
+  catch (CorruptFileError&) {
+    // Keep what is known so far.
+  }
+  return info;
+}
+
+
+
+/**
+ * @brief Probe a media file, or take the result from the cache if
+ * the file didn't change since it was probed.
+ *
+ * If other threads probe the same file at the same time, only one of
+ * them reads it and the others wait for its result.
+ *
+ * @param path Path to the media file.
+ */
+MediaInfo MediaProbe::probe(std::string const& path) {
+  std::error_code error;
+  uint64_t fileSize = fs::file_size(path, error);
+  if (error) {
+    return MediaInfo();
+  }
+  uint64_t fileTime = fs::last_write_time(path, error).time_since_epoch().count();
+  if (error) {
+    return MediaInfo();
+  }
+
+  std::promise<MediaInfo> promise;
+  std::shared_future<MediaInfo> cached;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = entries.find(path);
+    if (it != entries.end() && it->second.fileSize == fileSize && it->second.fileTime == fileTime) {
+      cached = it->second.info;
+    }
+    else {
+      entries[path] = {fileSize, fileTime, promise.get_future().share()};
+    }
+  }
+  if (cached.valid()) {
+    return cached.get();
+  }
+  MediaInfo info = probeMedia(path);
+  promise.set_value(info);
+  return info;
+}
+
+
+
+/**
+ * @brief Probe many files on a pool of threads, e.g. all source files
+ * of a project before rendering it. The results are taken from the
+ * cache afterwards.
+ *
+ * @param paths The files; duplicates are only probed once.
+ * @param threads Number of threads; 0 means one per hardware thread.
+ */
+void MediaProbe::probeAll(std::vector<std::string> const& paths, unsigned int threads) {
+  if (threads == 0) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+  threads = std::min<size_t>(threads, paths.size());
+
+  std::atomic<size_t> next(0);
+  auto work = [&]() {
+    for (size_t i = next++; i < paths.size(); i = next++) {
+      probe(paths[i]);
+    }
+  };
+  std::vector<std::thread> pool;
+  for (unsigned int i = 0; i < threads; ++i) {
+    pool.emplace_back(work);
+  }
+  for (auto& t: pool) {
+    t.join();
+  }
+}
+
+
+
+size_t MediaProbe::size() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return entries.size();
+}
+
+
+
+/**
+ * @brief Add the results stored by save() to the cache. A missing or
+ * broken file is not an error, the cache just stays as it is.
+ *
+ * @param path The file to read.
+ */
+void MediaProbe::load(std::string const& path) {
+  std::ifstream file(path, std::ios_base::in | std::ios_base::binary);
+  if (!file.good()) {
+    return;
+  }
+  std::string content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+  std::vector<std::pair<std::string, Entry>> loaded;
+  try {
+    BinaryReader reader(content.data(), content.size());
+    if (reader.u64() != magic) {
+      return;
+    }
+    uint32_t count = reader.u32();
+    for (uint32_t i = 0; i < count; ++i) {
+      std::string mediaPath(reader.string());
+      Entry entry;
+      entry.fileSize = reader.u64();
+      entry.fileTime = reader.u64();
+      MediaInfo info;
+      info.found = true;
+      info.fileSize = entry.fileSize;
+      uint8_t format = reader.u8();
+      if (format > static_cast<uint8_t>(MediaFormat::ASF)) {
+        return;
+      }
+      info.format = static_cast<MediaFormat>(format);
+      info.dimensions.x = reader.u64();
+      info.dimensions.y = reader.u64();
+      info.duration = reader.f32();
+      uint8_t flags = reader.u8();
+      info.hasVideo = flags & 1;
+      info.hasAudio = flags & 2;
+      std::promise<MediaInfo> promise;
+      promise.set_value(info);
+      entry.info = promise.get_future().share();
+      loaded.emplace_back(std::move(mediaPath), std::move(entry));
+    }
+  }
+  catch (CorruptFileError&) {
+    return;
+  }
+
+  // Results of this run are newer.
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto& [mediaPath, entry]: loaded) {
+    entries.emplace(std::move(mediaPath), std::move(entry));
+  }
+}
+
+
+
+/**
+ * @brief Store all results, so load() can take them up in another
+ * run. Failing to write is ignored, as the cache only saves time.
+ *
+ * @param path The file to write. It is replaced atomically, so
+ * several processes can share it.
+ */
+void MediaProbe::save(std::string const& path) const {
+  std::string content;
+  BinaryWriter writer(content);
+  writer.u64(magic);
+  std::string records;
+  BinaryWriter recordWriter(records);
+  uint32_t count = 0;
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto const& [mediaPath, entry]: entries) {
+      // Files still being probed by another thread are left out.
+      if (entry.info.wait_for(std::chrono::seconds(0)) != std::future_status::ready) {
+        continue;
+      }
+      MediaInfo const& info = entry.info.get();
+      recordWriter.string(mediaPath);
+      recordWriter.u64(entry.fileSize);
+      recordWriter.u64(entry.fileTime);
+      recordWriter.u8(static_cast<uint8_t>(info.format));
+      recordWriter.u64(info.dimensions.x);
+      recordWriter.u64(info.dimensions.y);
+      recordWriter.f32(info.duration);
+      recordWriter.u8(info.hasVideo | info.hasAudio << 1);
+      ++count;
+    }
+  }
+  writer.u32(count);
+  content += records;
+
+  std::error_code error;
+  fs::path parent = fs::path(path).parent_path();
+  if (!parent.empty()) {
+    fs::create_directories(parent, error);
+  }
+  replaceFile(path, content);
+}
+
+
+
+/**
+ * @brief Probe the source files of a project and compare them with
+ * what the project says about them, as a single line of JSON.
+ * Suitable as a BatchJob.
+ *
+ * Mismatches are reported for the size in KiB, for the dimensions of
+ * pictures and videos, and for items that take more from a video or
+ * sound than the file holds.
+ *
+ * @param path Path to the .MSWMM file.
+ * @param probe Where to probe; share it between the projects of a
+ * batch run, so files used by many projects are only probed once.
+ * @param index If not null, the source files are looked for below
+ * its media root. Otherwise they are probed where the project says.
+ * @param options Options for loading the project.
+ * @param failed Set to whether the project could not be read.
+ * Missing or differing source files are not a failure.
+ * @return std::string A JSON object, terminated by a newline.
+ */
+std::string probeSources(std::string const& path, MediaProbe& probe, MediaIndex const* index,
+                         LoadOptions const& options, bool& failed)
+{
+  std::string json = "{\"path\":";
+  appendJsonString(json, path);
+
+  try {
+    Project project(path, options);
+
+    // Each file once, with the furthest point any item takes from it.
+    struct Source {
+      Timeline const* timeline;
+      TimelineItem const* item;
+      float sourceEnd;
+    };
+    std::vector<Source> sources;
+    std::unordered_map<std::string_view, size_t> seen;
+    for (Timeline const* timeline: {&project.videoTimeline(), &project.audioTimeline()}) {
+      for (auto const& item: *timeline) {
+        if (!item.hasSource()) {
+          continue;
+        }
+        float sourceEnd = item.type == ItemType::STILL ? 0 : item.sourceEnd;
+        auto [it, inserted] = seen.emplace(timeline->srcPath(item), sources.size());
+        if (inserted) {
+          sources.push_back({timeline, &item, sourceEnd});
+        }
+        else {
+          sources[it->second].sourceEnd = std::max(sources[it->second].sourceEnd, sourceEnd);
+        }
+      }
+    }
+
+    std::string list;
+    size_t missing = 0;
+    size_t mismatched = 0;
+    for (auto const& source: sources) {
+      TimelineItem const& item = *source.item;
+      std::string_view srcPath = source.timeline->srcPath(item);
+      list += list.empty() ? "{\"file\":" : ",{\"file\":";
+      appendJsonString(list, srcPath);
+
+      std::string mediaPath(srcPath);
+      if (index) {
+        mediaPath = index->resolve(srcPath, nullptr, item.fileSizeKiB).path;
+      }
+      MediaInfo info;
+      if (!mediaPath.empty()) {
+        info = probe.probe(mediaPath);
+      }
+      if (!info.found) {
+        list += ",\"missing\":true}";
+        ++missing;
+        continue;
+      }
+      if (index) {
+        appendJsonField(list, "resolved", mediaPath);
+      }
+      appendJsonField(list, "format", formatName(info.format));
+      list += ",\"size\":";
+      appendJsonNumber(list, info.fileSize);
+      if (info.dimensions.x != 0) {
+        list += ",\"width\":";
+        appendJsonNumber(list, static_cast<uint64_t>(info.dimensions.x));
+        list += ",\"height\":";
+        appendJsonNumber(list, static_cast<uint64_t>(info.dimensions.y));
+      }
+      if (info.duration > 0) {
+        list += ",\"duration\":";
+        appendJsonNumber(list, info.duration);
+      }
+      list += info.hasVideo ? ",\"video\":true" : ",\"video\":false";
+      list += info.hasAudio ? ",\"audio\":true" : ",\"audio\":false";
+
+      std::string mismatches;
+      if (info.fileSize / 1024 != item.fileSizeKiB) {
+        mismatches += ",\"size\"";
+      }
+      if (item.type != ItemType::AUDIO && info.dimensions.x != 0 && info.dimensions != item.srcSizePx) {
+        mismatches += ",\"dimensions\"";
+      }
+      // A tenth of a second is left for rounding and for the frames
+      // Movie Maker and the headers count differently.
+      if (info.duration > 0 && source.sourceEnd > info.duration + 0.1f) {
+        mismatches += ",\"duration\"";
+      }
+      if (!mismatches.empty()) {
+        list += ",\"mismatch\":[" + mismatches.substr(1) + ']';
+        ++mismatched;
+      }
+      list += '}';
+    }
+    json += ",\"sources\":[" + list + ']';
+    json += ",\"missing\":" + std::to_string(missing);
+    json += ",\"mismatched\":" + std::to_string(mismatched);
+    failed = false;
+  }
+  catch (std::exception const& e) {
+    appendJsonField(json, "error", e.what());
+    failed = true;
+  }
+
+  json += "}\n";
+  return json;
+}
+
+} // Namespace mswmm
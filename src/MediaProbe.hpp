@@ -0,0 +1,107 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#ifndef _MSWMM_MEDIAPROBE_HPP
+#define _MSWMM_MEDIAPROBE_HPP
+
+#include <mutex>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <future>
+#include <unordered_map>
+
+#include "Project.hpp"
+#include "MediaIndex.hpp"
+#include "TimelineItem.hpp"
+
+
+namespace mswmm {
+
+enum class MediaFormat : uint8_t {
+  UNKNOWN,
+  JPEG,
+  PNG,
+  GIF,
+  BMP,
+  MP3,
+  WAV,
+  AVI,
+  ASF // WMV and WMA
+};
+
+
+
+/**
+ * @brief What the headers of a media file tell about it.
+ */
+struct MediaInfo {
+  // Whether the file exists and could be opened.
+  bool found = false;
+  MediaFormat format = MediaFormat::UNKNOWN;
+  uint64_t fileSize = 0;
+  // Zero if unknown or if there is no picture.
+  size dimensions = {0, 0};
+  // In seconds; zero for pictures or if unknown.
+  float duration = 0;
+  bool hasVideo = false;
+  bool hasAudio = false;
+};
+
+
+
+char const* formatName(MediaFormat format);
+MediaInfo probeMedia(std::string const& path);
+
+
+
+/**
+ * @brief Probes media files and remembers the results by path, file
+ * size and modification time.
+ *
+ * Probing only reads the headers of a file, see probeMedia(). Each
+ * file is probed once, no matter how many projects use it or how many
+ * threads ask for it at the same time; a file that changed is probed
+ * again. The results can be stored in a file and loaded by the next
+ * run.
+ */
+class MediaProbe {
+  public:
+    MediaInfo probe(std::string const& path);
+    void probeAll(std::vector<std::string> const& paths, unsigned int threads = 0);
+    size_t size() const;
+    void load(std::string const& path);
+    void save(std::string const& path) const;
+
+  private:
+    struct Entry {
+      uint64_t fileSize;
+      uint64_t fileTime;
+      std::shared_future<MediaInfo> info;
+    };
+
+    mutable std::mutex mutex;
+    std::unordered_map<std::string, Entry> entries;
+};
+
+
+
+std::string probeSources(std::string const& path, MediaProbe& probe, MediaIndex const* index,
+                         LoadOptions const& options, bool& failed);
+
+} // Namespace mswmm
+
+#endif
@@ -0,0 +1,191 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <fstream>
+#include <iterator>
+#include <filesystem>
+#include <system_error>
+
+#include "ParseCache.hpp"
+#include "Hash.hpp"
+
+
+namespace mswmm {
+
+namespace fs = std::filesystem;
+
+// "MSWMMPC" and a format version. Change the version whenever the
+// layout of the model changes, so old entries are ignored.
+static constexpr uint64_t magic = 0x06'43'50'4D'4D'57'53'4DULL;
+
+
+
+/**
+ * @brief Replace a file by writing to a file of our own and renaming
+ * it, so readers never see it half written, even if other threads or
+ * processes write the same file at the same time.
+ *
+ * @return bool Whether the file was written.
+ */
+bool replaceFile(std::string const& path, std::string const& content) {
+  static std::atomic<uint64_t> counter(0);
+  uint64_t unique = std::hash<std::thread::id>()(std::this_thread::get_id()) ^ (counter++ << 48)
+                  ^ static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+  std::string tempPath = path + "." + std::to_string(unique) + ".tmp";
+
+  std::error_code error;
+  {
+    std::ofstream file(tempPath, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+    file.write(content.data(), content.size());
+    if (!file.good()) {
+      file.close();
+      fs::remove(tempPath, error);
+      return false;
+    }
+  }
+  fs::rename(tempPath, path, error);
+  if (error) {
+    fs::remove(tempPath, error);
+    return false;
+  }
+  return true;
+}
+
+
+
+/**
+ * @brief Look up the cache entry of a project file.
+ * Missing or unreadable entries and directories are not an error;
+ * the entry is just invalid then.
+ *
+ * @param directory The cache directory. It is created when the first
+ * entry is stored.
+ * @param path Path to the project file.
+ */
+ParseCache::ParseCache(std::string const& directory, std::string const& path)
+  : directory(directory), fileSize(0), fileTime(0), cachedSize(0), cachedTime(0), cachedHash(0)
+{
+  entryPath = (fs::path(directory) / (hashPath(path) + ".cache")).string();
+
+  std::error_code error;
+
+  fileSize = fs::file_size(path, error);
+  if (error) {
+    return;
+  }
+  fileTime = fs::last_write_time(path, error).time_since_epoch().count();
+  if (error) {
+    return;
+  }
+
+  std::ifstream file(entryPath, std::ios_base::in | std::ios_base::binary);
+  if (!file.good()) {
+    return;
+  }
+  entry.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  try {
+    BinaryReader header(entry.data(), entry.size());
+    if (header.u64() != magic) {
+      throw CorruptFileError("Not a cache entry.");
+    }
+    cachedSize = header.u64();
+    cachedTime = header.u64();
+    cachedHash = header.u64();
+    header.u32(); // Size of the model.
+  }
+  catch (CorruptFileError&) {
+    entry.clear();
+  }
+}
+
+
+
+/**
+ * @brief Check if the project file is unchanged since the entry was
+ * stored, judging by its size and modification time.
+ */
+bool ParseCache::isFresh() const {
+  return !entry.empty() && cachedSize == fileSize && cachedTime == fileTime;
+}
+
+
+
+/**
+ * @brief Check if the entry was stored for the given Producer.Dat.
+ *
+ * @param producerHash hashBytes() of the raw Producer.Dat stream.
+ */
+bool ParseCache::matches(uint64_t producerHash) const {
+  return !entry.empty() && cachedHash == producerHash;
+}
+
+
+
+/**
+ * @brief Get a reader for the cached model. Only call this if the
+ * entry is fresh or matches.
+ */
+BinaryReader ParseCache::model() const {
+  BinaryReader header(entry.data() + 32, 4);
+  size_t modelSize = header.u32();
+  if (entry.size() - headerSize != modelSize) {
+    throw CorruptFileError("Cache entry '" + entryPath + "' is truncated.");
+  }
+  return BinaryReader(entry.data() + headerSize, modelSize);
+}
+
+
+
+/**
+ * @brief Write the entry for the project file. Failing to write is
+ * ignored, as the cache only saves time.
+ *
+ * @param producerHash hashBytes() of the raw Producer.Dat stream.
+ * @param model The serialized model of the project.
+ */
+void ParseCache::store(uint64_t producerHash, std::string const& model) const {
+  std::string content;
+  content.reserve(headerSize + model.size());
+  BinaryWriter writer(content);
+  writer.u64(magic);
+  writer.u64(fileSize);
+  writer.u64(fileTime);
+  writer.u64(producerHash);
+  writer.u32(model.size());
+  content += model;
+
+  std::error_code error;
+  fs::create_directories(directory, error);
+  replaceFile(entryPath, content);
+}
+
+
+
+/**
+ * @brief Store the entry again with the current size and time of the
+ * project file, after it turned out to match by hash.
+ */
+void ParseCache::refresh() const {
+  if (entry.empty() || isFresh()) {
+    return;
+  }
+  store(cachedHash, entry.substr(headerSize));
+}
+
+} // Namespace mswmm
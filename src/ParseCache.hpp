@@ -0,0 +1,69 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#ifndef _MSWMM_PARSECACHE_HPP
+#define _MSWMM_PARSECACHE_HPP
+
+#include <string>
+#include <cstdint>
+
+#include "Binary.hpp"
+
+
+namespace mswmm {
+
+bool replaceFile(std::string const& path, std::string const& content);
+
+
+
+/**
+ * @brief The cache entry of one project file in a cache directory.
+ *
+ * An entry holds the model extracted from a project, together with
+ * the size and modification time of the file and a hash of its
+ * Producer.Dat. If size and time are unchanged, the entry is used
+ * without opening the project at all; otherwise it is still used if
+ * the hash matches, e.g. after the file was copied.
+ * Entries are named after a hash of the absolute path of the project
+ * and replaced atomically, so several processes can share a directory.
+ */
+class ParseCache {
+  public:
+    ParseCache(std::string const& directory, std::string const& path);
+
+    bool isFresh() const;
+    bool matches(uint64_t producerHash) const;
+    BinaryReader model() const;
+    void store(uint64_t producerHash, std::string const& model) const;
+    void refresh() const;
+
+  private:
+    static constexpr size_t headerSize = 36;
+
+    std::string directory;
+    std::string entryPath;
+    uint64_t fileSize;
+    uint64_t fileTime;
+    // The entry as read from disk; empty if there is no valid entry.
+    std::string entry;
+    uint64_t cachedSize;
+    uint64_t cachedTime;
+    uint64_t cachedHash;
+};
+
+} // Namespace mswmm
+
+#endif
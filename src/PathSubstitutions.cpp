@@ -0,0 +1,182 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#include <map>
+#include <algorithm>
+
+#include "PathSubstitutions.hpp"
+
+
+namespace mswmm {
+
+// Matches remembered while scanning a path, so the result can be
+// allocated once with its final size. Paths with more matches are
+// finished by appending.
+static constexpr size_t bufferedMatches = 32;
+
+
+
+/**
+ * @brief Compile substitution rules.
+ *
+ * @param substitutions Pairs of pattern and replacement. All occurrences of a
+ * pattern are replaced.
+ */
+PathSubstitutions::PathSubstitutions(std::vector<std::pair<std::string, std::string>> const& substitutions) {
+  // Build the trie with ordered children, then lay it out
+  // breadth-first, so the children of each node are contiguous.
+  struct BuildNode {
+    std::map<unsigned char, uint32_t> children;
+    uint32_t rule = none;
+  };
+  std::vector<BuildNode> trie(1);
+  for (auto const& [pattern, replacement]: substitutions) {
+    if (pattern.empty()) {
+      continue;
+    }
+    uint32_t node = 0;
+    for (char c: pattern) {
+      auto it = trie[node].children.find(static_cast<unsigned char>(c));
+      if (it == trie[node].children.end()) {
+        it = trie[node].children.emplace(static_cast<unsigned char>(c), trie.size()).first;
+        trie.emplace_back();
+      }
+      node = it->second;
+    }
+    if (trie[node].rule == none) {
+      trie[node].rule = rules.size();
+      rules.push_back({pattern.size(), replacement});
+    }
+  }
+
+  std::vector<uint32_t> order(1, 0);
+  std::vector<uint32_t> position(trie.size(), 0);
+  for (size_t i = 0; i < order.size(); ++i) {
+    BuildNode const& b = trie[order[i]];
+    nodes.push_back({static_cast<uint32_t>(edges.size()), static_cast<uint32_t>(b.children.size()), b.rule});
+    for (auto const& [byte, child]: b.children) {
+      position[child] = order.size();
+      order.push_back(child);
+      edges.push_back({byte, child});
+    }
+  }
+  for (Edge& edge: edges) {
+    edge.target = position[edge.target];
+  }
+
+  rootChildren.fill(0);
+  for (uint32_t i = 0; i < nodes[0].edgeCount; ++i) {
+    rootChildren[edges[i].byte] = edges[i].target;
+  }
+}
+
+
+
+/**
+ * @brief Find the longest pattern starting at a position.
+ *
+ * @return uint32_t The index of its rule, or none.
+ */
+uint32_t PathSubstitutions::match(std::string_view path, size_t pos) const {
+  uint32_t node = rootChildren[static_cast<unsigned char>(path[pos])];
+  uint32_t rule = none;
+  while (node != 0) {
+    if (nodes[node].rule != none) {
+      rule = nodes[node].rule;
+    }
+    if (++pos == path.size()) {
+      break;
+    }
+    auto first = edges.begin() + nodes[node].firstEdge;
+    auto last = first + nodes[node].edgeCount;
+    auto byte = static_cast<unsigned char>(path[pos]);
+    auto it = std::lower_bound(first, last, byte, [](Edge const& e, unsigned char b) { return e.byte < b; });
+    node = it != last && it->byte == byte ? it->target : 0;
+  }
+  return rule;
+}
+
+
+
+/**
+ * @brief Apply the substitutions to a path.
+ *
+ * @return std::string The rewritten path.
+ */
+std::string PathSubstitutions::apply(std::string_view path) const {
+  struct Found {
+    size_t pos;
+    uint32_t rule;
+  };
+  Found found[bufferedMatches];
+  size_t count = 0;
+  size_t length = path.size();
+  // Where the buffer ran full; the rest is rewritten by appending.
+  size_t tail = path.size();
+  for (size_t pos = 0; pos < path.size();) {
+    uint32_t rule = match(path, pos);
+    if (rule == none) {
+      ++pos;
+      continue;
+    }
+    if (count == bufferedMatches) {
+      tail = pos;
+      break;
+    }
+    found[count++] = {pos, rule};
+    length += rules[rule].replacement.size() - rules[rule].patternLength;
+    pos += rules[rule].patternLength;
+  }
+
+  std::string result;
+  result.reserve(length);
+  size_t copied = 0;
+  for (size_t i = 0; i < count; ++i) {
+    Rule const& rule = rules[found[i].rule];
+    result.append(path.substr(copied, found[i].pos - copied));
+    result += rule.replacement;
+    copied = found[i].pos + rule.patternLength;
+  }
+  result.append(path.substr(copied, tail - copied));
+  if (tail < path.size()) {
+    apply(path.substr(tail), result);
+  }
+  return result;
+}
+
+
+
+/**
+ * @brief Apply the substitutions to a path and append the result,
+ * e.g. to a buffer that is reused for many paths.
+ */
+void PathSubstitutions::apply(std::string_view path, std::string& target) const {
+  size_t copied = 0;
+  for (size_t pos = 0; pos < path.size();) {
+    uint32_t rule = match(path, pos);
+    if (rule == none) {
+      ++pos;
+      continue;
+    }
+    target.append(path.substr(copied, pos - copied));
+    target += rules[rule].replacement;
+    pos += rules[rule].patternLength;
+    copied = pos;
+  }
+  target.append(path.substr(copied));
+}
+
+} // Namespace mswmm
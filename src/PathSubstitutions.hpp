@@ -0,0 +1,84 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#ifndef _MSWMM_PATHSUBSTITUTIONS_HPP
+#define _MSWMM_PATHSUBSTITUTIONS_HPP
+
+#include <array>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <utility>
+#include <string_view>
+
+
+namespace mswmm {
+
+/**
+ * @brief A precompiled set of string substitutions for source paths,
+ * e.g. to map "@:MyPictures" or drive letters to local directories.
+ *
+ * The patterns are compiled into a trie, so a path is rewritten in a
+ * single pass, no matter how many rules there are: at each position,
+ * the longest pattern starting there is replaced, and scanning goes on
+ * after it. Replacements are never scanned again. If two rules have
+ * the same pattern, the first one wins; empty patterns are ignored.
+ * The object doesn't change after construction, so it can be shared
+ * between projects and threads.
+ */
+class PathSubstitutions {
+  public:
+    PathSubstitutions() : PathSubstitutions(std::vector<std::pair<std::string, std::string>>()) {}
+    explicit PathSubstitutions(std::vector<std::pair<std::string, std::string>> const& substitutions);
+
+    std::string apply(std::string_view path) const;
+    void apply(std::string_view path, std::string& target) const;
+    bool empty() const { return rules.empty(); }
+
+  private:
+    static constexpr uint32_t none = UINT32_MAX;
+
+    // The children of a node are a sorted range in edges.
+    struct Node {
+      uint32_t firstEdge;
+      uint32_t edgeCount;
+      uint32_t rule;
+    };
+
+    struct Edge {
+      unsigned char byte;
+      uint32_t target;
+    };
+
+    struct Rule {
+      size_t patternLength;
+      std::string replacement;
+    };
+
+    uint32_t match(std::string_view path, size_t pos) const;
+
+    std::vector<Rule> rules;
+    std::vector<Node> nodes;
+    std::vector<Edge> edges;
+    // Children of the root by byte, so most positions of a path are
+    // rejected with a single lookup. Zero if there is no child, as the
+    // root is nobody's child.
+    std::array<uint32_t, 256> rootChildren;
+};
+
+} // Namespace mswmm
+
+#endif
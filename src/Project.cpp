@@ -14,34 +14,189 @@ GNU General Public License for more details.
 
 See LICENSE file for the full license text.
 *******************************************************************/
+#include <optional>
+
 #include "Project.hpp"
+#include "MappedFile.hpp"
+#include "XmlReader.hpp"
+#include "CompoundFile.hpp"
+#include "Hash.hpp"
+#include "Utf.hpp"
+#include "Render.hpp"
 
 
 namespace mswmm {
 
-Project::Project(std::string path) {
-  hasTitleSequences = false;
+static std::pmr::memory_resource* getMemoryResource(LoadOptions const& options) {
+  if (options.memoryResource) {
+    return options.memoryResource;
+  }
+  return std::pmr::get_default_resource();
+}
+
+
+
+Project::Project(LoadOptions const& options)
+  : recorder(options.collectStats ? std::make_unique<StatsRecorder>(getMemoryResource(options)) : nullptr),
+    statsCallback(options.statsCallback),
+    memoryResource(recorder ? recorder.get() : getMemoryResource(options)),
+    xmlTree(memoryResource),
+#ifdef MSWMM_WITH_QT
+    producerDat(memoryResource),
+#endif
+    uidIndex(memoryResource),
+    fileIdIndex(memoryResource),
+    fileSection(memoryResource),
+    videoSection(memoryResource),
+    audioSection(memoryResource),
+    titleSection(memoryResource),
+    intervalSection(memoryResource),
+    titleSequences(false)
+{
+}
+
 
-  std::ifstream file(path, std::ios_base::in | std::ios_base::binary);
-  if (!file.good()) {
-    throw std::runtime_error("Can't open file '" + path + "'.");
+
+Project::~Project() {
+  if (recorder && statsCallback) {
+    statsCallback(recorder->stats());
   }
+}
+
 
-  // Get file size.
-  file.seekg(0, file.end);
-  size_t length = file.tellg();
-  file.seekg(0, file.beg);
 
-  // Read file into buffer.
-  auto buffer = std::make_unique<char[]>(length);
-  file.read(buffer.get(), length);
-  // Create XML DOM.
+/**
+ * @brief Get the statistics of loading the project so far. Sections
+ * extracted later add their stages.
+ *
+ * @return LoadStats The statistics; all empty unless
+ * LoadOptions::collectStats was set.
+ */
+LoadStats Project::stats() const {
+  return recorder ? recorder->stats() : LoadStats();
+}
+
+
+
+/**
+ * @brief Load a project from a .MSWMM file.
+ *
+ * @param path Path to the file.
+ * @param options How to load the file.
+ */
+Project::Project(std::string path, LoadOptions const& options) : Project(options) {
+  if (recorder) {
+    recorder->path = path;
+  }
+  std::optional<ParseCache> cache;
+  if (!options.cacheDirectory.empty()) {
+    cache.emplace(options.cacheDirectory, path);
+    // The file didn't change, so it doesn't even have to be opened.
+    if (cache->isFresh() && loadModel(*cache)) {
+      return;
+    }
+  }
+
+  if (options.memoryMap) {
+    std::optional<MappedFile> mappedFile;
+    {
+      StageTimer timer(recorder.get(), Stage::READ_FILE);
+      mappedFile.emplace(path);
+      if (recorder) {
+        recorder->bytesRead += mappedFile->size();
+      }
+    }
+    if (cache) {
+      loadCached(mappedFile->data(), mappedFile->size(), *cache, options.xmlParser);
+    }
+    else {
+      load(readContainer(mappedFile->data(), mappedFile->size()), options.xmlParser);
+    }
+    return;
+  }
+  std::pmr::vector<char> buffer(memoryResource);
+  {
+    StageTimer timer(recorder.get(), Stage::READ_FILE);
+    std::ifstream file(path, std::ios_base::in | std::ios_base::binary);
+    if (!file.good()) {
+      throw std::runtime_error("Can't open file '" + path + "'.");
+    }
+
+    // Get file size.
+    file.seekg(0, file.end);
+    size_t length = file.tellg();
+    file.seekg(0, file.beg);
+
+    // Read file into buffer.
+    buffer.resize(length);
+    file.read(buffer.data(), length);
+    if (recorder) {
+      recorder->bytesRead += length;
+    }
+  }
+  size_t length = buffer.size();
+  if (cache) {
+    loadCached(buffer.data(), length, *cache, options.xmlParser);
+  }
+  else {
+    load(readContainer(buffer.data(), length), options.xmlParser);
+  }
+}
+
+
+
+/**
+ * @brief Load a project from the content of a .MSWMM file in memory.
+ *
+ * @param data The content of the file. It is not needed anymore
+ * after the constructor returns.
+ * @param length The size of the file in bytes.
+ * @param options How to load the file. LoadOptions::memoryMap and
+ * LoadOptions::cacheDirectory are ignored.
+ */
+Project::Project(char const* data, size_t length, LoadOptions const& options) : Project(options) {
+  load(readContainer(data, length), options.xmlParser);
+}
+
+
+
+/**
+ * @brief Create a project from an already parsed Producer.Dat.
+ * As the XML source is not known, printXml() can't be used.
+ *
+ * @param xml The element tree of Producer.Dat.
+ * @param options Only LoadOptions::memoryResource is used.
+ */
+Project::Project(XmlTree&& xml, LoadOptions const& options) : Project(options) {
+  xmlTree = std::move(xml);
+  analyzeXml();
+}
+
+
+
+/**
+ * @brief Get the project XML out of the CFB container.
+ *
+ * @param data The content of the .MSWMM file.
+ * @param length The size of the file in bytes.
+ * @return std::pmr::vector<char16_t> The raw Producer.Dat stream,
+ * followed by a zero.
+ */
+std::pmr::vector<char16_t> Project::readContainer(char const* data, size_t length) {
   try {
     // Parse CFB file.
-    CFB::CompoundFileReader reader(buffer.get(), length);
+    std::optional<CFB::CompoundFileReader> reader;
+    {
+      StageTimer timer(recorder.get(), Stage::PARSE_CONTAINER);
+      reader.emplace(data, length);
+    }
 
     // Get XML file defining the MSWMM project.
-    auto xmlStream = findStream(reader, "ProducerData\\Producer.Dat");
+    CFB::COMPOUND_FILE_ENTRY const* xmlStream;
+    {
+      StageTimer timer(recorder.get(), Stage::FIND_STREAM);
+      xmlStream = findStream(*reader, u"ProducerData\\Producer.Dat");
+    }
     if (!xmlStream) {
       throw mswmm::CorruptFileError("Can't find project definition XML (Producer.Dat).");
     }
@@ -49,272 +204,325 @@ Project::Project(std::string path) {
     if (xmlStream->size % 2 != 0) {
       throw mswmm::CorruptFileError("Project XML is not encoded as UTF-16.");
     }
-    // Read XML into buffer.
-    auto xmlBuffer = std::make_unique<char[]>(xmlStream->size+2);
-    reader.ReadFile(xmlStream, 0, xmlBuffer.get(), xmlStream->size);
-    // Add a zero termination for good measure, so
-    // QString::fromUtf16() definitely terminates.
-    xmlBuffer[xmlStream->size] = 0;
-    xmlBuffer[xmlStream->size+1] = 0;
-    auto xmlString = QString::fromUtf16((char16_t*)xmlBuffer.get()).trimmed();
-
-    // Parse XML.
-    QString errorStr;
-    int errorLine;
-    int errorCol;
-    if (!xmlDoc.setContent(xmlString, false, &errorStr, &errorLine, &errorCol)) {
-      std::string error = "Can't parse project XML (Producer.Dat) at line " +
-                          std::to_string(errorLine) +
-                          ", column " +
-                          std::to_string(errorCol) +
-                          ": " +
-                          errorStr.toStdString();
-      throw mswmm::CorruptFileError(error);
+    // Read XML into buffer. The buffer is zero initialized and has
+    // room for a zero termination, so the text definitely terminates.
+    StageTimer timer(recorder.get(), Stage::READ_STREAM);
+    std::pmr::vector<char16_t> xmlBuffer(xmlStream->size/2 + 1, memoryResource);
+    reader->ReadFile(xmlStream, 0, reinterpret_cast<char*>(xmlBuffer.data()), xmlStream->size);
+    if (recorder) {
+      recorder->producerDatBytes += xmlStream->size;
     }
+    return xmlBuffer;
   }
   catch (CFB::WrongFormat& e) {
     throw mswmm::CorruptFileError("Can't parse CFB container: " + std::string(e.what()));
   }
+}
+
 
+
+/**
+ * @brief Parse and analyze the project XML.
+ *
+ * @param producerDat The zero terminated Producer.Dat stream.
+ * @param parser The parser to use.
+ */
+void Project::load(std::pmr::vector<char16_t>&& producerDat, XmlParser parser) {
+  // The text ends at the first zero, like QString::fromUtf16() would
+  // see it.
+#ifdef MSWMM_WITH_QT
+  this->producerDat = std::move(producerDat);
+  auto xml = trimWhitespace(std::u16string_view(this->producerDat.data()));
+#else
+  auto xml = trimWhitespace(std::u16string_view(producerDat.data()));
+#endif
+  parseXml(xml, parser);
   analyzeXml();
 }
 
 
 
-Project::~Project() {
-  for (auto& ti: videoTimeline) {
-    delete ti;
+/**
+ * @brief Load a project through the cache: use the cached model if it
+ * was stored for the same Producer.Dat, otherwise parse the XML and
+ * store the model if all sections can be extracted.
+ *
+ * @param data The content of the .MSWMM file.
+ * @param length The size of the file in bytes.
+ * @param cache The cache entry of the file.
+ * @param parser The parser to use.
+ */
+void Project::loadCached(char const* data, size_t length, ParseCache const& cache, XmlParser parser) {
+  auto producerDat = readContainer(data, length);
+  uint64_t hash = hashBytes(producerDat.data(), (producerDat.size() - 1) * sizeof(char16_t));
+  if (cache.matches(hash) && loadModel(cache)) {
+    cache.refresh();
+    return;
+  }
+  load(std::move(producerDat), parser);
+  StageTimer timer(recorder.get(), Stage::STORE_CACHE);
+  std::string model;
+  try {
+    model = saveModel();
   }
-  for (auto& ti: audioTimeline) {
-    delete ti;
+  catch (std::exception const&) {
+    // A section can't be extracted. Its accessor throws the error
+    // again, just as without the cache, and the other sections stay
+    // usable. Only complete models are cached.
+    return;
   }
+  cache.store(hash, model);
 }
 
 
 
 void Project::printXml(std::ostream& target, uint8_t indent) const {
-  target << xmlDoc.toString(indent).toStdString();
+#ifdef MSWMM_WITH_QT
+  if (xmlDoc.documentElement().isNull()) {
+    if (xmlText.empty()) {
+      throw std::runtime_error("The XML source of this project is not available.");
+    }
+    parseDom();
+  }
+  std::string xml;
+  QString str = xmlDoc.toString(indent);
+  appendUtf8(xml, std::u16string_view(reinterpret_cast<char16_t const*>(str.utf16()), str.size()));
+  target << xml;
+#else
+  if (xmlTree.isEmpty()) {
+    throw std::runtime_error("The XML source of this project is not available.");
+  }
+  xmlTree.print(target, indent);
+#endif
 }
 
 
 
 void Project::printMetadata(std::ostream& target, uint8_t indent) const {
-  target << std::string(indent, ' ') << "Aspect ratio: " << aspectRatio.x << ":" << aspectRatio.y << '\n';
-  target << std::string(indent, ' ') << "Author: " << author << '\n';
-  target << std::string(indent, ' ') << "Title: " << title << '\n';
-  target << std::string(indent, ' ') << "Description: " << description << '\n';
-  target << std::string(indent, ' ') << "Copyright: " << copyright << '\n';
-  target << std::string(indent, ' ') << "Rating: " << rating << '\n';
+  Metadata const& m = metadata();
+  std::string i1(indent, ' ');
+  target << i1 << "Aspect ratio: " << m.aspectRatio.x << ":" << m.aspectRatio.y << '\n';
+  target << i1 << "Author: " << m.author << '\n';
+  target << i1 << "Title: " << m.title << '\n';
+  target << i1 << "Description: " << m.description << '\n';
+  target << i1 << "Copyright: " << m.copyright << '\n';
+  target << i1 << "Rating: " << m.rating << '\n';
 }
 
 
 
 void Project::printFiles(std::ostream& target, uint8_t indent) const {
-  for (auto const& f: sourceFiles) {
-    target << std::string(indent, ' ') << f << '\n';
+  std::string i1(indent, ' ');
+  for (auto const& f: sourceFiles()) {
+    target << i1 << f << '\n';
   }
 }
 
 
 
 void Project::printMediaTimeline(std::ostream& target, TrackType trackId, uint8_t indent) const {
-  std::vector<TimelineItem*> const* timeline;
+  Timeline const* timeline;
   switch (trackId) {
     case TrackType::VIDEO:
-      timeline = &videoTimeline;
+      timeline = &videoTimeline();
       break;
     case TrackType::AUDIO:
-      timeline = &audioTimeline;
+      timeline = &audioTimeline();
+      break;
+    case TrackType::SOMETHING:
+      timeline = &titleTimeline();
       break;
     default:
       return;
   }
 
-  for (auto const& ti: *timeline) {
-    ti->printItem(target, indent);
-  }
+  timeline->print(target, indent);
 }
 
 
 /**
  * @brief Generate an ffmpeg command to render the video described
- * in the Movie Maker project, if possible. Throws exceptions if not.
- * Only the video timeline is used for now.
+ * in the Movie Maker project, with the default RenderOptions.
+ * Throws exceptions if the project can't be rendered.
  *
- * @param substitutions A list of string substitutions that will be performed on the source file paths.
- * All occurrences of pair.first will be replaced with pair.second.
- * @return std::string The ffmpeg command.
+ * @param substitutions The string substitutions that will be performed on the source file paths.
+ * @return RenderPlan The ffmpeg command, or several for large
+ * projects, and the files they read.
  */
-std::string Project::generateFfmpegCommand(std::vector<std::pair<std::string, std::string>> substitutions) const {
-  if (videoTimeline.size() == 0) {
-    throw std::runtime_error("Empty video timeline.");
-  }
-  std::stringstream command;
-  std::stringstream transitionFilter;
-  std::vector<std::string> concatElements;
-  command << "ffmpeg ";
-
-  size lastSizePx;
-  bool hasImages = false;
-  bool hasVideos = false;
-  unsigned int i = 0;
-  unsigned int transitionCounter = 0;
-  float lastTimelineStart = 0;
-  float lastTimelineEnd = 0;
-
-  for (auto const& ti: videoTimeline) {
-    // Title sequences will be really difficult to include.
-    TimelineVideoItem* tvi = dynamic_cast<TimelineVideoItem*>(ti);
-    TimelineStillItem* tsi = dynamic_cast<TimelineStillItem*>(ti);
-    std::string path;
-    size currentSizePx;
-    if (tvi) {
-      hasVideos = true;
-      path = tvi->srcPath;
-      currentSizePx = tvi->srcSizePx;
-    }
-    else if (tsi) {
-      hasImages = true;
-      path = tsi->srcPath;
-      currentSizePx = tsi->srcSizePx;
-    }
-    else {
-      throw std::runtime_error("Only videos and images are currently supported on the timeline.");
-    }
+RenderPlan Project::generateFfmpegCommand(PathSubstitutions const& substitutions) const {
+  return mswmm::generateFfmpegCommand(*this, substitutions);
+}
 
-    if (hasVideos && hasImages) {
-      throw std::runtime_error("Timelines with both videos and images are not yet supported.");
-    }
-    if (i != 0 && currentSizePx != lastSizePx) {
-      throw std::runtime_error("Timeline items have different resolutions.");
-    }
 
-    // Replace substrings if requested.
-    for (auto const& sp: substitutions) {
-      while (true) {
-        size_t startPos = path.find(sp.first);
-        if (startPos == std::string::npos) {
-          break;
-        }
-        else {
-          path.replace(startPos, sp.first.length(), sp.second);
-        }
-      }
-    }
 
-    // Assemble transition filter.
-    bool hasTransition = false;
-    if (ti->timelineStart < lastTimelineEnd) {
-      // Transitions somewhat work on images.
-      // Two transitions on one timeline item do not work properly
-      // though: the transitions are there, but the item is
-      // duplicated. So this feature will stay deactivated for now.
-      // Also, ffmpeg eats enormous amounts of memory and the process
-      // has to be terminated, at least for bigger projects.
-      // Videos do not work as the audio stream is not dealt with
-      // properly.
-      hasTransition = true;
-      if (true || hasVideos) {
-        throw std::runtime_error("Timeline items overlap, but transitions are currently not supported.");
-        //throw std::runtime_error("Videos overlap, but transitions are currently only supported for images.");
-      }
-      // Example for transition filter:
-      // [1][2]xfade=transition=fade:duration=1:offset=1[t0];
-      // Take inputs 1 and 2, fade them, save result into t0
-      float lastDuration = lastTimelineEnd - lastTimelineStart;
-      float overlap = lastTimelineEnd - ti->timelineStart;
-      std::string transitionId = "[t" + std::to_string(transitionCounter++) + "]";
-      transitionFilter << '[' << i-1 << ']'
-                       << '[' << i   << ']'
-                       << "xfade=transition=fade"
-                       << ":duration=" << overlap
-                       << ":offset=" << lastDuration - overlap
-                       << transitionId << ';';
-      if (concatElements.back()[1] != 't') {
-        concatElements.pop_back();
-      }
-      concatElements.push_back(transitionId);
-    }
-
-    // Assemble command.
-    if (tvi) {
-      command << "-ss " << tvi->sourceStart
-              << " -to " << tvi->sourceEnd
-              << " -i '" << path << "' ";
-      std::string concatIds = (std::stringstream() << "[" << i << ":v][" << i << ":a]").str();
-      concatElements.push_back(concatIds);
-    }
-    else if (tsi) {
-      command << "-loop 1 -framerate 24 "
-              << "-t " << ti->timelineEnd - ti->timelineStart
-              << " -i '" << path << "' ";
-      if (!hasTransition) {
-        std::string concatId = (std::stringstream() << "[" << i << "]").str();
-        concatElements.push_back(concatId);
-      }
-    }
-
-    lastTimelineEnd = ti->timelineEnd;
-    lastTimelineStart = ti->timelineStart;
-    lastSizePx = currentSizePx;
-    ++i;
+/**
+ * @brief Build the element tree from the project XML.
+ *
+ * @param xml The trimmed content of Producer.Dat.
+ * @param parser Whether to use the embedded pull parser or to go
+ * through Qt's DOM, which is kept afterwards.
+ */
+void Project::parseXml(std::u16string_view xml, XmlParser parser) {
+#ifdef MSWMM_WITH_QT
+  xmlText = xml;
+  if (parser == XmlParser::DOM) {
+    parseDom();
+    xmlText = {};
+    std::pmr::vector<char16_t>(memoryResource).swap(producerDat);
+    StageTimer timer(recorder.get(), Stage::PARSE_XML);
+    readXmlDom(xmlDoc.documentElement(), xmlTree);
+    return;
   }
+#else
+  static_cast<void>(parser);
+#endif
+  StageTimer timer(recorder.get(), Stage::PARSE_XML);
+  readXml(xml, xmlTree);
+}
+
 
-  // Add filter.
-  command << "-filter_complex '" << transitionFilter.str();
-  for (auto const& e: concatElements) {
-    command << e;
+
+#ifdef MSWMM_WITH_QT
+
+/**
+ * @brief Build the DOM of the project XML.
+ */
+void Project::parseDom() const {
+  StageTimer timer(recorder.get(), Stage::BUILD_DOM);
+  QString xml = QString::fromRawData(reinterpret_cast<QChar const*>(xmlText.data()), xmlText.size());
+  QString errorStr;
+  int errorLine;
+  int errorCol;
+  if (!xmlDoc.setContent(xml, false, &errorStr, &errorLine, &errorCol)) {
+    std::string error = "Can't parse project XML (Producer.Dat) at line " +
+                        std::to_string(errorLine) +
+                        ", column " +
+                        std::to_string(errorCol) +
+                        ": " +
+                        errorStr.toStdString();
+    throw mswmm::CorruptFileError(error);
   }
-  command << "concat=n=" << concatElements.size()
-          << ":v=1:a=" << (int)hasVideos
-          << "' output.mp4";
-  return command.str();
 }
 
+#endif
 
 
+
+/**
+ * @brief Find the project definition in the XML tree. The sections
+ * are extracted from it by their accessors.
+ */
 void Project::analyzeXml() {
-  // Extract data from XML DOM.
-  auto xmlRoot = xmlDoc.documentElement();
-  auto dataStr = xmlRoot.firstChildElement("Project")
-                        .firstChildElement("DataStr");
+  StageTimer timer(recorder.get(), Stage::ANALYZE_XML);
+  auto xmlRoot = xmlTree.documentElement();
+  dataStr = xmlRoot.firstChildElement("Project")
+                   .firstChildElement("DataStr");
   if (dataStr.isNull()) {
     throw CorruptFileError("Can't find 'DataStr' XML tag, which should contain the entire project definition.");
   }
+}
+
+
+
+Metadata const& Project::metadata() const {
+  std::call_once(metadataOnce, [this] { getMetadata(); });
+  return metadataSection;
+}
+
 
 
-  getMetadata(dataStr);
-  getFileList(dataStr);
-  getMediaTimeline(dataStr, TrackType::VIDEO);
-  getMediaTimeline(dataStr, TrackType::AUDIO);
+std::pmr::vector<std::pmr::string> const& Project::sourceFiles() const {
+  std::call_once(filesOnce, [this] { getFileList(); });
+  return fileSection;
 }
 
 
 
-void Project::getMetadata(QDomElement const& dataStr) {
-  QDomElement producerProperties = dataStr.firstChildElement("ProducerProperties");
-  aspectRatio.x = producerProperties.attribute("ProjectAspectRatioX").toULong();
-  aspectRatio.y = producerProperties.attribute("ProjectAspectRatioY").toULong();
+Timeline const& Project::videoTimeline() const {
+  std::call_once(videoOnce, [this] {
+    std::call_once(indexOnce, [this] { buildIndex(); });
+    getMediaTimeline(TrackType::VIDEO);
+  });
+  return videoSection;
+}
+
+
+
+Timeline const& Project::audioTimeline() const {
+  std::call_once(audioOnce, [this] {
+    std::call_once(indexOnce, [this] { buildIndex(); });
+    getMediaTimeline(TrackType::AUDIO);
+  });
+  return audioSection;
+}
+
+
 
-  QDomElement n = producerProperties.firstChildElement("MetDat");
+Timeline const& Project::titleTimeline() const {
+  std::call_once(titleOnce, [this] {
+    std::call_once(indexOnce, [this] { buildIndex(); });
+    getMediaTimeline(TrackType::SOMETHING);
+  });
+  return titleSection;
+}
+
+
+
+/**
+ * @brief Get the index of the items of all timelines by time.
+ * This extracts all timelines.
+ */
+IntervalIndex const& Project::intervals() const {
+  std::call_once(intervalsOnce, [this] {
+    intervalSection.build({
+      {TrackType::VIDEO, &videoTimeline()},
+      {TrackType::AUDIO, &audioTimeline()},
+      {TrackType::SOMETHING, &titleTimeline()}
+    });
+  });
+  return intervalSection;
+}
+
+
+
+/**
+ * @brief Check if the video timeline contains title sequences.
+ * This extracts the video timeline.
+ */
+bool Project::hasTitleSequences() const {
+  videoTimeline();
+  return titleSequences;
+}
+
+
+
+void Project::getMetadata() const {
+  StageTimer timer(recorder.get(), Stage::METADATA);
+  // Start over, in case an earlier attempt threw.
+  metadataSection = Metadata();
+  Metadata& m = metadataSection;
+  auto producerProperties = dataStr.firstChildElement("ProducerProperties");
+  m.aspectRatio.x = producerProperties.ulongAttribute("ProjectAspectRatioX");
+  m.aspectRatio.y = producerProperties.ulongAttribute("ProjectAspectRatioY");
+
+  auto n = producerProperties.firstChildElement("MetDat");
   while (!n.isNull()) {
-    auto attr = n.attributes();
-    std::string key   = attr.namedItem("MDTag").nodeValue().toStdString();
-    std::string value = attr.namedItem("MDVal").nodeValue().toStdString();
+    std::string_view key = n.attribute("MDTag");
+    std::string value(n.attribute("MDVal"));
     if (key == "Author") {
-      author = value;
+      m.author = value;
     }
     else if (key == "PresentationTitle") {
-      title = value;
+      m.title = value;
     }
     else if (key == "Copyright") {
-      copyright = value;
+      m.copyright = value;
     }
     else if (key == "Rating") {
-      rating = value;
+      m.rating = value;
     }
     else if (key == "Description") {
-      description = value;
+      m.description = value;
     }
     n = n.nextSiblingElement("MetDat");
   }
@@ -322,222 +530,412 @@ void Project::getMetadata(QDomElement const& dataStr) {
 
 
 
-void Project::getFileList(QDomElement const& dataStr) {
-  QDomElement n = dataStr.firstChildElement("FileInfo");
+void Project::getFileList() const {
+  StageTimer timer(recorder.get(), Stage::FILES);
+  fileSection.clear();
+  auto n = dataStr.firstChildElement("FileInfo");
   while (!n.isNull()) {
-    auto src = n.attribute("SrceFn").toStdString();
-    sourceFiles.emplace_back(std::move(src));
+    fileSection.emplace_back(n.attribute("SrceFn"));
     n = n.nextSiblingElement("FileInfo");
   }
 }
 
 
 
-void Project::getMediaTimeline(QDomElement const& dataStr, TrackType trackId) {
-  std::vector<TimelineItem*>* timeline;
+void Project::getMediaTimeline(TrackType trackId) const {
+  Timeline* timeline;
+  Stage stage;
   switch (trackId) {
     case TrackType::VIDEO:
-      timeline = &videoTimeline;
+      timeline = &videoSection;
+      stage = Stage::VIDEO_TIMELINE;
       break;
     case TrackType::AUDIO:
-      timeline = &audioTimeline;
+      timeline = &audioSection;
+      stage = Stage::AUDIO_TIMELINE;
+      break;
+    case TrackType::SOMETHING:
+      timeline = &titleSection;
+      stage = Stage::TITLE_TIMELINE;
       break;
     default:
-      throw std::runtime_error("Other timelines than video and audio are currently not supported.");
+      throw std::runtime_error("Unknown timeline.");
   }
+  StageTimer timer(recorder.get(), stage);
+  // Start over, in case an earlier attempt threw.
+  *timeline = Timeline(memoryResource);
 
-  // Get video or audio track.
-  auto trackIdStr = QString::number(static_cast<uint>(trackId));
-  QDomElement n = getTagWithAttr(dataStr, "Track", "TrackTyp", trackIdStr);
+  // Get video, audio or title track.
+  auto trackIdStr = std::to_string(static_cast<uint>(trackId));
+  auto n = getTagWithAttr(dataStr, "Track", "TrackTyp", trackIdStr);
   if (n.isNull()) {
+    // Not every project might have a title track; it's just empty then.
+    if (trackId == TrackType::SOMETHING) {
+      return;
+    }
     std::string trackName = (trackId == TrackType::VIDEO ? "video" : "audio");
     throw CorruptFileError("Can't find " + trackName + " track!");
   }
 
   // Get array of timeline items.
   // May contain videos, images, audio files and title sequences.
-  QString videoArrUid = n.firstChildElement("TrkClips").attribute("UID");
-  QDomElement videoArr = getTagWithAttr(dataStr, "TIArr", "UID", videoArrUid);
+  auto videoArrUid = n.firstChildElement("TrkClips").attribute("UID");
+  auto videoArr = getTagWithUid("TIArr", videoArrUid);
   n = videoArr.firstChildElement("UID");
   for (; !n.isNull();  n = n.nextSiblingElement("UID")) {
-    // Traverse DOM to get all the elements that contain information
-    // regarding the current section on the timeline.
+    // Traverse XML tree to get all the elements that contain
+    // information regarding the current section on the timeline.
     // TiTitleSource doesn't have anything after tmlnItem, so
     // clipItem, avSource and fileInfo will all be null in that
     // case, and all attribute values taken from them will also be
     // as empty as possible.
-    QString tmlnItemUid = n.attribute("UID");
-    QDomElement tmlnItem = getTagWithAttr(dataStr, "", "UID", tmlnItemUid);
-    QString clipItemUid = tmlnItem.firstChildElement("ClipWMItem").attribute("UID");
-    QDomElement clipItem = getTagWithAttr(dataStr, "", "UID", clipItemUid);
-    QString avSourceUid = clipItem.firstChildElement("Srce").attribute("UID");
-    QDomElement avSource = getTagWithAttr(dataStr, "AVSource", "UID", avSourceUid);
-    QString fileInfoUid = avSource.attribute("FileID");
-    QDomElement fileInfo = getTagWithAttr(dataStr, "FileInfo", "FileID", fileInfoUid);
+    auto tmlnItemUid = n.attribute("UID");
+    auto tmlnItem = getTagWithUid("", tmlnItemUid);
+    auto clipItemUid = tmlnItem.firstChildElement("ClipWMItem").attribute("UID");
+    auto clipItem = getTagWithUid("", clipItemUid);
+    auto avSourceUid = clipItem.firstChildElement("Srce").attribute("UID");
+    auto avSource = getTagWithUid("AVSource", avSourceUid);
+    auto fileInfoUid = avSource.attribute("FileID");
+    auto fileInfo = getFileInfo(fileInfoUid);
 
     // Every timeline item has a start and end time.
-    float timelineStart = tmlnItem.attribute("TmlnSrt").toFloat();
-    float timelineEnd = tmlnItem.attribute("TmlnEnd").toFloat();
-
-    // Everything on the video timeline can have effects.
-    std::vector<std::string> effects = getEffects(dataStr, tmlnItem);
-
-    // Only images, videos and audio files have the following attributes.
-    std::string name = clipItem.attribute("ClpNam").toStdString();
-    std::string srcPath = fileInfo.attribute("SrceFn").toStdString();
-    size_t fileSizeKiB = avSource.attribute("FileSize").toULong();
-
-    // X and Y dimensions are only non-zero for images and videos.
-    mswmm::size srcSizePx {
-      avSource.attribute("SrcWidth").toULong(),
-      avSource.attribute("SrcHeight").toULong()
-    };
-
-    // Taking only parts of the input files is only possible
-    // for video and audio files.
-    float sourceStart = tmlnItem.attribute("ClpSrt").toFloat();
-    float sourceEnd = tmlnItem.attribute("ClpEnd").toFloat();
-
-    // I think the following attributes are only set for audio items.
-    bool isMuted = tmlnItem.attribute("TmlnMute").toInt();
-    bool fadesIn = tmlnItem.attribute("TmlnFadeIn").toInt();
-    bool fadesOut = tmlnItem.attribute("TmlnFadeOut").toInt();
-    float volume = tmlnItem.attribute("ClipVolume").toFloat();
-
+    float timelineStart = tmlnItem.floatAttribute("TmlnSrt");
+    float timelineEnd = tmlnItem.floatAttribute("TmlnEnd");
 
     auto tag = tmlnItem.tagName();
+    ItemType type;
     if (tag == "TiTitleSource") {
       if (trackId == TrackType::AUDIO) {
         throw CorruptFileError("Title sequence in audio timeline.");
       }
-      hasTitleSequences = true;
-      auto ti = new TimelineTitleItem;
-      ti->timelineStart = timelineStart;
-      ti->timelineEnd = timelineEnd;
-      ti->effects = std::move(effects);
-      timeline->push_back(ti);
+      if (trackId == TrackType::VIDEO) {
+        titleSequences = true;
+      }
+      type = ItemType::TITLE;
     }
     else if (tag == "TmlnStillItem") {
       if (trackId == TrackType::AUDIO) {
         throw CorruptFileError("Picture in audio timeline.");
       }
-      auto ti = new TimelineStillItem;
-      ti->timelineStart = timelineStart;
-      ti->timelineEnd = timelineEnd;
-      ti->name = name;
-      ti->srcPath = srcPath;
-      ti->fileSizeKiB = fileSizeKiB;
-      ti->srcSizePx = srcSizePx;
-      ti->effects = std::move(effects);
-      timeline->push_back(ti);
+      type = ItemType::STILL;
     }
     else if (tag == "TmlnVideoItem") {
-      auto ti = new TimelineVideoItem;
-
-      ti->timelineStart = timelineStart;
-      ti->timelineEnd = timelineEnd;
-      ti->name = name;
-      ti->srcPath = srcPath;
-      ti->fileSizeKiB = fileSizeKiB;
-      ti->srcSizePx = srcSizePx;
-      ti->sourceStart = sourceStart;
-      ti->sourceEnd = sourceEnd;
-      ti->effects = std::move(effects);
-      timeline->push_back(ti);
+      type = ItemType::VIDEO;
     }
     else if (tag == "TmlnAudioItem") {
-      auto ti = new TimelineAudioItem;
-      ti->timelineStart = timelineStart;
-      ti->timelineEnd = timelineEnd;
-      ti->name = name;
-      ti->srcPath = srcPath;
-      ti->fileSizeKiB = fileSizeKiB;
-      ti->srcSizePx = srcSizePx;
-      ti->sourceStart = sourceStart;
-      ti->sourceEnd = sourceEnd;
-      ti->fadesIn = fadesIn;
-      ti->fadesOut = fadesOut;
-      ti->isMuted = isMuted;
-      ti->volume = volume;
-      ti->effects = std::move(effects);
-      timeline->push_back(ti);
+      type = ItemType::AUDIO;
     }
     else {
-      throw CorruptFileError("Unknown timeline item '" + tag.toStdString() + "'.");
+      throw CorruptFileError("Unknown timeline item '" + std::string(tag) + "'.");
+    }
+
+    TimelineItem& ti = timeline->addItem(type);
+    ti.timelineStart = timelineStart;
+    ti.timelineEnd = timelineEnd;
+
+    if (type != ItemType::TITLE) {
+      // Only images, videos and audio files have the following attributes.
+      ti.name = timeline->intern(clipItem.attribute("ClpNam"));
+      ti.srcPath = timeline->intern(fileInfo.attribute("SrceFn"));
+      ti.fileSizeKiB = avSource.ulongAttribute("FileSize");
+      auto thumbnailUid = tmlnItem.firstChildElement("Thmb").attribute("UID");
+      auto thumbnail = getTagWithUid("Thmb", thumbnailUid);
+      ti.thumbnail = timeline->intern(thumbnail.attribute("ClipThumbnailFile"));
+      ti.link = timeline->intern(fileInfo.attribute("LinkPath"));
+
+      // X and Y dimensions are only non-zero for images and videos.
+      ti.srcSizePx = {
+        avSource.ulongAttribute("SrcWidth"),
+        avSource.ulongAttribute("SrcHeight")
+      };
+    }
+
+    // Taking only parts of the input files is only possible
+    // for video and audio files.
+    if (type == ItemType::VIDEO || type == ItemType::AUDIO) {
+      ti.sourceStart = tmlnItem.floatAttribute("ClpSrt");
+      ti.sourceEnd = tmlnItem.floatAttribute("ClpEnd");
+    }
+
+    // I think the following attributes are only set for audio items.
+    if (type == ItemType::AUDIO) {
+      ti.isMuted = tmlnItem.intAttribute("TmlnMute");
+      ti.fadesIn = tmlnItem.intAttribute("TmlnFadeIn");
+      ti.fadesOut = tmlnItem.intAttribute("TmlnFadeOut");
+      ti.volume = tmlnItem.floatAttribute("ClipVolume");
+    }
+
+    // Overlapping items refer to the transition between them, the
+    // left one with TAVTransitionRight and the right one with
+    // TAVTransition.
+    auto transitionUid = tmlnItem.firstChildElement("TAVTransition").attribute("UID");
+    auto transition = getTagWithUid("TiTransition", transitionUid);
+    if (!transition.isNull()) {
+      timeline->setTransition(transition.firstChildElement("TiTransitionPtr").attribute("TFXGuid"));
+    }
+
+    // Everything on the video timeline can have effects.
+    getEffects(tmlnItem, *timeline);
+
+    if (type == ItemType::TITLE) {
+      getTitle(tmlnItem, *timeline);
     }
   }
 }
 
 
 
-std::vector<std::string> Project::getEffects(QDomElement const& dataStr, QDomElement const& tmlnItem) {
-  std::vector<std::string> effects;
-
+void Project::getEffects(XmlTree::Element const& tmlnItem, Timeline& timeline) const {
   // Get effect array for this timeline item.
-  QString effectArrUid = tmlnItem.firstChildElement("TiEffectArr").attribute("UID");
-  QDomElement effectArr = getTagWithAttr(dataStr, "", "UID", effectArrUid);
+  auto effectArrUid = tmlnItem.firstChildElement("TiEffectArr").attribute("UID");
+  auto effectArr = getTagWithUid("", effectArrUid);
 
   // Iterate through effects and extract parameters.
-  QDomElement n = effectArr.firstChildElement("UID");
+  auto n = effectArr.firstChildElement("UID");
   while (!n.isNull()) {
-    QString effectUid = n.attribute("UID");
-    QDomElement effect = getTagWithAttr(dataStr, "TiEffect", "UID", effectUid);
-    QString name = effect.firstChildElement("TiEffectPtr").attribute("TFXGuid");
-    effects.push_back(name.toStdString());
+    auto effectUid = n.attribute("UID");
+    auto effect = getTagWithUid("TiEffect", effectUid);
+    auto name = effect.firstChildElement("TiEffectPtr").attribute("TFXGuid");
+    timeline.addEffect(name);
 
     n = n.nextSiblingElement("UID");
   }
-  return effects;
 }
 
 
 
 /**
-* @brief Get an XML DOM node that has a specific attribute.
+ * @brief Extract the text, font, animation and transitions of a title
+ * sequence as parameters of the item added last.
+ *
+ * None of the projects at hand contains a title, so nothing about
+ * their layout is assumed: every attribute of the title item, of the
+ * elements it contains and of those it refers to by UID, like its
+ * transitions, is kept. See getTitles() for the interpretation.
+ */
+void Project::getTitle(XmlTree::Element const& tmlnItem, Timeline& timeline) const {
+  getParameters(tmlnItem, "", timeline, 2);
+}
+
+
+
+/**
+ * @brief Add the attributes of an element and its parameter list to
+ * the item added last.
+ *
+ * @param element The element.
+ * @param prefix Prepended to the names of the attributes.
+ * @param timeline The timeline the item belongs to.
+ * @param depth How many levels of child elements are added, with
+ * their tag names prepended. Children that only carry a UID are
+ * replaced by the element they refer to.
+ */
+void Project::getParameters(XmlTree::Element const& element, std::string const& prefix, Timeline& timeline, int depth) const {
+  for (size_t i = 0; i < element.attributeCount(); ++i) {
+    auto name = element.attributeName(i);
+    if (name != "UID") {
+      timeline.addParameter(prefix + std::string(name), element.attributeValue(i));
+    }
+  }
+
+  auto n = element.firstChildElement();
+  for (; !n.isNull(); n = n.nextSiblingElement()) {
+    auto tag = n.tagName();
+    if (tag == "FXParamList") {
+      timeline.addParameter(prefix + std::string(n.attribute("FXParamName")), n.attribute("FXParamValue"));
+      continue;
+    }
+    // Effects and thumbnails are extracted on their own, and the
+    // track and the neighbours of transitions are no parameters.
+    if (depth == 0 || tag == "TiEffectArr" || tag == "Thmb" || tag == "ClipTrack" || tag == "TTFrom" || tag == "TTTo") {
+      continue;
+    }
+    auto child = n;
+    if (n.attributeCount() == 1 && n.hasAttribute("UID")) {
+      child = getTagWithUid("", n.attribute("UID"));
+    }
+    getParameters(child, prefix + std::string(tag) + ".", timeline, depth - 1);
+  }
+}
+
+
+
+/**
+ * @brief Index all children of DataStr by their UID attribute, and
+ * FileInfo tags by their FileID attribute, in a single pass.
+ * Timeline items, clips, sources and effects reference each other
+ * via these IDs, so resolving them through the index keeps loading
+ * linear in the size of the project.
+ */
+void Project::buildIndex() const {
+  StageTimer timer(recorder.get(), Stage::BUILD_INDEX);
+  uidIndex.clear();
+  fileIdIndex.clear();
+
+  auto n = dataStr.firstChildElement();
+  for (; !n.isNull(); n = n.nextSiblingElement()) {
+    // Keep the first tag with a given ID, just like a linear search
+    // would. The string views point into the XML tree.
+    auto uid = n.attribute("UID");
+    if (!uid.empty()) {
+      uidIndex.emplace(uid, n);
+    }
+    if (n.tagName() == "FileInfo") {
+      auto fileId = n.attribute("FileID");
+      if (!fileId.empty()) {
+        fileIdIndex.emplace(fileId, n);
+      }
+    }
+  }
+}
+
+
+
+/**
+ * @brief Get a child of DataStr by its UID.
+ *
+ * @param tag The name the tag must have; any tag matches if empty.
+ * @param uid The UID of the tag.
+ * @return XmlTree::Element The element found; might be Null.
+ */
+XmlTree::Element Project::getTagWithUid(std::string_view tag, std::string_view uid) const {
+  if (recorder) {
+    ++recorder->uidLookups;
+  }
+  auto it = uidIndex.find(uid);
+  if (it == uidIndex.end()) {
+    return XmlTree::Element();
+  }
+  if (!tag.empty() && it->second.tagName() != tag) {
+    return XmlTree::Element();
+  }
+  return it->second;
+}
+
+
+
+/**
+ * @brief Get the FileInfo tag with the given FileID.
+ *
+ * @param fileId The FileID, as referenced by AVSource tags.
+ * @return XmlTree::Element The element found; might be Null.
+ */
+XmlTree::Element Project::getFileInfo(std::string_view fileId) const {
+  if (recorder) {
+    ++recorder->uidLookups;
+  }
+  auto it = fileIdIndex.find(fileId);
+  if (it == fileIdIndex.end()) {
+    return XmlTree::Element();
+  }
+  return it->second;
+}
+
+
+
+/**
+* @brief Get an XML element that has a specific attribute.
 *
 * @param parent The parent to search.
 * @param tag The name of the tag searched.
 * @param attr The name of the attribute that tag should carry.
 * @param attrVal The value the attribute must have.
-* @return QDomElement The first DOM element found; might be Null.
+* @return XmlTree::Element The first element found; might be Null.
 */
-QDomElement Project::getTagWithAttr(QDomNode const& parent, QString tag, QString attr, QString attrVal) const {
-  QDomElement n = parent.firstChildElement(tag);
+XmlTree::Element Project::getTagWithAttr(XmlTree::Element const& parent, std::string_view tag, std::string_view attr, std::string_view attrVal) const {
+  auto n = parent.firstChildElement(tag);
+  uint64_t visited = 0;
   while (!n.isNull()) {
+    ++visited;
     if (n.hasAttribute(attr) && n.attribute(attr) == attrVal) {
       break;
     }
     n = n.nextSiblingElement(tag);
   }
+  if (recorder) {
+    ++recorder->tagLookups;
+    recorder->siblingsVisited += visited;
+  }
   return n;
 }
 
 
 
-CFB::COMPOUND_FILE_ENTRY const* Project::findStream(CFB::CompoundFileReader const& reader, char const* streamName) const {
-  CFB::COMPOUND_FILE_ENTRY const* ret = nullptr;
-  reader.EnumFiles(reader.GetRootEntry(), -1, [&](CFB::COMPOUND_FILE_ENTRY const* entry,
-                                                  CFB::utf16string const& u16dir,
-                                                  [[maybe_unused]] int level)
-                                                  ->void
-  {
-    if (reader.IsStream(entry)) {
-      std::string name = UTF16ToUTF8(entry->name);
-      if (u16dir.length() > 0) {
-        std::string dir = UTF16ToUTF8(u16dir.c_str());
-        bool dirMatches = !strncmp(streamName, dir.c_str(), dir.length());
-        bool hasBackslash = streamName[dir.length()] == '\\';
-        bool nameMatches = !strcmp(streamName + dir.length() + 1, name.c_str());
-        if (dirMatches && hasBackslash && nameMatches) {
-          ret = entry;
-        }
-      }
-      else if (strcmp(streamName, name.c_str()) == 0) {
-        ret = entry;
-      }
+/**
+ * @brief Serialize everything extracted from the XML.
+ *
+ * @return std::string The model, as loadModel() reads it.
+ */
+std::string Project::saveModel() const {
+  std::string model;
+  BinaryWriter writer(model);
+  Metadata const& m = metadata();
+  writer.u8(hasTitleSequences());
+  writer.u64(m.aspectRatio.x);
+  writer.u64(m.aspectRatio.y);
+  writer.string(m.author);
+  writer.string(m.title);
+  writer.string(m.description);
+  writer.string(m.copyright);
+  writer.string(m.rating);
+  writer.u32(sourceFiles().size());
+  for (auto const& f: sourceFiles()) {
+    writer.string(f);
+  }
+  videoTimeline().save(writer);
+  audioTimeline().save(writer);
+  titleTimeline().save(writer);
+  return model;
+}
+
+
+
+/**
+ * @brief Fill all sections of the project from a cached model.
+ *
+ * @param cache The cache entry to load from.
+ * @return bool Whether the model could be loaded. If not, the
+ * sections are left for the accessors to extract.
+ */
+bool Project::loadModel(ParseCache const& cache) {
+  StageTimer timer(recorder.get(), Stage::LOAD_CACHE);
+  try {
+    BinaryReader reader = cache.model();
+    Metadata& m = metadataSection;
+    titleSequences = reader.u8();
+    m.aspectRatio.x = reader.u64();
+    m.aspectRatio.y = reader.u64();
+    m.author = reader.string();
+    m.title = reader.string();
+    m.description = reader.string();
+    m.copyright = reader.string();
+    m.rating = reader.string();
+    uint32_t fileCount = reader.u32();
+    for (uint32_t i = 0; i < fileCount; ++i) {
+      fileSection.emplace_back(reader.string());
     }
-  });
-  return ret;
+    videoSection.load(reader);
+    audioSection.load(reader);
+    titleSection.load(reader);
+    if (!reader.atEnd()) {
+      throw CorruptFileError("Unexpected data after the model.");
+    }
+  }
+  catch (CorruptFileError&) {
+    titleSequences = false;
+    metadataSection = Metadata();
+    fileSection.clear();
+    videoSection = Timeline(memoryResource);
+    audioSection = Timeline(memoryResource);
+    titleSection = Timeline(memoryResource);
+    return false;
+  }
+
+  // Everything is there, so the accessors have nothing left to do.
+  for (std::once_flag* once: {&indexOnce, &metadataOnce, &filesOnce, &videoOnce, &audioOnce, &titleOnce}) {
+    std::call_once(*once, [] {});
+  }
+  return true;
 }
 
 } // Namespace mswmm
@@ -21,61 +21,184 @@ See LICENSE file for the full license text.
 #include <vector>
 #include <sstream>
 #include <fstream>
+#include <mutex>
+#include <memory>
+#include <functional>
 #include <stdexcept>
+#include <string_view>
+#include <unordered_map>
+#include <memory_resource>
 
+#ifdef MSWMM_WITH_QT
 #include <qdom.h>
+#endif
 
 #include "compoundfilereader.h"
-#include "utf.h"
-#include "TimelineItem.hpp"
+#include "Error.hpp"
+#include "XmlTree.hpp"
+#include "ParseCache.hpp"
+#include "Stats.hpp"
+#include "Timeline.hpp"
+#include "IntervalIndex.hpp"
+#include "PathSubstitutions.hpp"
 
 
 namespace mswmm {
 
-struct CorruptFileError : public std::runtime_error {
-  CorruptFileError(std::string desc) : std::runtime_error(desc) {}
-};
+struct RenderPlan;
 
 
 
 enum class TrackType {
   VIDEO = 0,
   AUDIO = 1,
-  SOMETHING = 5 // This is probably the title overlay timeline, but not sure
+  SOMETHING = 5 // The title overlay timeline
+};
+
+
+
+// Qt's DOM is only available if the library is built with Qt
+// (MSWMM_WITH_QT); otherwise, DOM is the same as STREAM.
+enum class XmlParser {
+  STREAM, // Embedded pull parser; the DOM is only built if the XML is printed
+  DOM     // Build Qt's DOM while loading and keep it
+};
+
+
+
+struct LoadOptions {
+  XmlParser xmlParser = XmlParser::STREAM;
+  // Map the file into memory instead of reading all of it, so only
+  // the parts of the CFB container that are needed get loaded. On
+  // Windows, MappedFile reads the whole file instead.
+  bool memoryMap = false;
+  // Where the project allocates its buffers, element tree, indexes
+  // and timelines from, e.g. a std::pmr::monotonic_buffer_resource
+  // that is reset after each file. Uses the default resource if null.
+  // Qt's DOM always uses the regular heap.
+  // Sections of the project are extracted on first access, and may be
+  // accessed from several threads at once; the resource then has to
+  // be thread-safe, like std::pmr::synchronized_pool_resource.
+  std::pmr::memory_resource* memoryResource = nullptr;
+  // Directory of a cache for the extracted model, so unchanged files
+  // don't have to be parsed again. Only used when loading from a path.
+  // Projects loaded from the cache can't print their XML.
+  std::string cacheDirectory;
+  // Measure the loading stages and count allocations and lookups,
+  // see Project::stats(). Costs a little time.
+  bool collectStats = false;
+  // Called with the statistics when the project is destroyed, so
+  // code that only gets the options, like batch jobs, can report
+  // them. Must not throw.
+  std::function<void(LoadStats const&)> statsCallback;
+};
+
+
+
+struct Metadata {
+  size aspectRatio;
+  std::string author;
+  std::string title;
+  std::string description;
+  std::string copyright;
+  std::string rating;
 };
 
 
 
+/**
+ * @brief A Movie Maker project.
+ *
+ * Loading a project only parses its XML. Each section (metadata,
+ * source files, timelines) is extracted on first access and kept
+ * afterwards, so callers only pay for what they use. Accessors can be
+ * called from several threads at once. Errors in a section are thrown
+ * by its accessor.
+ */
 class Project {
   public:
-    Project(std::string path);
+    Project(std::string path, LoadOptions const& options = LoadOptions());
+    Project(char const* data, size_t length, LoadOptions const& options = LoadOptions());
+    Project(XmlTree&& xml, LoadOptions const& options = LoadOptions());
     ~Project();
+    Project(Project const&) = delete;
+    Project& operator=(Project const&) = delete;
     void printXml(std::ostream& target, uint8_t indent = 2) const;
     void printMetadata(std::ostream& target, uint8_t indent = 0) const;
     void printFiles(std::ostream& target, uint8_t indent = 0) const;
     void printMediaTimeline(std::ostream& target, TrackType trackId, uint8_t indent = 0) const;
-    std::string generateFfmpegCommand(std::vector<std::pair<std::string, std::string>> substitutions) const;
-
-    bool hasTitleSequences;
-    size aspectRatio;
-    std::string author;
-    std::string title;
-    std::string description;
-    std::string copyright;
-    std::string rating;
-    std::vector<std::string> sourceFiles;
-    std::vector<mswmm::TimelineItem*> videoTimeline;
-    std::vector<mswmm::TimelineItem*> audioTimeline;
+    RenderPlan generateFfmpegCommand(PathSubstitutions const& substitutions = PathSubstitutions()) const;
+
+    Metadata const& metadata() const;
+    std::pmr::vector<std::pmr::string> const& sourceFiles() const;
+    Timeline const& videoTimeline() const;
+    Timeline const& audioTimeline() const;
+    Timeline const& titleTimeline() const;
+    bool hasTitleSequences() const;
+    IntervalIndex const& intervals() const;
+    LoadStats stats() const;
+
   private:
+    Project(LoadOptions const& options);
+    std::pmr::vector<char16_t> readContainer(char const* data, size_t length);
+    void load(std::pmr::vector<char16_t>&& producerDat, XmlParser parser);
+    void loadCached(char const* data, size_t length, ParseCache const& cache, XmlParser parser);
+    void parseXml(std::u16string_view xml, XmlParser parser);
+#ifdef MSWMM_WITH_QT
+    void parseDom() const;
+#endif
     void analyzeXml();
-    void getMetadata(QDomElement const& dataStr);
-    void getFileList(QDomElement const& dataStr);
-    void getMediaTimeline(QDomElement const& dataStr, TrackType trackId);
-    std::vector<std::string> getEffects(QDomElement const& dataStr, QDomElement const& tmlnItem);
-    QDomElement getTagWithAttr(QDomNode const& parent, QString tag, QString attr, QString attrVal) const;
-    CFB::COMPOUND_FILE_ENTRY const* findStream(CFB::CompoundFileReader const& reader, char const* targetName) const;
-
-    QDomDocument xmlDoc;
+    void getMetadata() const;
+    void getFileList() const;
+    void getMediaTimeline(TrackType trackId) const;
+    void getEffects(XmlTree::Element const& tmlnItem, Timeline& timeline) const;
+    void getTitle(XmlTree::Element const& tmlnItem, Timeline& timeline) const;
+    void getParameters(XmlTree::Element const& element, std::string const& prefix, Timeline& timeline, int depth) const;
+    void buildIndex() const;
+    XmlTree::Element getTagWithUid(std::string_view tag, std::string_view uid) const;
+    XmlTree::Element getFileInfo(std::string_view fileId) const;
+    XmlTree::Element getTagWithAttr(XmlTree::Element const& parent, std::string_view tag, std::string_view attr, std::string_view attrVal) const;
+    std::string saveModel() const;
+    bool loadModel(ParseCache const& cache);
+
+    // Null unless statistics are collected. It wraps the memory
+    // resource, so it is created first.
+    std::unique_ptr<StatsRecorder> recorder;
+    std::function<void(LoadStats const&)> statsCallback;
+    std::pmr::memory_resource* memoryResource;
+    XmlTree xmlTree;
+    // The element containing the entire project definition.
+    XmlTree::Element dataStr;
+#ifdef MSWMM_WITH_QT
+    // The DOM is expensive, so unless requested, it is only built
+    // from the XML source when printXml() needs it. The source is the
+    // Producer.Dat stream as read; xmlText refers to the trimmed XML
+    // in it without copying. Without Qt, printXml() writes the element
+    // tree, and the stream is dropped after parsing.
+    std::pmr::vector<char16_t> producerDat;
+    std::u16string_view xmlText;
+    mutable QDomDocument xmlDoc;
+#endif
+    // Children of DataStr, indexed by their UID attribute and, for
+    // FileInfo tags, by their FileID attribute.
+    mutable std::pmr::unordered_map<std::string_view, XmlTree::Element> uidIndex;
+    mutable std::pmr::unordered_map<std::string_view, XmlTree::Element> fileIdIndex;
+
+    // Extracted sections, each filled once by the first accessor call.
+    mutable std::once_flag indexOnce;
+    mutable std::once_flag metadataOnce;
+    mutable std::once_flag filesOnce;
+    mutable std::once_flag videoOnce;
+    mutable std::once_flag audioOnce;
+    mutable std::once_flag titleOnce;
+    mutable std::once_flag intervalsOnce;
+    mutable Metadata metadataSection;
+    mutable std::pmr::vector<std::pmr::string> fileSection;
+    mutable Timeline videoSection;
+    mutable Timeline audioSection;
+    mutable Timeline titleSection;
+    mutable IntervalIndex intervalSection;
+    mutable bool titleSequences;
 };
 
 } // Namespace mswmm
@@ -0,0 +1,748 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#include <cctype>
+#include <charconv>
+#include <vector>
+#include <optional>
+#include <algorithm>
+#include <stdexcept>
+#include <filesystem>
+
+#include "Render.hpp"
+#include "Titles.hpp"
+#include "ParseCache.hpp"
+
+
+namespace mswmm {
+
+// Shorter overlaps and gaps are rounding errors of the project.
+static constexpr float epsilon = 0.001f;
+
+
+
+/**
+ * @brief Format a time or factor for the command line, with up to
+ * millisecond precision.
+ */
+static std::string number(double value) {
+  // Not printf, as a locale with a decimal comma would split the
+  // filter graph.
+  char buffer[32];
+  auto result = std::to_chars(buffer, buffer + sizeof(buffer), value, std::chars_format::fixed, 3);
+  std::string str(buffer, result.ptr);
+  str.erase(str.find_last_not_of('0') + 1);
+  if (str.back() == '.') {
+    str.pop_back();
+  }
+  return str;
+}
+
+
+
+static std::string shellQuote(std::string_view str) {
+  std::string quoted = "'";
+  for (char c: str) {
+    if (c == '\'') {
+      quoted += "'\\''";
+    }
+    else {
+      quoted += c;
+    }
+  }
+  quoted += '\'';
+  return quoted;
+}
+
+
+
+/**
+ * @brief Escape the value of a filter option, once for the option
+ * parser of the filter and once more for the filter graph parser.
+ */
+static std::string filterValue(std::string_view value) {
+  std::string option;
+  for (char c: value) {
+    if (c == '\\' || c == '\'' || c == ':') {
+      option += '\\';
+    }
+    option += c;
+  }
+  std::string escaped;
+  for (char c: option) {
+    if (c == '\\' || c == '\'' || c == '[' || c == ']' || c == ',' || c == ';') {
+      escaped += '\\';
+    }
+    escaped += c;
+  }
+  return escaped;
+}
+
+
+
+/**
+ * @brief The length of a project: the end of the last item on any track.
+ */
+static float projectLength(Project const& project) {
+  float length = 0;
+  for (Timeline const* timeline: {&project.videoTimeline(), &project.audioTimeline()}) {
+    for (auto const& item: *timeline) {
+      length = std::max(length, item.timelineEnd);
+    }
+  }
+  if (length <= epsilon) {
+    throw std::runtime_error("Empty video and audio timelines.");
+  }
+  return length;
+}
+
+
+
+/**
+ * @brief Builds the ffmpeg command line and filter graph that render
+ * a time range of a project.
+ */
+class FilterGraph {
+  public:
+    FilterGraph(Project const& project, PathSubstitutions const& substitutions, RenderOptions const& options,
+                float begin, float end, std::string const& output, bool silence);
+    std::string graph() const;
+    std::string command(std::string const& script) const;
+
+  private:
+    size_t addInput(std::string const& arguments, std::string_view path);
+    std::optional<MediaInfo> probe(std::string_view path) const;
+    std::string black(float duration) const;
+    void addVideoTrack(Timeline const& timeline);
+    void addVideoItem(Timeline const& timeline, TimelineItem const& item, size_t i, float head, float tail);
+    void addAudio(size_t input, float start, float duration, float volume, bool fadeIn, bool fadeOut);
+    void addTitles(Project const& project);
+    std::string label(char kind, size_t i, char part = 0) const;
+
+    PathSubstitutions const& substitutions;
+    RenderOptions const& options;
+    std::string sizeFilter;
+    std::string frameSize;
+    // The time range rendered. Items of the video track have to lie
+    // completely inside of it; audio items are cut.
+    float begin;
+    float end;
+    std::string output;
+    std::string inputs;
+    size_t inputCount;
+    // Filter chains, separated by semicolons in the graph.
+    std::vector<std::string> chains;
+    // Labels of the video pieces and audio streams, in timeline order.
+    std::vector<std::string> pieces;
+    std::vector<std::string> audioStreams;
+    // drawtext filters applied to the joined video.
+    std::vector<std::string> titles;
+};
+
+
+
+/**
+ * @param begin Start of the time range to render.
+ * @param end End of the time range to render.
+ * @param output The file to write.
+ * @param silence Always add an audio stream, even if nothing plays.
+ */
+FilterGraph::FilterGraph(Project const& project, PathSubstitutions const& substitutions, RenderOptions const& options,
+                         float begin, float end, std::string const& output, bool silence)
+  : substitutions(substitutions), options(options), begin(begin), end(end), output(output), inputCount(0)
+{
+  Timeline const& video = project.videoTimeline();
+  Timeline const& audio = project.audioTimeline();
+
+  // Everything is scaled into a frame of the project's aspect ratio,
+  // keeping the aspect ratio of the source and padding with black.
+  size aspectRatio = project.metadata().aspectRatio;
+  if (aspectRatio.x == 0 || aspectRatio.y == 0) {
+    aspectRatio = {4, 3};
+  }
+  size_t height = options.height / 2 * 2;
+  size_t width = (height * aspectRatio.x / aspectRatio.y + 1) / 2 * 2;
+  if (height == 0 || width == 0 || options.frameRate == 0) {
+    throw std::runtime_error("Invalid output size or frame rate.");
+  }
+  std::string w = std::to_string(width);
+  std::string h = std::to_string(height);
+  frameSize = w + "x" + h;
+  sizeFilter = "scale=" + w + ":" + h + ":force_original_aspect_ratio=decrease,"
+               "pad=" + w + ":" + h + ":(ow-iw)/2:(oh-ih)/2,setsar=1,"
+               "fps=" + std::to_string(options.frameRate) + ",format=yuv420p";
+
+  addVideoTrack(video);
+  if (options.titles) {
+    addTitles(project);
+  }
+
+  for (auto const& item: audio) {
+    float start = std::max(item.timelineStart, begin);
+    float stop = std::min(item.timelineEnd, end);
+    float duration = stop - start;
+    if (item.type != ItemType::AUDIO || item.isMuted || item.volume <= 0 || duration <= epsilon) {
+      continue;
+    }
+    std::optional<MediaInfo> info = probe(audio.srcPath(item));
+    if (info && !info->hasAudio) {
+      continue;
+    }
+    // Fades are only applied if the range contains the start or end
+    // of the item.
+    float sourceStart = item.sourceStart + (start - item.timelineStart);
+    size_t input = addInput("-ss " + number(sourceStart) + " -to " + number(sourceStart + duration), audio.srcPath(item));
+    addAudio(input, start - begin, duration, item.volume,
+             item.fadesIn && start - item.timelineStart < epsilon,
+             item.fadesOut && item.timelineEnd - stop < epsilon);
+  }
+
+  if (silence) {
+    std::string stream = label('a', audioStreams.size());
+    chains.push_back("anullsrc=r=48000:cl=stereo,atrim=duration=" + number(end - begin) + ",aformat=sample_fmts=fltp" + stream);
+    audioStreams.push_back(stream);
+  }
+}
+
+
+
+std::string FilterGraph::label(char kind, size_t i, char part) const {
+  std::string str = "[";
+  str += kind;
+  str += std::to_string(i);
+  if (part) {
+    str += part;
+  }
+  str += ']';
+  return str;
+}
+
+
+
+size_t FilterGraph::addInput(std::string const& arguments, std::string_view path) {
+  inputs += arguments + " -i " + shellQuote(substitutions.apply(path)) + " ";
+  return inputCount++;
+}
+
+
+
+/**
+ * @brief Probe a source file, if RenderOptions::probe is set. Throws
+ * if it doesn't exist, as ffmpeg would fail on it anyway.
+ */
+std::optional<MediaInfo> FilterGraph::probe(std::string_view path) const {
+  if (!options.probe) {
+    return std::nullopt;
+  }
+  std::string substituted = substitutions.apply(path);
+  MediaInfo info = options.probe->probe(substituted);
+  if (!info.found) {
+    throw std::runtime_error("Source file '" + substituted + "' not found.");
+  }
+  return info;
+}
+
+
+
+/**
+ * @brief A black source filter, for gaps and title sequences.
+ */
+std::string FilterGraph::black(float duration) const {
+  return "color=c=black:s=" + frameSize + ":r=" + std::to_string(options.frameRate) +
+         ":d=" + number(duration) + ",format=yuv420p,setsar=1";
+}
+
+
+
+/**
+ * @brief Lay out the video track as a sequence of pieces.
+ *
+ * Chaining xfade filters over a whole timeline keeps every earlier
+ * item of the chain alive and makes ffmpeg's memory use explode. So
+ * each item is cut into a head overlapping the previous item, a body,
+ * and a tail overlapping the next item. Each transition crossfades
+ * only a tail and the following head, and all pieces are joined by a
+ * single concat filter, which consumes them one after another.
+ * ffmpeg still opens all inputs of a command at once, which is why
+ * the number of inputs per command is limited, see findCuts().
+ *
+ * @param timeline The video timeline. The video is padded with black
+ * to the end of the time range.
+ */
+void FilterGraph::addVideoTrack(Timeline const& timeline) {
+  std::vector<size_t> items;
+  for (size_t i = 0; i < timeline.size(); ++i) {
+    TimelineItem const& item = timeline[i];
+    if (item.timelineEnd - item.timelineStart > epsilon
+        && item.timelineStart > begin - epsilon && item.timelineEnd < end + epsilon) {
+      items.push_back(i);
+    }
+  }
+
+  float position = begin;
+  float head = 0;
+  for (size_t k = 0; k < items.size(); ++k) {
+    TimelineItem const& item = timeline[items[k]];
+    float duration = item.timelineEnd - item.timelineStart;
+    if (item.timelineStart > position + epsilon) {
+      std::string gap = label('g', k);
+      chains.push_back(black(item.timelineStart - position) + gap);
+      pieces.push_back(gap);
+    }
+    // The transition is as long as the overlap, but never longer than
+    // what is left of this item or the next one. Transitions only
+    // join two items; a third one can't be mixed in.
+    float tail = 0;
+    if (k+1 < items.size()) {
+      TimelineItem const& next = timeline[items[k+1]];
+      if (k+2 < items.size() && timeline[items[k+2]].timelineStart < item.timelineEnd - epsilon) {
+        throw std::runtime_error("Three items of the video track overlap at " +
+                                 number(timeline[items[k+2]].timelineStart) + "s.");
+      }
+      float overlap = item.timelineEnd - next.timelineStart;
+      tail = std::clamp(overlap, 0.0f, std::min(duration - head, next.timelineEnd - next.timelineStart));
+      if (tail <= epsilon) {
+        tail = 0;
+      }
+    }
+    addVideoItem(timeline, item, k, head, tail);
+    position = std::max(position, item.timelineEnd);
+    head = tail;
+  }
+
+  if (end > position + epsilon) {
+    std::string gap = label('g', items.size());
+    chains.push_back(black(end - position) + gap);
+    pieces.push_back(gap);
+  }
+}
+
+
+
+/**
+ * @brief Add the filters of one item of the video track.
+ *
+ * @param timeline The video timeline.
+ * @param item The item.
+ * @param i Number of the item, for the labels.
+ * @param head Seconds overlapping the previous item.
+ * @param tail Seconds overlapping the next item.
+ */
+void FilterGraph::addVideoItem(Timeline const& timeline, TimelineItem const& item, size_t i, float head, float tail) {
+  float duration = item.timelineEnd - item.timelineStart;
+
+  // Effect filters work on the source before it is fitted into the
+  // frame, so they may change its size, e.g. by rotating it. Fades
+  // are timed relative to the trimmed item.
+  std::string filters;
+  std::string fades;
+  float fade = std::min(options.fadeDuration, duration / 2);
+  for (size_t e = 0; e < item.effectCount; ++e) {
+    EffectInfo const& effect = effectInfo(timeline.effectId(item, e));
+    switch (effect.type) {
+      case EffectType::FILTER:
+        filters += std::string(effect.filter) + ',';
+        break;
+      case EffectType::FADE_IN:
+        fades += ",fade=t=in:st=0:d=" + number(fade) + ":c=" + std::string(effect.filter);
+        break;
+      case EffectType::FADE_OUT:
+        fades += ",fade=t=out:st=" + number(duration - fade) + ":d=" + number(fade) + ":c=" + std::string(effect.filter);
+        break;
+      default:
+        // Not rendered.
+        break;
+    }
+  }
+
+  std::string chain;
+  if (item.type == ItemType::STILL) {
+    probe(timeline.srcPath(item));
+    size_t input = addInput("-loop 1 -framerate " + std::to_string(options.frameRate) + " -t " + number(duration),
+                            timeline.srcPath(item));
+    chain = "[" + std::to_string(input) + ":v]" + filters + sizeFilter;
+  }
+  else if (item.type == ItemType::VIDEO) {
+    std::optional<MediaInfo> info = probe(timeline.srcPath(item));
+    size_t input = addInput("-ss " + number(item.sourceStart) + " -to " + number(item.sourceEnd),
+                            timeline.srcPath(item));
+    chain = "[" + std::to_string(input) + ":v]" + filters + sizeFilter;
+    // A source that ends early holds its last frame, so the following
+    // items stay in place.
+    if (info && info->duration > 0 && item.sourceEnd > info->duration + epsilon) {
+      chain += ",tpad=stop_mode=clone:stop=-1";
+    }
+    if (options.videoAudio && (!info || info->hasAudio)) {
+      addAudio(input, item.timelineStart - begin, duration, 1, false, false);
+    }
+  }
+  else {
+    // The text is drawn by addTitles(), if at all.
+    chain = black(duration);
+    if (!filters.empty()) {
+      chain += "," + filters + sizeFilter;
+    }
+  }
+  chain += ",trim=duration=" + number(duration) + ",setpts=PTS-STARTPTS" + fades;
+
+  // Cut the item into its pieces. Each part gets a lower case label
+  // out of the split and an upper case one once it is trimmed.
+  float bodyEnd = duration - tail;
+  bool hasBody = bodyEnd - head > epsilon;
+  std::vector<std::pair<char, std::string>> parts;
+  if (head > 0) {
+    parts.emplace_back('h', "trim=duration=" + number(head));
+  }
+  if (hasBody) {
+    parts.emplace_back('b', "trim=start=" + number(head) + ":end=" + number(bodyEnd));
+  }
+  if (tail > 0) {
+    parts.emplace_back('t', "trim=start=" + number(bodyEnd));
+  }
+  if (parts.size() == 1) {
+    char part = static_cast<char>(std::toupper(parts[0].first));
+    chains.push_back(chain + "," + parts[0].second + ",setpts=PTS-STARTPTS" + label('v', i, part));
+  }
+  else {
+    chain += ",split=" + std::to_string(parts.size());
+    for (auto const& [part, trim]: parts) {
+      chain += label('v', i, part);
+      char trimmed = static_cast<char>(std::toupper(part));
+      chains.push_back(label('v', i, part) + trim + ",setpts=PTS-STARTPTS" + label('v', i, trimmed));
+    }
+    chains.push_back(chain);
+  }
+
+  // The transition from the previous item, then the item itself. The
+  // tail is picked up by the transition to the next item.
+  if (head > 0) {
+    // Transitions without a similar one in ffmpeg are crossfaded.
+    std::string_view name = effectInfo(item.transition.id).filter;
+    if (!effectInfo(item.transition.id).isTransition() || name.empty()) {
+      name = "fade";
+    }
+    std::string transition = label('x', i);
+    chains.push_back(label('v', i-1, 'T') + label('v', i, 'H') +
+                     "xfade=transition=" + std::string(name) + ":duration=" + number(head) + ":offset=0" + transition);
+    pieces.push_back(transition);
+  }
+  if (hasBody) {
+    pieces.push_back(label('v', i, 'B'));
+  }
+}
+
+
+
+/**
+ * @brief Add an audio stream to the mix.
+ *
+ * @param input The input the stream is taken from.
+ * @param start Where the stream starts, relative to the time range.
+ * @param duration The length of the stream.
+ */
+void FilterGraph::addAudio(size_t input, float start, float duration, float volume, bool fadeIn, bool fadeOut) {
+  std::string chain = "[" + std::to_string(input) + ":a]atrim=duration=" + number(duration) + ",asetpts=PTS-STARTPTS,"
+                      "aresample=48000,aformat=sample_fmts=fltp:channel_layouts=stereo";
+  if (volume != 1) {
+    chain += ",volume=" + number(volume);
+  }
+  float fade = std::min(options.fadeDuration, duration / 2);
+  if (fadeIn) {
+    chain += ",afade=t=in:st=0:d=" + number(fade);
+  }
+  if (fadeOut) {
+    chain += ",afade=t=out:st=" + number(duration - fade) + ":d=" + number(fade);
+  }
+  long delay = static_cast<long>(start * 1000 + 0.5f);
+  if (delay > 0) {
+    chain += ",adelay=delays=" + std::to_string(delay) + ":all=1";
+  }
+  std::string stream = label('a', audioStreams.size());
+  chains.push_back(chain + stream);
+  audioStreams.push_back(stream);
+}
+
+
+
+/**
+ * @brief Draw the text of the title sequences in the time range on
+ * the video. Titles of the video track are centered on their black
+ * background, those of the title track are overlaid on the lower
+ * part of the video, with an outline.
+ */
+void FilterGraph::addTitles(Project const& project) {
+  for (auto const& title: getTitles(project)) {
+    float start = std::max(title.start, begin) - begin;
+    float stop = std::min(title.end, end) - begin;
+    if (title.text.empty() || stop - start <= epsilon) {
+      continue;
+    }
+    std::string filter = "drawtext=text=" + filterValue(title.text) + ":expansion=none:fontcolor=white:fontsize=h/12";
+    if (!title.font.empty()) {
+      filter += ":font=" + filterValue(title.font);
+    }
+    if (title.track == TrackType::VIDEO) {
+      filter += ":x=(w-text_w)/2:y=(h-text_h)/2";
+    }
+    else {
+      filter += ":borderw=2:x=(w-text_w)/2:y=h-text_h-h/10";
+    }
+    filter += ":enable=between(t\\," + number(start) + "\\," + number(stop) + ")";
+    titles.push_back(filter);
+  }
+}
+
+
+
+std::string FilterGraph::graph() const {
+  std::string graph;
+  for (auto const& chain: chains) {
+    graph += chain + ';';
+  }
+  for (auto const& piece: pieces) {
+    graph += piece;
+  }
+  graph += "concat=n=" + std::to_string(pieces.size()) + ":v=1:a=0";
+  for (auto const& title: titles) {
+    graph += ',' + title;
+  }
+  graph += "[vout]";
+  if (!audioStreams.empty()) {
+    graph += ';';
+    for (auto const& stream: audioStreams) {
+      graph += stream;
+    }
+    // Without normalizing, every stream keeps the volume set in the
+    // project, no matter how many others play at the same time.
+    graph += "amix=inputs=" + std::to_string(audioStreams.size()) + ":duration=longest:normalize=0[aout]";
+  }
+  return graph;
+}
+
+
+
+/**
+ * @brief The ffmpeg command, reading the filter graph from a file.
+ *
+ * @param script The file graph() is written to.
+ */
+std::string FilterGraph::command(std::string const& script) const {
+  std::string command = "ffmpeg " + inputs + "-filter_complex_script " + shellQuote(script) + " -map '[vout]' ";
+  if (!audioStreams.empty()) {
+    command += "-map '[aout]' ";
+  }
+  command += "-t " + number(end - begin) + " " + shellQuote(output);
+  return command;
+}
+
+
+
+/**
+ * @brief Probe all source files of a project in parallel, if
+ * RenderOptions::probe is set, so the filter graph finds them cached.
+ */
+static void prefetchSources(Project const& project, PathSubstitutions const& substitutions, RenderOptions const& options) {
+  if (!options.probe) {
+    return;
+  }
+  std::vector<std::string> paths;
+  for (Timeline const* timeline: {&project.videoTimeline(), &project.audioTimeline()}) {
+    for (auto const& item: *timeline) {
+      if (item.hasSource()) {
+        paths.push_back(substitutions.apply(timeline->srcPath(item)));
+      }
+    }
+  }
+  options.probe->probeAll(paths);
+}
+
+
+
+/**
+ * @brief Generate an ffmpeg command that renders a project in one
+ * pass. Projects with more than RenderOptions::maxInputs source files
+ * are rendered in segments instead, see planRender().
+ *
+ * All items of the video track are scaled and padded to the aspect
+ * ratio of the project. Overlapping items are joined by the xfade
+ * transition closest to the one in the project, gaps are black, and
+ * so are title sequences. With RenderOptions::titles, their text is
+ * drawn on black or on the video, see getTitles(). Effects are approximated by the filters in the
+ * effectRegistry, some are ignored. The audio track is mixed with
+ * the sound of the video clips, taking volume, mute and fades of its
+ * items into account. With RenderOptions::probe, sound is only taken
+ * from files that have it, and videos shorter than the project thinks
+ * hold their last frame.
+ *
+ * @param project The project to render.
+ * @param substitutions Substitutions performed on the source file paths.
+ * @param options The output format. RenderOptions::segmentLength is
+ * ignored.
+ * @return RenderPlan The command and the file with its filter graph.
+ */
+RenderPlan generateFfmpegCommand(Project const& project, PathSubstitutions const& substitutions,
+                                 RenderOptions const& options)
+{
+  RenderOptions onePass = options;
+  onePass.segmentLength = 0;
+  return planRender(project, substitutions, onePass);
+}
+
+
+
+/**
+ * @brief Find the boundaries of the segments of a render plan.
+ *
+ * Segments may only be cut where no item of the video track plays,
+ * so transitions are never split: between items that don't overlap,
+ * and anywhere in gaps. Each segment is cut at the first such point
+ * after it reached the target length, or at the last such point
+ * before it would open more than maxInputs source files. Segments
+ * without such a point in between may have more.
+ *
+ * @param segmentLength The target length; no limit if not positive.
+ * @return std::vector<float> The start of each segment, followed by
+ * the end of the last one.
+ */
+static std::vector<float> findCuts(Timeline const& video, Timeline const& audio, float length,
+                                   float segmentLength, size_t maxInputs)
+{
+  // The ranges in which no video is playing.
+  std::vector<std::pair<float, float>> ranges;
+  float covered = 0;
+  for (auto const& item: video) {
+    if (item.timelineStart > covered - epsilon) {
+      ranges.emplace_back(covered, item.timelineStart);
+    }
+    covered = std::max(covered, item.timelineEnd);
+  }
+  ranges.emplace_back(covered, length);
+
+  // The inputs of a segment are its video items with a source file
+  // and the audio items overlapping it.
+  std::vector<float> videoStarts;
+  std::vector<float> audioStarts;
+  std::vector<float> audioEnds;
+  for (auto const& item: video) {
+    if (item.hasSource()) {
+      videoStarts.push_back(item.timelineStart);
+    }
+  }
+  for (auto const& item: audio) {
+    audioStarts.push_back(item.timelineStart);
+    audioEnds.push_back(item.timelineEnd);
+  }
+  std::sort(videoStarts.begin(), videoStarts.end());
+  std::sort(audioStarts.begin(), audioStarts.end());
+  std::sort(audioEnds.begin(), audioEnds.end());
+  auto countBelow = [](std::vector<float> const& sorted, float value) {
+    return static_cast<size_t>(std::lower_bound(sorted.begin(), sorted.end(), value) - sorted.begin());
+  };
+  auto inputs = [&](float from, float to) {
+    return countBelow(videoStarts, to) - countBelow(videoStarts, from - epsilon)
+           + countBelow(audioStarts, to - epsilon) - countBelow(audioEnds, from + epsilon);
+  };
+
+  std::vector<float> cuts(1, 0);
+  for (size_t r = 0; r < ranges.size(); ++r) {
+    auto [from, to] = ranges[r];
+    while (segmentLength > 0) {
+      // Tiny lengths are lost in the rounding of long projects.
+      float cut = std::max(from, cuts.back() + segmentLength);
+      if (cut > to || cut > length - epsilon || cut <= cuts.back()) {
+        break;
+      }
+      cuts.push_back(cut);
+    }
+    bool tooMany = r+1 < ranges.size() && inputs(cuts.back(), ranges[r+1].first) > maxInputs;
+    if (tooMany && from > cuts.back() + epsilon && from < length - epsilon) {
+      cuts.push_back(from);
+    }
+  }
+  cuts.push_back(length);
+  return cuts;
+}
+
+
+
+/**
+ * @brief Plan rendering a project in segments that can be encoded in
+ * parallel, e.g. on all cores of a machine.
+ *
+ * Every segment is rendered like a single pass would be, with the
+ * same encoding parameters and always with an audio stream, so
+ * ffmpeg's concat demuxer can join them by copying the streams. The
+ * filter graph of each command is read from a file named after its
+ * output, e.g. "output-001.mp4.filter".
+ *
+ * @param project The project to render.
+ * @param substitutions Substitutions performed on the source file paths.
+ * @param options The output format. Segments are named after
+ * RenderOptions::output, e.g. "output-001.mp4".
+ * @return RenderPlan The commands.
+ */
+RenderPlan planRender(Project const& project, PathSubstitutions const& substitutions, RenderOptions const& options) {
+  namespace fs = std::filesystem;
+  std::vector<float> cuts = findCuts(project.videoTimeline(), project.audioTimeline(), projectLength(project),
+                                     options.segmentLength, options.maxInputs);
+  prefetchSources(project, substitutions, options);
+  RenderPlan plan;
+  auto addSegment = [&](float start, float end, std::string const& output, bool silence) {
+    std::string script = output + ".filter";
+    FilterGraph graph(project, substitutions, options, start, end, output, silence);
+    plan.segments.push_back({start, end, output, graph.command(script)});
+    plan.files.push_back({script, graph.graph()});
+  };
+  if (cuts.size() == 2) {
+    addSegment(cuts[0], cuts[1], options.output, false);
+    return plan;
+  }
+
+  fs::path output(options.output);
+  // Named after the whole output, like the filter graphs, so it can't
+  // be mistaken for a file of the user.
+  std::string list = options.output + ".concat";
+  std::string files;
+  for (size_t i = 0; i+1 < cuts.size(); ++i) {
+    std::string number = std::to_string(i+1);
+    number.insert(0, number.size() < 3 ? 3 - number.size() : 0, '0');
+    fs::path segment = output.parent_path() / (output.stem().string() + "-" + number + output.extension().string());
+    addSegment(cuts[i], cuts[i+1], segment.string(), true);
+    // The list is read relative to its own directory. The concat
+    // demuxer takes quotes like a shell does.
+    files += "file " + shellQuote(segment.filename().string()) + "\n";
+  }
+  plan.files.push_back({list, files});
+  plan.concatCommand = "ffmpeg -f concat -safe 0 -i " + shellQuote(list) + " -c copy " + shellQuote(options.output);
+  return plan;
+}
+
+
+
+
+/**
+ * @brief Write the files a render plan reads. Throws if one can't be
+ * written.
+ */
+void writeRenderFiles(RenderPlan const& plan) {
+  for (auto const& file: plan.files) {
+    if (!replaceFile(file.path, file.content)) {
+      throw std::runtime_error("Can't write '" + file.path + "'.");
+    }
+  }
+}
+
+} // Namespace mswmm
@@ -0,0 +1,109 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#ifndef _MSWMM_RENDER_HPP
+#define _MSWMM_RENDER_HPP
+
+#include <string>
+#include <vector>
+
+#include "Project.hpp"
+#include "MediaProbe.hpp"
+#include "PathSubstitutions.hpp"
+
+
+namespace mswmm {
+
+struct RenderOptions {
+  // Height of the video in pixels; the width follows from the aspect
+  // ratio of the project.
+  unsigned int height = 720;
+  // Frames per second of the output. Projects don't store a frame
+  // rate; Movie Maker's depends on the output profile, e.g. 29.97 on
+  // NTSC systems. 25 is only a default, set with --fps in mswmm-tool.
+  unsigned int frameRate = 25;
+  // Length of fade effects and of audio fades, in seconds.
+  float fadeDuration = 1;
+  // Mix the audio of video clips into the audio track. Source videos
+  // without an audio stream make ffmpeg fail then.
+  bool videoAudio = true;
+  // Draw the text of title sequences. The text and font are guessed by
+  // getTitles(), as no project with titles was available to check the
+  // names of their parameters, so this is off unless asked for. It
+  // needs an ffmpeg built with libfreetype, and with fontconfig to pick
+  // the fonts of the project.
+  bool titles = false;
+  std::string output = "output.mp4";
+  // Length of the segments planRender() aims for, in seconds.
+  float segmentLength = 60;
+  // Most source files a single command opens. ffmpeg opens and reads
+  // all inputs of a command at once, so projects with more sources
+  // are rendered in segments, see planRender().
+  size_t maxInputs = 32;
+  // If set, the source files are probed first, so the command relies
+  // on their real streams and durations rather than on the project.
+  // Missing source files are an error then.
+  MediaProbe* probe = nullptr;
+};
+
+
+
+/**
+ * @brief A file the commands of a render plan read. Filter graphs are
+ * far too long for the command line of large projects, so they are
+ * passed in files.
+ */
+struct RenderFile {
+  std::string path;
+  std::string content;
+};
+
+
+
+struct RenderSegment {
+  float start;
+  float end;
+  std::string output;
+  std::string command;
+};
+
+
+
+/**
+ * @brief Commands rendering a project in segments, which can run in
+ * parallel, and the command joining them afterwards.
+ */
+struct RenderPlan {
+  std::vector<RenderSegment> segments;
+  // Joins the segments into RenderOptions::output without encoding
+  // them again, reading their list from a file in files. Empty if
+  // there is only one segment.
+  std::string concatCommand;
+  // Have to be written before the commands run, see writeRenderFiles().
+  std::vector<RenderFile> files;
+};
+
+
+
+RenderPlan generateFfmpegCommand(Project const& project, PathSubstitutions const& substitutions,
+                                 RenderOptions const& options = RenderOptions());
+RenderPlan planRender(Project const& project, PathSubstitutions const& substitutions,
+                      RenderOptions const& options = RenderOptions());
+void writeRenderFiles(RenderPlan const& plan);
+
+} // Namespace mswmm
+
+#endif
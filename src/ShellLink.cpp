@@ -0,0 +1,315 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#include <cstring>
+#include <iterator>
+
+#include "ShellLink.hpp"
+#include "CompoundFile.hpp"
+#include "Error.hpp"
+#include "Utf.hpp"
+
+
+namespace mswmm {
+
+static constexpr uint32_t headerSize = 0x4C;
+static constexpr unsigned char linkClsid[16] = {
+  0x01, 0x14, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0xC0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46
+};
+
+// LinkFlags
+static constexpr uint32_t hasLinkTargetIdList = 0x01;
+static constexpr uint32_t hasLinkInfo = 0x02;
+static constexpr uint32_t hasName = 0x04;
+static constexpr uint32_t isUnicode = 0x80;
+
+// LinkInfoFlags
+static constexpr uint32_t volumeIdAndLocalBasePath = 0x01;
+static constexpr uint32_t commonNetworkRelativeLinkAndPathSuffix = 0x02;
+
+static constexpr uint32_t trackerDataBlock = 0xA0000003;
+static constexpr uint32_t trackerDataBlockSize = 0x60;
+
+// Windows-1252 code points of the bytes 0x80 to 0x9F; the rest of the
+// code page matches Latin-1. Undefined bytes map to U+FFFD.
+static constexpr char16_t cp1252[32] = {
+  0x20AC, 0xFFFD, 0x201A, 0x0192, 0x201E, 0x2026, 0x2020, 0x2021,
+  0x02C6, 0x2030, 0x0160, 0x2039, 0x0152, 0xFFFD, 0x017D, 0xFFFD,
+  0xFFFD, 0x2018, 0x2019, 0x201C, 0x201D, 0x2022, 0x2013, 0x2014,
+  0x02DC, 0x2122, 0x0161, 0x203A, 0x0153, 0xFFFD, 0x017E, 0x0178
+};
+
+
+
+/**
+ * @brief A bounds checked, little endian view of a structure in a link.
+ */
+class LinkData {
+  public:
+    LinkData(unsigned char const* data, size_t length) : data(data), length(length) {}
+
+    size_t size() const { return length; }
+
+    LinkData sub(size_t offset, size_t size) const {
+      check(offset, size);
+      return LinkData(data + offset, size);
+    }
+
+    uint16_t u16(size_t offset) const {
+      check(offset, 2);
+      return data[offset] | data[offset+1] << 8;
+    }
+
+    uint32_t u32(size_t offset) const {
+      check(offset, 4);
+      return static_cast<uint32_t>(u16(offset)) | static_cast<uint32_t>(u16(offset+2)) << 16;
+    }
+
+    uint64_t u64(size_t offset) const {
+      return static_cast<uint64_t>(u32(offset)) | static_cast<uint64_t>(u32(offset+4)) << 32;
+    }
+
+    Guid guid(size_t offset) const {
+      check(offset, 16);
+      Guid guid;
+      std::memcpy(guid.data(), data + offset, guid.size());
+      return guid;
+    }
+
+    // Strings in the system code page, which is assumed to be
+    // Windows-1252, as on western installations of Windows.
+    std::string ansi(size_t offset, size_t count) const {
+      check(offset, count);
+      std::u16string str;
+      str.reserve(count);
+      for (size_t i = 0; i < count; ++i) {
+        unsigned char c = data[offset+i];
+        str += c >= 0x80 && c < 0xA0 ? cp1252[c - 0x80] : c;
+      }
+      std::string utf8;
+      appendUtf8(utf8, str);
+      return utf8;
+    }
+
+    std::string ansiZ(size_t offset) const {
+      check(offset, 0);
+      auto end = static_cast<unsigned char const*>(std::memchr(data + offset, 0, length - offset));
+      if (end == nullptr) {
+        throw CorruptFileError("Unterminated string in shell link.");
+      }
+      return ansi(offset, end - (data + offset));
+    }
+
+    std::string unicode(size_t offset, size_t count) const {
+      check(offset, count * 2);
+      std::u16string str;
+      str.reserve(count);
+      for (size_t i = 0; i < count; ++i) {
+        str += static_cast<char16_t>(u16(offset + 2*i));
+      }
+      std::string utf8;
+      appendUtf8(utf8, str);
+      return utf8;
+    }
+
+    std::string unicodeZ(size_t offset) const {
+      size_t count = 0;
+      while (u16(offset + 2*count) != 0) {
+        ++count;
+      }
+      return unicode(offset, count);
+    }
+
+  private:
+    void check(size_t offset, size_t size) const {
+      if (offset > length || size > length - offset) {
+        throw CorruptFileError("Shell link is truncated.");
+      }
+    }
+
+    unsigned char const* data;
+    size_t length;
+};
+
+
+
+/**
+ * @brief Read the LinkInfo structure: where the target is found on a
+ * local volume or on a network share.
+ */
+static void parseLinkInfo(LinkData const& info, ShellLink& link) {
+  uint32_t infoHeaderSize = info.u32(4);
+  uint32_t flags = info.u32(8);
+  // Newer links carry Unicode variants of the ANSI strings.
+  bool hasUnicode = infoHeaderSize >= 0x24;
+  std::string suffix = hasUnicode && info.u32(32) != 0 ? info.unicodeZ(info.u32(32)) : info.ansiZ(info.u32(24));
+
+  if (flags & volumeIdAndLocalBasePath) {
+    uint32_t volumeOffset = info.u32(12);
+    LinkData volumeId = info.sub(volumeOffset, info.u32(volumeOffset));
+    link.driveType = volumeId.u32(4);
+    link.driveSerialNumber = volumeId.u32(8);
+    uint32_t labelOffset = volumeId.u32(12);
+    link.volumeLabel = labelOffset == 0x14 ? volumeId.unicodeZ(volumeId.u32(16)) : volumeId.ansiZ(labelOffset);
+
+    if (hasUnicode && info.u32(28) != 0) {
+      link.localPath = info.unicodeZ(info.u32(28));
+    }
+    else {
+      link.localPath = info.ansiZ(info.u32(16));
+    }
+    link.localPath += suffix;
+  }
+
+  if (flags & commonNetworkRelativeLinkAndPathSuffix) {
+    uint32_t networkOffset = info.u32(20);
+    LinkData network = info.sub(networkOffset, info.u32(networkOffset));
+    uint32_t netNameOffset = network.u32(8);
+    if (netNameOffset > 0x14) {
+      link.networkPath = network.unicodeZ(network.u32(20));
+    }
+    else {
+      link.networkPath = network.ansiZ(netNameOffset);
+    }
+    if (!suffix.empty()) {
+      link.networkPath += '\\' + suffix;
+    }
+  }
+}
+
+
+
+/**
+ * @brief Parse a shell link.
+ * Throws a CorruptFileError if the data is not a valid link.
+ *
+ * @param data The content of the .lnk file or stream.
+ * @param length Its size in bytes.
+ * @return ShellLink What the link knows about its target.
+ */
+ShellLink parseShellLink(char const* data, size_t length) {
+  LinkData lnk(reinterpret_cast<unsigned char const*>(data), length);
+  if (length < headerSize || lnk.u32(0) != headerSize || std::memcmp(data + 4, linkClsid, sizeof(linkClsid)) != 0) {
+    throw CorruptFileError("Not a shell link.");
+  }
+
+  ShellLink link;
+  uint32_t flags = lnk.u32(0x14);
+  link.fileAttributes = lnk.u32(0x18);
+  link.writeTime = lnk.u64(0x2C);
+  link.fileSize = lnk.u32(0x34);
+
+  size_t offset = headerSize;
+  if (flags & hasLinkTargetIdList) {
+    // The shell's own description of the target is not needed.
+    offset += 2 + lnk.u16(offset);
+  }
+  if (flags & hasLinkInfo) {
+    LinkData info = lnk.sub(offset, lnk.u32(offset));
+    parseLinkInfo(info, link);
+    offset += info.size();
+  }
+
+  // The optional strings follow in the order of their flags: name,
+  // relative path, working directory, arguments and icon location.
+  std::string* strings[] = {nullptr, &link.relativePath, &link.workingDir, nullptr, nullptr};
+  for (size_t i = 0; i < std::size(strings); ++i) {
+    if (!(flags & hasName << i)) {
+      continue;
+    }
+    size_t count = lnk.u16(offset);
+    offset += 2;
+    size_t bytes = flags & isUnicode ? 2*count : count;
+    if (strings[i]) {
+      *strings[i] = flags & isUnicode ? lnk.unicode(offset, count) : lnk.ansi(offset, count);
+    }
+    offset += bytes;
+  }
+
+  // Extra data blocks, up to a terminal block smaller than four bytes.
+  while (offset + 4 <= length) {
+    uint32_t blockSize = lnk.u32(offset);
+    if (blockSize < 4) {
+      break;
+    }
+    LinkData block = lnk.sub(offset, blockSize);
+    if (blockSize >= trackerDataBlockSize && block.u32(4) == trackerDataBlock) {
+      link.machineId = block.sub(16, 16).ansiZ(0);
+      link.volumeId = block.guid(32);
+      link.objectId = block.guid(48);
+      link.birthVolumeId = block.guid(64);
+      link.birthObjectId = block.guid(80);
+    }
+    offset += blockSize;
+  }
+  return link;
+}
+
+
+
+/**
+ * @brief Read a shell link from a project file.
+ *
+ * @param reader The CFB container of the project.
+ * @param stream Path of the link below ProducerData, as referenced by
+ * the LinkPath attribute of FileInfo tags, e.g. "ShellLink\Data.3".
+ * @return std::optional<ShellLink> The link; empty if there is no
+ * such stream.
+ */
+std::optional<ShellLink> readShellLink(CFB::CompoundFileReader const& reader, std::string_view stream) {
+  if (stream.empty()) {
+    return std::nullopt;
+  }
+  // Stream names in the XML are plain ASCII.
+  std::u16string path = u"ProducerData\\";
+  path.append(stream.begin(), stream.end());
+  auto entry = findStream(reader, path);
+  if (!entry) {
+    return std::nullopt;
+  }
+  std::string buffer(entry->size, '\0');
+  reader.ReadFile(entry, 0, buffer.data(), buffer.size());
+  return parseShellLink(buffer.data(), buffer.size());
+}
+
+
+
+/**
+ * @brief Format a GUID in registry notation, e.g.
+ * "{00021401-0000-0000-C000-000000000046}".
+ */
+std::string formatGuid(Guid const& guid) {
+  // The first three fields are little endian.
+  static constexpr int order[16] = {3, 2, 1, 0, -1, 5, 4, -1, 7, 6, -1, 8, 9, -1, 10, 11};
+  static constexpr char hex[] = "0123456789ABCDEF";
+  std::string str = "{";
+  for (int i: order) {
+    if (i < 0) {
+      str += '-';
+      continue;
+    }
+    str += hex[guid[i] >> 4];
+    str += hex[guid[i] & 0xF];
+  }
+  for (int i = 12; i < 16; ++i) {
+    str += hex[guid[i] >> 4];
+    str += hex[guid[i] & 0xF];
+  }
+  str += '}';
+  return str;
+}
+
+} // Namespace mswmm
@@ -0,0 +1,83 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#ifndef _MSWMM_SHELLLINK_HPP
+#define _MSWMM_SHELLLINK_HPP
+
+#include <array>
+#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+#include "compoundfilereader.h"
+
+
+namespace mswmm {
+
+using Guid = std::array<uint8_t, 16>;
+
+
+
+/**
+ * @brief What a Windows shell link (.lnk, [MS-SHLLINK]) knows about
+ * its target.
+ *
+ * Movie Maker stores one for every source file below
+ * ProducerData\ShellLink. Besides the path the file had when it was
+ * added, it records the size of the file and the volume it was on,
+ * which is enough to find the file again after it was moved. All
+ * strings are UTF-8; fields missing from the link stay empty or zero.
+ */
+struct ShellLink {
+  uint32_t fileAttributes = 0;
+  // Only the lower 32 bits of the size are stored in a link.
+  uint64_t fileSize = 0;
+  // Last modification of the target, as a Windows FILETIME.
+  uint64_t writeTime = 0;
+
+  // Absolute path of the target on a local volume.
+  std::string localPath;
+  // Path of the target on a network share.
+  std::string networkPath;
+  // Path relative to the location of the link, and the working directory.
+  std::string relativePath;
+  std::string workingDir;
+
+  uint32_t driveType = 0;
+  uint32_t driveSerialNumber = 0;
+  std::string volumeLabel;
+
+  // Distributed link tracking: the NetBIOS name of the machine and the
+  // NTFS object IDs of the target and of its volume, currently and
+  // when the link was created.
+  std::string machineId;
+  Guid volumeId{};
+  Guid objectId{};
+  Guid birthVolumeId{};
+  Guid birthObjectId{};
+};
+
+
+
+ShellLink parseShellLink(char const* data, size_t length);
+std::optional<ShellLink> readShellLink(CFB::CompoundFileReader const& reader, std::string_view stream);
+std::string formatGuid(Guid const& guid);
+
+} // Namespace mswmm
+
+#endif
@@ -0,0 +1,375 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#include <unordered_map>
+
+#include "Snapshot.hpp"
+
+
+namespace mswmm {
+
+// "MSWMMSN" and a format version. Unlike the cache, snapshots are
+// read by other programs, so the layout may only be extended behind
+// a new version.
+static constexpr uint64_t magic = 0x01'4E'53'4D'4D'57'53'4DULL;
+
+static constexpr size_t headerSize = 112;
+static constexpr size_t fileSize = 8;
+static constexpr size_t itemSize = 96;
+static constexpr size_t effectSize = 12;
+static constexpr size_t parameterSize = 16;
+
+
+
+/**
+ * @brief Stores every string of a snapshot once, in the section at
+ * its end, and writes references to them.
+ */
+class SnapshotStrings {
+  public:
+    explicit SnapshotStrings(size_t base) : base(base) {}
+
+    void write(BinaryWriter& writer, std::string_view str) {
+      auto [it, inserted] = offsets.try_emplace(std::string(str), base + strings.size());
+      if (inserted) {
+        strings += str;
+        strings += '\0';
+      }
+      writer.u32(it->second);
+      writer.u32(str.size());
+    }
+
+    std::string const& data() const { return strings; }
+
+  private:
+    size_t base;
+    std::string strings;
+    std::unordered_map<std::string, uint32_t> offsets;
+};
+
+
+
+/**
+ * @brief Write the model of a project as a binary snapshot, see
+ * Snapshot for the layout. This extracts all sections of the project.
+ */
+std::string exportSnapshot(Project const& project) {
+  Timeline const* timelines[3] = {&project.videoTimeline(), &project.audioTimeline(), &project.titleTimeline()};
+  Metadata const& metadata = project.metadata();
+  auto const& sourceFiles = project.sourceFiles();
+
+  // All sizes are known up front, so every record can be written
+  // right away with the offsets it refers to.
+  size_t itemCount = 0;
+  size_t effectCount = 0;
+  size_t parameterCount = 0;
+  for (Timeline const* timeline: timelines) {
+    itemCount += timeline->size();
+    for (auto const& item: *timeline) {
+      effectCount += item.effectCount;
+      parameterCount += item.parameterCount;
+    }
+  }
+  size_t filesOffset = headerSize;
+  size_t itemsOffset = filesOffset + sourceFiles.size() * fileSize;
+  size_t effectsOffset = itemsOffset + itemCount * itemSize;
+  size_t parametersOffset = effectsOffset + effectCount * effectSize;
+  size_t stringsOffset = parametersOffset + parameterCount * parameterSize;
+
+  std::string snapshot;
+  snapshot.reserve(stringsOffset);
+  BinaryWriter writer(snapshot);
+  SnapshotStrings strings(stringsOffset);
+
+  writer.u64(magic);
+  // The total length is filled in at the end.
+  writer.u32(0);
+  writer.u32(project.hasTitleSequences() ? 1 : 0);
+  writer.u32(metadata.aspectRatio.x);
+  writer.u32(metadata.aspectRatio.y);
+  strings.write(writer, metadata.author);
+  strings.write(writer, metadata.title);
+  strings.write(writer, metadata.description);
+  strings.write(writer, metadata.copyright);
+  strings.write(writer, metadata.rating);
+  writer.u32(sourceFiles.size());
+  writer.u32(filesOffset);
+  size_t trackOffset = itemsOffset;
+  for (Timeline const* timeline: timelines) {
+    writer.u32(timeline->size());
+    writer.u32(trackOffset);
+    trackOffset += timeline->size() * itemSize;
+  }
+  writer.u32(effectCount);
+  writer.u32(effectsOffset);
+  writer.u32(parameterCount);
+  writer.u32(parametersOffset);
+
+  for (auto const& file: sourceFiles) {
+    strings.write(writer, file);
+  }
+
+  // Effects and parameters are numbered across all timelines.
+  uint32_t firstEffect = 0;
+  uint32_t firstParameter = 0;
+  for (Timeline const* timeline: timelines) {
+    for (auto const& item: *timeline) {
+      writer.u8(static_cast<uint8_t>(item.type));
+      writer.u8(item.isMuted | item.fadesIn << 1 | item.fadesOut << 2);
+      writer.u8(static_cast<uint8_t>(item.transition.id));
+      writer.u8(0);
+      writer.f32(item.timelineStart);
+      writer.f32(item.timelineEnd);
+      writer.f32(item.sourceStart);
+      writer.f32(item.sourceEnd);
+      writer.f32(item.volume);
+      strings.write(writer, timeline->name(item));
+      strings.write(writer, timeline->srcPath(item));
+      strings.write(writer, timeline->thumbnail(item));
+      strings.write(writer, timeline->link(item));
+      strings.write(writer, timeline->transition(item));
+      writer.u32(firstEffect);
+      writer.u32(item.effectCount);
+      writer.u32(firstParameter);
+      writer.u32(item.parameterCount);
+      writer.u64(item.fileSizeKiB);
+      writer.u32(item.srcSizePx.x);
+      writer.u32(item.srcSizePx.y);
+      firstEffect += item.effectCount;
+      firstParameter += item.parameterCount;
+    }
+  }
+
+  for (Timeline const* timeline: timelines) {
+    for (auto const& item: *timeline) {
+      for (size_t e = 0; e < item.effectCount; ++e) {
+        writer.u8(static_cast<uint8_t>(timeline->effectId(item, e)));
+        writer.u8(0);
+        writer.u8(0);
+        writer.u8(0);
+        strings.write(writer, timeline->effect(item, e));
+      }
+    }
+  }
+
+  for (Timeline const* timeline: timelines) {
+    for (auto const& item: *timeline) {
+      for (size_t p = 0; p < item.parameterCount; ++p) {
+        auto [name, value] = timeline->parameter(item, p);
+        strings.write(writer, name);
+        strings.write(writer, value);
+      }
+    }
+  }
+
+  snapshot += strings.data();
+  uint32_t length = snapshot.size();
+  for (int i = 0; i < 4; ++i) {
+    snapshot[8 + i] = static_cast<char>(length >> (8*i));
+  }
+  return snapshot;
+}
+
+
+
+/**
+ * @param data The snapshot. It is not copied and has to stay valid
+ * as long as the snapshot and everything read from it is used.
+ * @param length The length of the buffer, at least that of the snapshot.
+ */
+Snapshot::Snapshot(char const* data, size_t length) : data(data), length(length) {
+  BinaryReader header(data, length);
+  if (length < headerSize || header.u64() != magic) {
+    throw CorruptFileError("Not a project snapshot or unsupported version.");
+  }
+  uint32_t total = header.u32();
+  if (total < headerSize || total > length) {
+    throw CorruptFileError("Truncated project snapshot.");
+  }
+  this->length = total;
+
+  files = array(64, fileSize);
+  for (size_t i = 0; i < 3; ++i) {
+    tracks[i] = array(72 + 8*i, itemSize);
+  }
+  effects = array(96, effectSize);
+  parameters = array(104, parameterSize);
+}
+
+
+
+bool Snapshot::hasTitleSequences() const {
+  return reader(12).u32() & 1;
+}
+
+
+
+size Snapshot::aspectRatio() const {
+  BinaryReader r = reader(16);
+  size ratio;
+  ratio.x = r.u32();
+  ratio.y = r.u32();
+  return ratio;
+}
+
+
+
+std::string_view Snapshot::file(size_t i) const {
+  BinaryReader r(record(files, fileSize, i), fileSize);
+  return string(r);
+}
+
+
+
+SnapshotItem Snapshot::item(TrackType track, size_t i) const {
+  BinaryReader r(record(tracks[trackIndex(track)], itemSize, i), itemSize);
+  SnapshotItem item;
+  uint8_t type = r.u8();
+  uint8_t flags = r.u8();
+  uint8_t transition = r.u8();
+  r.u8();
+  if (type > static_cast<uint8_t>(ItemType::AUDIO) || transition >= static_cast<uint8_t>(EffectId::COUNT)) {
+    throw CorruptFileError("Invalid item in project snapshot.");
+  }
+  item.type = static_cast<ItemType>(type);
+  item.isMuted = flags & 1;
+  item.fadesIn = flags & 2;
+  item.fadesOut = flags & 4;
+  item.transition = static_cast<EffectId>(transition);
+  item.timelineStart = r.f32();
+  item.timelineEnd = r.f32();
+  item.sourceStart = r.f32();
+  item.sourceEnd = r.f32();
+  item.volume = r.f32();
+  item.name = string(r);
+  item.srcPath = string(r);
+  item.thumbnail = string(r);
+  item.link = string(r);
+  item.transitionGuid = string(r);
+  item.firstEffect = r.u32();
+  item.effectCount = r.u32();
+  item.firstParameter = r.u32();
+  item.parameterCount = r.u32();
+  item.fileSizeKiB = r.u64();
+  item.srcSizePx.x = r.u32();
+  item.srcSizePx.y = r.u32();
+  return item;
+}
+
+
+
+/**
+ * @brief Get an effect of an item.
+ *
+ * @param i Index of the effect, smaller than item.effectCount.
+ * @return The ID of the effect, UNKNOWN if it isn't built into Movie
+ * Maker, and its GUID.
+ */
+std::pair<EffectId, std::string_view> Snapshot::effect(SnapshotItem const& item, size_t i) const {
+  BinaryReader r(record(effects, effectSize, size_t(item.firstEffect) + i), effectSize);
+  uint8_t id = r.u8();
+  if (id >= static_cast<uint8_t>(EffectId::COUNT)) {
+    throw CorruptFileError("Invalid effect in project snapshot.");
+  }
+  r.u8();
+  r.u8();
+  r.u8();
+  return {static_cast<EffectId>(id), string(r)};
+}
+
+
+
+/**
+ * @brief Get a parameter of a title.
+ *
+ * @param i Index of the parameter, smaller than item.parameterCount.
+ * @return The name and the value of the parameter.
+ */
+std::pair<std::string_view, std::string_view> Snapshot::parameter(SnapshotItem const& item, size_t i) const {
+  BinaryReader r(record(parameters, parameterSize, size_t(item.firstParameter) + i), parameterSize);
+  std::string_view name = string(r);
+  return {name, string(r)};
+}
+
+
+
+size_t Snapshot::trackIndex(TrackType track) {
+  switch (track) {
+    case TrackType::VIDEO:
+      return 0;
+    case TrackType::AUDIO:
+      return 1;
+    case TrackType::SOMETHING:
+      return 2;
+  }
+  throw std::runtime_error("Unknown timeline.");
+}
+
+
+
+BinaryReader Snapshot::reader(size_t offset) const {
+  return BinaryReader(data + offset, length - offset);
+}
+
+
+
+/**
+ * @brief Read the count and offset of an array from the header, and
+ * check that the array lies within the snapshot.
+ */
+Snapshot::Array Snapshot::array(size_t offset, size_t recordSize) const {
+  BinaryReader r = reader(offset);
+  Array a;
+  a.count = r.u32();
+  a.offset = r.u32();
+  if (a.offset > length || a.count > (length - a.offset) / recordSize) {
+    throw CorruptFileError("Invalid array in project snapshot.");
+  }
+  return a;
+}
+
+
+
+char const* Snapshot::record(Array const& array, size_t recordSize, size_t i) const {
+  if (i >= array.count) {
+    throw CorruptFileError("Index out of range in project snapshot.");
+  }
+  return data + array.offset + i * recordSize;
+}
+
+
+
+std::string_view Snapshot::string(size_t offset) const {
+  BinaryReader r = reader(offset);
+  return string(r);
+}
+
+
+
+/**
+ * @brief Read a string reference and check that the string lies
+ * within the snapshot and is zero terminated.
+ */
+std::string_view Snapshot::string(BinaryReader& reader) const {
+  uint32_t offset = reader.u32();
+  uint32_t stringLength = reader.u32();
+  if (offset >= length || stringLength >= length - offset || data[offset + stringLength] != '\0') {
+    throw CorruptFileError("Invalid string in project snapshot.");
+  }
+  return std::string_view(data + offset, stringLength);
+}
+
+} // Namespace mswmm
@@ -0,0 +1,138 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#ifndef _MSWMM_SNAPSHOT_HPP
+#define _MSWMM_SNAPSHOT_HPP
+
+#include <string>
+#include <cstdint>
+#include <utility>
+#include <string_view>
+
+#include "Project.hpp"
+
+
+namespace mswmm {
+
+/**
+ * @brief A timeline item read from a snapshot. The strings point
+ * into the snapshot.
+ */
+struct SnapshotItem {
+  ItemType type;
+  bool isMuted;
+  bool fadesIn;
+  bool fadesOut;
+  float timelineStart;
+  float timelineEnd;
+  float sourceStart;
+  float sourceEnd;
+  float volume;
+  std::string_view name;
+  std::string_view srcPath;
+  std::string_view thumbnail;
+  std::string_view link;
+  EffectId transition;
+  std::string_view transitionGuid;
+  uint32_t firstEffect;
+  uint32_t effectCount;
+  uint32_t firstParameter;
+  uint32_t parameterCount;
+  uint64_t fileSizeKiB;
+  size srcSizePx;
+};
+
+
+
+/**
+ * @brief Read-only view of a binary snapshot written by
+ * exportSnapshot().
+ *
+ * The snapshot is a flat little endian image of the project model
+ * that is used in place: a fixed header is followed by arrays of
+ * fixed size records, which refer to each other by index and to
+ * strings by offset and length. Nothing is parsed up front; every
+ * accessor reads just its record, and strings are returned as views
+ * into the buffer, which has to outlive the snapshot. The records are
+ * accessed byte-wise, so the buffer needs no alignment.
+ *
+ * Layout, with offsets relative to the start of the snapshot and
+ * strings as (u32 offset, u32 length), zero terminated:
+ * - Header, 112 bytes: u64 magic, u32 total length, u32 flags (bit 0:
+ *   has title sequences), u32 aspect ratio x and y, five metadata
+ *   strings (author, title, description, copyright, rating), then
+ *   (u32 count, u32 offset) of the files, the video, audio and title
+ *   items, the effects and the parameters.
+ * - File, 8 bytes: its path.
+ * - Item, 96 bytes: u8 type, u8 flags (bit 0: muted, 1: fades in,
+ *   2: fades out), u8 EffectId of the transition, u8 padding, f32
+ *   timeline start and end, source start and end, volume, strings
+ *   name, path, thumbnail, shell link and transition GUID, u32 first
+ *   effect, effect count, first parameter, parameter count, u64 file
+ *   size in KiB, u32 width and height.
+ * - Effect, 12 bytes: u8 EffectId, 3 bytes padding, the GUID.
+ * - Parameter, 16 bytes: name and value.
+ * - Strings, each stored once.
+ *
+ * Malformed snapshots make the accessors throw a CorruptFileError.
+ */
+class Snapshot {
+  public:
+    Snapshot(char const* data, size_t length);
+
+    bool hasTitleSequences() const;
+    size aspectRatio() const;
+    std::string_view author() const { return string(24); }
+    std::string_view title() const { return string(32); }
+    std::string_view description() const { return string(40); }
+    std::string_view copyright() const { return string(48); }
+    std::string_view rating() const { return string(56); }
+
+    size_t fileCount() const { return files.count; }
+    std::string_view file(size_t i) const;
+    size_t itemCount(TrackType track) const { return tracks[trackIndex(track)].count; }
+    SnapshotItem item(TrackType track, size_t i) const;
+    std::pair<EffectId, std::string_view> effect(SnapshotItem const& item, size_t i) const;
+    std::pair<std::string_view, std::string_view> parameter(SnapshotItem const& item, size_t i) const;
+
+  private:
+    struct Array {
+      uint32_t count;
+      uint32_t offset;
+    };
+
+    static size_t trackIndex(TrackType track);
+    BinaryReader reader(size_t offset) const;
+    Array array(size_t offset, size_t recordSize) const;
+    char const* record(Array const& array, size_t recordSize, size_t i) const;
+    std::string_view string(size_t offset) const;
+    std::string_view string(BinaryReader& reader) const;
+
+    char const* data;
+    size_t length;
+    Array files;
+    Array tracks[3];
+    Array effects;
+    Array parameters;
+};
+
+
+
+std::string exportSnapshot(Project const& project);
+
+} // Namespace mswmm
+
+#endif
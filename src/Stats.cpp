@@ -0,0 +1,235 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <charconv>
+#include <algorithm>
+
+#include "Stats.hpp"
+#include "Json.hpp"
+
+
+namespace mswmm {
+
+static uint64_t now() {
+  auto time = std::chrono::steady_clock::now().time_since_epoch();
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(time).count();
+}
+
+
+
+char const* stageName(Stage stage) {
+  switch (stage) {
+    case Stage::READ_FILE:       return "read file";
+    case Stage::LOAD_CACHE:      return "load cache";
+    case Stage::STORE_CACHE:     return "store cache";
+    case Stage::PARSE_CONTAINER: return "parse container";
+    case Stage::FIND_STREAM:     return "find stream";
+    case Stage::READ_STREAM:     return "read stream";
+    case Stage::BUILD_DOM:       return "build DOM";
+    case Stage::PARSE_XML:       return "parse XML";
+    case Stage::ANALYZE_XML:     return "analyze XML";
+    case Stage::BUILD_INDEX:     return "build index";
+    case Stage::METADATA:        return "metadata";
+    case Stage::FILES:           return "files";
+    case Stage::VIDEO_TIMELINE:  return "video timeline";
+    case Stage::AUDIO_TIMELINE:  return "audio timeline";
+    case Stage::TITLE_TIMELINE:  return "title timeline";
+  }
+  return "";
+}
+
+
+
+static std::string milliseconds(uint64_t nanoseconds) {
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "%.3fms", nanoseconds / 1e6);
+  return buffer;
+}
+
+
+
+// Not printf, as a decimal comma would make the trace invalid JSON.
+static std::string microseconds(uint64_t nanoseconds) {
+  char buffer[32];
+  auto result = std::to_chars(buffer, buffer + sizeof(buffer), nanoseconds / 1e3, std::chars_format::fixed, 3);
+  return std::string(buffer, result.ptr);
+}
+
+
+
+void printStats(std::ostream& target, LoadStats const& stats, uint8_t indent) {
+  std::string i1(indent, ' ');
+  std::string i2(indent*2, ' ');
+  target << i1 << "Bytes read: " << stats.bytesRead << '\n'
+         << i1 << "Producer.Dat bytes: " << stats.producerDatBytes << '\n'
+         << i1 << "Allocations: " << stats.allocations << " (" << stats.allocatedBytes << " bytes)\n"
+         << i1 << "Tag lookups: " << stats.tagLookups << " (" << stats.siblingsVisited << " elements visited)\n"
+         << i1 << "UID lookups: " << stats.uidLookups << '\n'
+         << i1 << "Stages:\n";
+  for (auto const& stage: stats.stages) {
+    target << i2 << stageName(stage.stage) << ": " << milliseconds(stage.duration)
+           << ", " << stage.allocations << " allocations\n";
+  }
+}
+
+
+
+void StatsRecorder::addStage(StageStats const& stage) {
+  std::lock_guard<std::mutex> lock(mutex);
+  stages.push_back(stage);
+}
+
+
+
+LoadStats StatsRecorder::stats() const {
+  LoadStats s;
+  s.path = path;
+  s.bytesRead = bytesRead;
+  s.producerDatBytes = producerDatBytes;
+  s.allocations = allocations;
+  s.allocatedBytes = allocatedBytes;
+  s.tagLookups = tagLookups;
+  s.siblingsVisited = siblingsVisited;
+  s.uidLookups = uidLookups;
+  std::lock_guard<std::mutex> lock(mutex);
+  s.stages = stages;
+  return s;
+}
+
+
+
+void* StatsRecorder::do_allocate(size_t bytes, size_t alignment) {
+  ++allocations;
+  allocatedBytes += bytes;
+  return upstream->allocate(bytes, alignment);
+}
+
+
+
+void StatsRecorder::do_deallocate(void* p, size_t bytes, size_t alignment) {
+  upstream->deallocate(p, bytes, alignment);
+}
+
+
+
+bool StatsRecorder::do_is_equal(std::pmr::memory_resource const& other) const noexcept {
+  return this == &other;
+}
+
+
+
+StageTimer::StageTimer(StatsRecorder* recorder, Stage stage) : recorder(recorder) {
+  if (recorder) {
+    stats.stage = stage;
+    stats.thread = std::this_thread::get_id();
+    stats.allocations = recorder->allocations;
+    stats.allocatedBytes = recorder->allocatedBytes;
+    stats.start = now();
+  }
+}
+
+
+
+StageTimer::~StageTimer() {
+  if (recorder) {
+    stats.duration = now() - stats.start;
+    stats.allocations = recorder->allocations - stats.allocations;
+    stats.allocatedBytes = recorder->allocatedBytes - stats.allocatedBytes;
+    recorder->addStage(stats);
+  }
+}
+
+
+
+TraceWriter::TraceWriter() : origin(now()) {}
+
+
+
+/**
+ * @brief Add the stages of a project to the trace.
+ */
+void TraceWriter::add(LoadStats const& stats) {
+  if (stats.stages.empty()) {
+    return;
+  }
+  // Trace timestamps are in microseconds.
+  auto timestamp = [&](uint64_t time) {
+    return microseconds(time > origin ? time - origin : 0);
+  };
+
+  uint64_t start = UINT64_MAX;
+  uint64_t end = 0;
+  for (auto const& stage: stats.stages) {
+    start = std::min(start, stage.start);
+    end = std::max(end, stage.start + stage.duration);
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  auto tid = [&](std::thread::id thread) {
+    return std::to_string(threads.try_emplace(thread, threads.size() + 1).first->second);
+  };
+
+  std::string name = stats.path.empty() ? "project" : stats.path;
+  if (!events.empty()) {
+    events += ",\n";
+  }
+  events += "{\"name\":";
+  appendJsonString(events, name);
+  events += ",\"cat\":\"project\",\"ph\":\"X\",\"pid\":1,\"tid\":" + tid(stats.stages.front().thread) +
+            ",\"ts\":" + timestamp(start) + ",\"dur\":" + microseconds(end - start) + ",\"args\":{";
+  events += "\"bytesRead\":";
+  appendJsonNumber(events, stats.bytesRead);
+  events += ",\"producerDatBytes\":";
+  appendJsonNumber(events, stats.producerDatBytes);
+  events += ",\"allocations\":";
+  appendJsonNumber(events, stats.allocations);
+  events += ",\"allocatedBytes\":";
+  appendJsonNumber(events, stats.allocatedBytes);
+  events += ",\"tagLookups\":";
+  appendJsonNumber(events, stats.tagLookups);
+  events += ",\"siblingsVisited\":";
+  appendJsonNumber(events, stats.siblingsVisited);
+  events += ",\"uidLookups\":";
+  appendJsonNumber(events, stats.uidLookups);
+  events += "}}";
+
+  for (auto const& stage: stats.stages) {
+    events += ",\n{\"name\":\"";
+    events += stageName(stage.stage);
+    events += "\",\"cat\":\"stage\",\"ph\":\"X\",\"pid\":1,\"tid\":" + tid(stage.thread) +
+              ",\"ts\":" + timestamp(stage.start) + ",\"dur\":" + microseconds(stage.duration) + ",\"args\":{\"allocations\":";
+    appendJsonNumber(events, stage.allocations);
+    events += ",\"allocatedBytes\":";
+    appendJsonNumber(events, stage.allocatedBytes);
+    events += "}}";
+  }
+}
+
+
+
+/**
+ * @brief Get the trace in the JSON object format of the Trace Event
+ * Format.
+ */
+std::string TraceWriter::json() const {
+  std::lock_guard<std::mutex> lock(mutex);
+  return "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" + events + "\n]}\n";
+}
+
+} // Namespace mswmm
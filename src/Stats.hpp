@@ -0,0 +1,178 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#ifndef _MSWMM_STATS_HPP
+#define _MSWMM_STATS_HPP
+
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+#include <ostream>
+#include <unordered_map>
+#include <memory_resource>
+
+
+namespace mswmm {
+
+enum class Stage : uint8_t {
+  READ_FILE,
+  LOAD_CACHE,
+  STORE_CACHE,
+  PARSE_CONTAINER,
+  FIND_STREAM,
+  READ_STREAM,
+  BUILD_DOM,
+  PARSE_XML,
+  ANALYZE_XML,
+  BUILD_INDEX,
+  METADATA,
+  FILES,
+  VIDEO_TIMELINE,
+  AUDIO_TIMELINE,
+  TITLE_TIMELINE
+};
+
+
+
+char const* stageName(Stage stage);
+
+
+
+struct StageStats {
+  Stage stage;
+  // Times of the steady clock, in nanoseconds.
+  uint64_t start;
+  uint64_t duration;
+  // Allocations from the memory resource of the project while the
+  // stage ran, including those of stages running at the same time.
+  uint64_t allocations;
+  uint64_t allocatedBytes;
+  std::thread::id thread;
+};
+
+
+
+/**
+ * @brief Where the time went when loading a project, see
+ * LoadOptions::collectStats.
+ *
+ * Only allocations from the memory resource of the project are
+ * counted, which covers the buffers, element tree, indexes and
+ * timelines, but not Qt's DOM.
+ */
+struct LoadStats {
+  // Path of the project file; empty if it was loaded from memory.
+  std::string path;
+  // Size of the project file read or mapped.
+  uint64_t bytesRead = 0;
+  // Size of the Producer.Dat stream.
+  uint64_t producerDatBytes = 0;
+  uint64_t allocations = 0;
+  uint64_t allocatedBytes = 0;
+  // Linear searches for a child element by attribute value, and the
+  // elements they visited.
+  uint64_t tagLookups = 0;
+  uint64_t siblingsVisited = 0;
+  // Lookups of elements by UID or FileID.
+  uint64_t uidLookups = 0;
+  // In the order the stages ended. Stages can be nested, e.g. the
+  // extraction of sections when storing them in the cache.
+  std::vector<StageStats> stages;
+};
+
+
+
+void printStats(std::ostream& target, LoadStats const& stats, uint8_t indent = 0);
+
+
+
+/**
+ * @brief Collects the statistics of one project. It is the memory
+ * resource of the project, to count its allocations, and forwards
+ * them to the actual resource. Can be used from several threads.
+ */
+class StatsRecorder : public std::pmr::memory_resource {
+  public:
+    explicit StatsRecorder(std::pmr::memory_resource* upstream) : upstream(upstream) {}
+
+    void addStage(StageStats const& stage);
+    LoadStats stats() const;
+
+    std::string path;
+    std::atomic<uint64_t> bytesRead = 0;
+    std::atomic<uint64_t> producerDatBytes = 0;
+    std::atomic<uint64_t> allocations = 0;
+    std::atomic<uint64_t> allocatedBytes = 0;
+    std::atomic<uint64_t> tagLookups = 0;
+    std::atomic<uint64_t> siblingsVisited = 0;
+    std::atomic<uint64_t> uidLookups = 0;
+
+  private:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+    bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override;
+
+    std::pmr::memory_resource* upstream;
+    mutable std::mutex mutex;
+    std::vector<StageStats> stages;
+};
+
+
+
+/**
+ * @brief Measures a stage from construction to destruction. Does
+ * nothing if the recorder is null, i.e. statistics are not collected.
+ */
+class StageTimer {
+  public:
+    StageTimer(StatsRecorder* recorder, Stage stage);
+    ~StageTimer();
+    StageTimer(StageTimer const&) = delete;
+    StageTimer& operator=(StageTimer const&) = delete;
+
+  private:
+    StatsRecorder* recorder;
+    StageStats stats;
+};
+
+
+
+/**
+ * @brief Collects the stages of many projects as Chrome trace events,
+ * to be viewed in chrome://tracing or Perfetto. Every project also
+ * gets an event spanning all of its stages, named after its file.
+ * Can be used from several threads.
+ */
+class TraceWriter {
+  public:
+    TraceWriter();
+    void add(LoadStats const& stats);
+    std::string json() const;
+
+  private:
+    uint64_t origin;
+    mutable std::mutex mutex;
+    std::string events;
+    // Threads get small IDs in the order they are seen.
+    std::unordered_map<std::thread::id, size_t> threads;
+};
+
+} // Namespace mswmm
+
+#endif
@@ -0,0 +1,147 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#include <cstring>
+#include <algorithm>
+
+#include "StringTable.hpp"
+
+
+namespace mswmm {
+
+StringTable::StringTable(std::pmr::memory_resource* resource)
+  : blocks(resource),
+    blockUsed(blockSize),
+    strings(resource),
+    ids(resource)
+{
+  strings.emplace_back();
+  ids.emplace(std::string_view(), 0);
+}
+
+
+
+StringTable::StringTable(StringTable const& other) : StringTable(other.resource()) {
+  *this = other;
+}
+
+
+
+StringTable::StringTable(StringTable&& other) noexcept
+  : blocks(std::move(other.blocks)),
+    blockUsed(other.blockUsed),
+    strings(std::move(other.strings)),
+    ids(std::move(other.ids))
+{
+  other.blocks.clear();
+  other.blockUsed = blockSize;
+}
+
+
+
+StringTable& StringTable::operator=(StringTable const& other) {
+  if (this == &other) {
+    return *this;
+  }
+  // The views of the other table point into its blocks, so all
+  // strings have to be stored again, keeping their IDs.
+  release();
+  strings.clear();
+  ids.clear();
+  for (auto str: other.strings) {
+    auto stored = store(str);
+    ids.emplace(stored, strings.size());
+    strings.push_back(stored);
+  }
+  return *this;
+}
+
+
+
+StringTable& StringTable::operator=(StringTable&& other) {
+  if (this == &other) {
+    return *this;
+  }
+  // Blocks can only change hands if both tables use the same memory.
+  if (resource() != other.resource()) {
+    return *this = other;
+  }
+  release();
+  blocks = std::move(other.blocks);
+  blockUsed = other.blockUsed;
+  strings = std::move(other.strings);
+  ids = std::move(other.ids);
+  other.blocks.clear();
+  other.blockUsed = blockSize;
+  return *this;
+}
+
+
+
+StringTable::~StringTable() {
+  release();
+}
+
+
+
+/**
+ * @brief Get the ID of a string, adding it to the table if needed.
+ *
+ * @param str The string.
+ * @return StringId Its ID, which is equal for equal strings.
+ */
+StringId StringTable::intern(std::string_view str) {
+  auto it = ids.find(str);
+  if (it != ids.end()) {
+    return it->second;
+  }
+  auto stored = store(str);
+  StringId id = strings.size();
+  strings.push_back(stored);
+  ids.emplace(stored, id);
+  return id;
+}
+
+
+
+std::string_view StringTable::store(std::string_view str) {
+  if (str.empty()) {
+    return std::string_view();
+  }
+  // Strings bigger than a block get a block of their own.
+  if (blockUsed + str.size() > blockSize) {
+    size_t size = std::max(blockSize, str.size());
+    char* data = static_cast<char*>(resource()->allocate(size, 1));
+    blocks.push_back({data, size});
+    blockUsed = 0;
+  }
+  char* target = blocks.back().data + blockUsed;
+  std::memcpy(target, str.data(), str.size());
+  blockUsed += str.size();
+  return std::string_view(target, str.size());
+}
+
+
+
+void StringTable::release() {
+  for (auto const& b: blocks) {
+    resource()->deallocate(b.data, b.size, 1);
+  }
+  blocks.clear();
+  blockUsed = blockSize;
+}
+
+} // Namespace mswmm
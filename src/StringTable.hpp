@@ -0,0 +1,74 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#ifndef _MSWMM_STRINGTABLE_HPP
+#define _MSWMM_STRINGTABLE_HPP
+
+#include <vector>
+#include <cstdint>
+#include <string_view>
+#include <unordered_map>
+#include <memory_resource>
+
+
+namespace mswmm {
+
+using StringId = uint32_t;
+
+
+
+/**
+ * @brief Stores every distinct string only once and hands out small
+ * integer IDs for them.
+ *
+ * Strings are copied into large blocks, so interning does not
+ * allocate per string, and views returned by get() stay valid for the
+ * lifetime of the table. ID 0 is always the empty string. All memory
+ * comes from the memory resource given on construction.
+ */
+class StringTable {
+  public:
+    explicit StringTable(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    StringTable(StringTable const& other);
+    StringTable(StringTable&& other) noexcept;
+    StringTable& operator=(StringTable const& other);
+    StringTable& operator=(StringTable&& other);
+    ~StringTable();
+
+    StringId intern(std::string_view str);
+    std::string_view get(StringId id) const { return strings[id]; }
+    size_t size() const { return strings.size(); }
+    std::pmr::memory_resource* resource() const { return strings.get_allocator().resource(); }
+
+  private:
+    struct Block {
+      char* data;
+      size_t size;
+    };
+
+    std::string_view store(std::string_view str);
+    void release();
+
+    static constexpr size_t blockSize = 16 * 1024;
+    std::pmr::vector<Block> blocks;
+    size_t blockUsed;
+    std::pmr::vector<std::string_view> strings;
+    std::pmr::unordered_map<std::string_view, StringId> ids;
+};
+
+} // Namespace mswmm
+
+#endif
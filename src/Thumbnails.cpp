@@ -0,0 +1,178 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#include <cctype>
+#include <fstream>
+#include <filesystem>
+#include <unordered_map>
+
+#include "Thumbnails.hpp"
+#include "CompoundFile.hpp"
+#include "MappedFile.hpp"
+#include "Json.hpp"
+#include "Hash.hpp"
+
+
+namespace mswmm {
+
+/**
+ * @brief List all thumbnail streams of a project, and which items of
+ * the video timeline use them.
+ *
+ * @param reader The CFB container of the project.
+ * @param project The project loaded from the same container.
+ * @return std::vector<Thumbnail> The thumbnails, in stream order.
+ */
+std::vector<Thumbnail> listThumbnails(CFB::CompoundFileReader const& reader, Project const& project) {
+  std::vector<Thumbnail> thumbnails;
+  auto storage = findEntry(reader, u"ProducerData\\Thumbnails");
+  if (!storage || reader.IsStream(storage)) {
+    return thumbnails;
+  }
+
+  std::unordered_map<std::string, size_t> indices;
+  for (auto entry: listChildren(reader, storage)) {
+    if (!reader.IsStream(entry)) {
+      continue;
+    }
+    Thumbnail thumbnail;
+    thumbnail.stream = "Thumbnails\\" + entryName(entry);
+    thumbnail.entry = entry;
+    // The XML doesn't necessarily use the same case.
+    std::string key = thumbnail.stream;
+    for (char& c: key) {
+      c = std::tolower(static_cast<unsigned char>(c));
+    }
+    indices.emplace(std::move(key), thumbnails.size());
+    thumbnails.push_back(std::move(thumbnail));
+  }
+
+  Timeline const& timeline = project.videoTimeline();
+  for (size_t i = 0; i < timeline.size(); ++i) {
+    std::string key(timeline.thumbnail(timeline[i]));
+    for (char& c: key) {
+      c = std::tolower(static_cast<unsigned char>(c));
+    }
+    auto it = indices.find(key);
+    if (it != indices.end()) {
+      thumbnails[it->second].videoItems.push_back(i);
+    }
+  }
+  return thumbnails;
+}
+
+
+
+/**
+ * @brief Guess the file extension of a thumbnail from its first bytes.
+ * Movie Maker writes JPEG files, but other formats are recognized too.
+ *
+ * @return std::string The extension including the dot, ".bin" if unknown.
+ */
+std::string thumbnailExtension(CFB::CompoundFileReader const& reader, CFB::COMPOUND_FILE_ENTRY const* entry) {
+  unsigned char magic[4] = {0, 0, 0, 0};
+  if (entry->size >= sizeof(magic)) {
+    reader.ReadFile(entry, 0, reinterpret_cast<char*>(magic), sizeof(magic));
+  }
+  if (magic[0] == 0xFF && magic[1] == 0xD8 && magic[2] == 0xFF) {
+    return ".jpg";
+  }
+  if (magic[0] == 0x89 && magic[1] == 'P' && magic[2] == 'N' && magic[3] == 'G') {
+    return ".png";
+  }
+  if (magic[0] == 'B' && magic[1] == 'M') {
+    return ".bmp";
+  }
+  return ".bin";
+}
+
+
+
+/**
+ * @brief Write all thumbnails of a project into a directory of their
+ * own and describe them as a single line of JSON. Suitable as a
+ * BatchJob.
+ *
+ * The thumbnails are copied straight from the container, one chunk at
+ * a time, and are neither decoded nor held in memory as a whole.
+ *
+ * @param path Path to the .MSWMM file.
+ * @param outputDirectory The thumbnails are written to a subdirectory
+ * named after the project file and a hash of its path, so projects
+ * with the same name don't collide.
+ * @param options Options for loading the project.
+ * @param failed Set to whether the thumbnails could not be exported.
+ * @return std::string A JSON object, terminated by a newline.
+ */
+std::string exportThumbnails(std::string const& path, std::string const& outputDirectory,
+                             LoadOptions const& options, bool& failed)
+{
+  namespace fs = std::filesystem;
+  std::string json = "{\"path\":";
+  appendJsonString(json, path);
+
+  try {
+    MappedFile file(path);
+    char const* data = file.data();
+    size_t length = file.size();
+    Project project(data, length, options);
+    CFB::CompoundFileReader reader(data, length);
+    auto thumbnails = listThumbnails(reader, project);
+
+    fs::path directory = fs::path(outputDirectory) / (fs::path(path).stem().string() + "-" + hashPath(path));
+    if (!thumbnails.empty()) {
+      fs::create_directories(directory);
+    }
+    appendJsonField(json, "directory", directory.string());
+
+    json += ",\"thumbnails\":[";
+    for (size_t i = 0; i < thumbnails.size(); ++i) {
+      auto const& t = thumbnails[i];
+      // The names of the streams come from the file and could lead
+      // out of the directory, so the files are numbered instead.
+      std::string fileName = "thumbnail-" + std::to_string(i+1) + thumbnailExtension(reader, t.entry);
+      std::ofstream out(directory / fileName, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+      copyStream(reader, t.entry, out);
+      if (!out.good()) {
+        throw std::runtime_error("Can't write thumbnail '" + (directory / fileName).string() + "'.");
+      }
+
+      json += i == 0 ? "{\"stream\":" : ",{\"stream\":";
+      appendJsonString(json, t.stream);
+      appendJsonField(json, "file", fileName);
+      json += ",\"size\":" + std::to_string(t.entry->size);
+      json += ",\"videoItems\":[";
+      for (size_t j = 0; j < t.videoItems.size(); ++j) {
+        if (j != 0) {
+          json += ',';
+        }
+        json += std::to_string(t.videoItems[j]);
+      }
+      json += "]}";
+    }
+    json += ']';
+    failed = false;
+  }
+  catch (std::exception const& e) {
+    appendJsonField(json, "error", e.what());
+    failed = true;
+  }
+
+  json += "}\n";
+  return json;
+}
+
+} // Namespace mswmm
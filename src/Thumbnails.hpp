@@ -0,0 +1,53 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#ifndef _MSWMM_THUMBNAILS_HPP
+#define _MSWMM_THUMBNAILS_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "compoundfilereader.h"
+#include "Project.hpp"
+
+
+namespace mswmm {
+
+/**
+ * @brief A thumbnail stream in a project file.
+ *
+ * Movie Maker stores a small JPEG for every source file added to the
+ * timeline below ProducerData\Thumbnails; Thmb tags reference them.
+ */
+struct Thumbnail {
+  // Path below ProducerData, as in the XML, e.g. "Thumbnails\Data.1".
+  std::string stream;
+  CFB::COMPOUND_FILE_ENTRY const* entry;
+  // Indices of the video timeline items showing this thumbnail.
+  std::vector<size_t> videoItems;
+};
+
+
+
+std::vector<Thumbnail> listThumbnails(CFB::CompoundFileReader const& reader, Project const& project);
+std::string thumbnailExtension(CFB::CompoundFileReader const& reader, CFB::COMPOUND_FILE_ENTRY const* entry);
+std::string exportThumbnails(std::string const& path, std::string const& outputDirectory,
+                             LoadOptions const& options, bool& failed);
+
+} // Namespace mswmm
+
+#endif
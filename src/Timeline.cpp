@@ -0,0 +1,339 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#include <string>
+
+#include "Timeline.hpp"
+
+
+namespace mswmm {
+
+/**
+ * @brief Get the GUID of an effect applied to a timeline item.
+ *
+ * @param item The timeline item.
+ * @param i Index of the effect, smaller than item.effectCount.
+ */
+std::string_view Timeline::effect(TimelineItem const& item, size_t i) const {
+  return guid(effects[item.firstEffect + i]);
+}
+
+
+
+std::string_view Timeline::guid(Effect const& effect) const {
+  if (effect.id == EffectId::UNKNOWN) {
+    return strings.get(effect.guid);
+  }
+  return effectInfo(effect.id).guid;
+}
+
+
+
+/**
+ * @brief Get a parameter of a title sequence.
+ *
+ * @param item The timeline item.
+ * @param i Index of the parameter, smaller than item.parameterCount.
+ * @return The name and the value of the parameter.
+ */
+std::pair<std::string_view, std::string_view> Timeline::parameter(TimelineItem const& item, size_t i) const {
+  auto const& [name, value] = parameters[item.firstParameter + i];
+  return {strings.get(name), strings.get(value)};
+}
+
+
+
+/**
+ * @brief Append an item to the timeline.
+ *
+ * @param type The type of the item.
+ * @return TimelineItem& The new item, with all fields zeroed. The
+ * reference is only valid until the next item is added.
+ */
+TimelineItem& Timeline::addItem(ItemType type) {
+  TimelineItem& item = items.emplace_back();
+  item.type = type;
+  item.firstEffect = effects.size();
+  item.firstParameter = parameters.size();
+  return item;
+}
+
+
+
+/**
+ * @brief Add an effect to the item that was added last.
+ *
+ * @param guid The TFXGuid of the effect.
+ */
+void Timeline::addEffect(std::string_view guid) {
+  effects.push_back(makeEffect(guid, false));
+  ++items.back().effectCount;
+}
+
+
+
+/**
+ * @brief Set the transition to the item that was added last.
+ *
+ * @param guid The TFXGuid of the transition.
+ */
+void Timeline::setTransition(std::string_view guid) {
+  items.back().transition = makeEffect(guid, true);
+}
+
+
+
+/**
+ * @brief Look up an effect in the registry. Only the GUIDs of
+ * unknown effects are kept as strings.
+ */
+Effect Timeline::makeEffect(std::string_view guid, bool transition) {
+  EffectId id = findEffect(guid, transition);
+  return {id, id == EffectId::UNKNOWN ? strings.intern(guid) : StringId(0)};
+}
+
+
+
+/**
+ * @brief Add a parameter to the item that was added last.
+ */
+void Timeline::addParameter(std::string_view name, std::string_view value) {
+  parameters.emplace_back(strings.intern(name), strings.intern(value));
+  ++items.back().parameterCount;
+}
+
+
+
+void Timeline::reserve(size_t itemCount) {
+  items.reserve(itemCount);
+}
+
+
+
+/**
+ * @brief Write the items, effects and strings of the timeline.
+ *
+ * @param writer Where to write to.
+ */
+void Timeline::save(BinaryWriter& writer) const {
+  // ID 0 is always the empty string and doesn't have to be stored.
+  writer.u32(strings.size() - 1);
+  for (StringId id = 1; id < strings.size(); ++id) {
+    writer.string(strings.get(id));
+  }
+
+  writer.u32(effects.size());
+  for (Effect const& effect: effects) {
+    writer.u8(static_cast<uint8_t>(effect.id));
+    writer.u32(effect.guid);
+  }
+
+  writer.u32(parameters.size());
+  for (auto const& [name, value]: parameters) {
+    writer.u32(name);
+    writer.u32(value);
+  }
+
+  writer.u32(items.size());
+  for (auto const& item: items) {
+    writer.u8(static_cast<uint8_t>(item.type));
+    writer.u8(item.isMuted | item.fadesIn << 1 | item.fadesOut << 2);
+    writer.f32(item.timelineStart);
+    writer.f32(item.timelineEnd);
+    writer.f32(item.sourceStart);
+    writer.f32(item.sourceEnd);
+    writer.f32(item.volume);
+    writer.u32(item.name);
+    writer.u32(item.srcPath);
+    writer.u32(item.thumbnail);
+    writer.u32(item.link);
+    writer.u32(item.firstEffect);
+    writer.u32(item.effectCount);
+    writer.u8(static_cast<uint8_t>(item.transition.id));
+    writer.u32(item.transition.guid);
+    writer.u32(item.firstParameter);
+    writer.u32(item.parameterCount);
+    writer.u64(item.fileSizeKiB);
+    writer.u64(item.srcSizePx.x);
+    writer.u64(item.srcSizePx.y);
+  }
+}
+
+
+
+static Effect readEffect(BinaryReader& reader, StringTable const& strings) {
+  Effect effect;
+  uint8_t id = reader.u8();
+  effect.guid = reader.u32();
+  if (id >= static_cast<uint8_t>(EffectId::COUNT) || effect.guid >= strings.size()) {
+    throw CorruptFileError("Invalid effect in timeline data.");
+  }
+  effect.id = static_cast<EffectId>(id);
+  return effect;
+}
+
+
+
+/**
+ * @brief Replace the content of the timeline with what save() wrote.
+ * Throws a CorruptFileError if the data is not consistent.
+ *
+ * @param reader Where to read from.
+ */
+void Timeline::load(BinaryReader& reader) {
+  strings = StringTable(strings.resource());
+  effects.clear();
+  parameters.clear();
+  items.clear();
+
+  // Interning the strings in order gives them their old IDs, unless
+  // the data contains duplicates.
+  uint32_t stringCount = reader.u32();
+  for (uint32_t i = 1; i <= stringCount; ++i) {
+    if (strings.intern(reader.string()) != i) {
+      throw CorruptFileError("Duplicate string in timeline data.");
+    }
+  }
+
+  uint32_t effectCount = reader.u32();
+  for (uint32_t i = 0; i < effectCount; ++i) {
+    effects.push_back(readEffect(reader, strings));
+  }
+
+  uint32_t parameterCount = reader.u32();
+  for (uint32_t i = 0; i < parameterCount; ++i) {
+    StringId name = reader.u32();
+    StringId value = reader.u32();
+    if (name >= strings.size() || value >= strings.size()) {
+      throw CorruptFileError("Invalid parameter in timeline data.");
+    }
+    parameters.emplace_back(name, value);
+  }
+
+  uint32_t itemCount = reader.u32();
+  for (uint32_t i = 0; i < itemCount; ++i) {
+    uint8_t type = reader.u8();
+    if (type > static_cast<uint8_t>(ItemType::AUDIO)) {
+      throw CorruptFileError("Invalid item type in timeline data.");
+    }
+    TimelineItem& item = items.emplace_back();
+    item.type = static_cast<ItemType>(type);
+    uint8_t flags = reader.u8();
+    item.isMuted = flags & 1;
+    item.fadesIn = flags & 2;
+    item.fadesOut = flags & 4;
+    item.timelineStart = reader.f32();
+    item.timelineEnd = reader.f32();
+    item.sourceStart = reader.f32();
+    item.sourceEnd = reader.f32();
+    item.volume = reader.f32();
+    item.name = reader.u32();
+    item.srcPath = reader.u32();
+    item.thumbnail = reader.u32();
+    item.link = reader.u32();
+    item.firstEffect = reader.u32();
+    item.effectCount = reader.u32();
+    item.transition = readEffect(reader, strings);
+    item.firstParameter = reader.u32();
+    item.parameterCount = reader.u32();
+    item.fileSizeKiB = reader.u64();
+    item.srcSizePx.x = reader.u64();
+    item.srcSizePx.y = reader.u64();
+    if (item.name >= strings.size() || item.srcPath >= strings.size() || item.thumbnail >= strings.size()
+        || item.link >= strings.size()
+        || item.firstEffect > effects.size() || item.effectCount > effects.size() - item.firstEffect
+        || item.firstParameter > parameters.size() || item.parameterCount > parameters.size() - item.firstParameter) {
+      throw CorruptFileError("Invalid item in timeline data.");
+    }
+  }
+}
+
+
+
+void Timeline::print(std::ostream& target, uint8_t indent) const {
+  for (auto const& item: items) {
+    printItem(target, item, indent);
+  }
+}
+
+
+
+void Timeline::printItem(std::ostream& target, TimelineItem const& item, uint8_t indent) const {
+  std::string i1 = std::string(indent,   ' ');
+  std::string i2 = std::string(indent*2, ' ');
+
+  if (item.type == ItemType::TITLE) {
+    target << i1 << "Title from " << item.timelineStart << "s to " << item.timelineEnd << "s\n";
+    printEffects(target, item, indent);
+    if (item.parameterCount > 0) {
+      target << i2 << "- Parameters:\n";
+      for (size_t p = 0; p < item.parameterCount; ++p) {
+        auto [name, value] = parameter(item, p);
+        target << std::string(indent*3, ' ') << "- " << name << ": " << value << '\n';
+      }
+    }
+    return;
+  }
+
+  target << i1 << "'" << name(item) << "' from " << item.timelineStart << "s to " << item.timelineEnd << "s\n"
+         << i2 << "- Path: " << srcPath(item) << "\n";
+  if (item.type != ItemType::STILL) {
+    target << i2 << "- Part taken from file: " << item.sourceStart << "s to " << item.sourceEnd << "s\n";
+  }
+  target << i2 << "- File size: ca. " << item.fileSizeKiB << "KiB\n";
+  if (item.type != ItemType::AUDIO) {
+    target << i2 << "- Width x Height: " << item.srcSizePx.x << "px x " << item.srcSizePx.y << "px\n";
+    printEffects(target, item, indent);
+    return;
+  }
+
+  if (item.volume != 1) {
+    target << i2 << "- Volume: " << item.volume << '\n';
+  }
+  if (item.isMuted) {
+    target << i2 << "- Is muted\n";
+  }
+
+  std::string fade;
+  if (item.fadesIn) {
+    fade = "in";
+  }
+  if (item.fadesOut) {
+    if (!fade.empty()) {
+      fade += " &";
+    }
+    fade += " out";
+  }
+  if (!fade.empty()) {
+    target << i2 << "- Fades " << fade << '\n';
+  }
+}
+
+
+
+void Timeline::printEffects(std::ostream& target, TimelineItem const& item, uint8_t indent) const {
+  if (item.transition.id != EffectId::NONE) {
+    target << std::string(indent*2, ' ') << "- Transition from previous item: " << transition(item) << '\n';
+  }
+  if (item.effectCount > 0) {
+    target << std::string(indent*2, ' ') << "- Effects:\n";
+    for (size_t i = 0; i < item.effectCount; ++i) {
+      target << std::string(indent*3, ' ') << "- " << effect(item, i) << '\n';
+    }
+  }
+}
+
+} // Namespace mswmm
@@ -0,0 +1,91 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#ifndef _MSWMM_TIMELINE_HPP
+#define _MSWMM_TIMELINE_HPP
+
+#include <vector>
+#include <utility>
+#include <ostream>
+#include <string_view>
+#include <memory_resource>
+
+#include "Binary.hpp"
+#include "StringTable.hpp"
+#include "TimelineItem.hpp"
+
+
+namespace mswmm {
+
+/**
+ * @brief The items of one track, in timeline order.
+ *
+ * Items are stored by value in one vector, and all of their strings
+ * (names, paths and parameters) are interned in a string table owned
+ * by the timeline, so walking a timeline touches contiguous memory
+ * only. Effects are stored by their EffectId.
+ */
+class Timeline {
+  public:
+    using const_iterator = std::pmr::vector<TimelineItem>::const_iterator;
+
+    explicit Timeline(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+      : items(resource), effects(resource), parameters(resource), strings(resource) {}
+
+    const_iterator begin() const { return items.begin(); }
+    const_iterator end() const { return items.end(); }
+    TimelineItem const& operator[](size_t i) const { return items[i]; }
+    size_t size() const { return items.size(); }
+    bool empty() const { return items.empty(); }
+
+    std::string_view name(TimelineItem const& item) const { return strings.get(item.name); }
+    std::string_view srcPath(TimelineItem const& item) const { return strings.get(item.srcPath); }
+    std::string_view thumbnail(TimelineItem const& item) const { return strings.get(item.thumbnail); }
+    std::string_view link(TimelineItem const& item) const { return strings.get(item.link); }
+    std::string_view effect(TimelineItem const& item, size_t i) const;
+    EffectId effectId(TimelineItem const& item, size_t i) const { return effects[item.firstEffect + i].id; }
+    std::string_view transition(TimelineItem const& item) const { return guid(item.transition); }
+    std::pair<std::string_view, std::string_view> parameter(TimelineItem const& item, size_t i) const;
+    StringTable const& stringTable() const { return strings; }
+
+    TimelineItem& addItem(ItemType type);
+    StringId intern(std::string_view str) { return strings.intern(str); }
+    void addEffect(std::string_view guid);
+    void setTransition(std::string_view guid);
+    void addParameter(std::string_view name, std::string_view value);
+    void reserve(size_t itemCount);
+
+    void save(BinaryWriter& writer) const;
+    void load(BinaryReader& reader);
+
+    void print(std::ostream& target, uint8_t indent = 0) const;
+    void printItem(std::ostream& target, TimelineItem const& item, uint8_t indent = 0) const;
+
+  private:
+    Effect makeEffect(std::string_view guid, bool transition);
+    std::string_view guid(Effect const& effect) const;
+    void printEffects(std::ostream& target, TimelineItem const& item, uint8_t indent) const;
+
+    std::pmr::vector<TimelineItem> items;
+    std::pmr::vector<Effect> effects;
+    // Names and values of the parameters of title sequences.
+    std::pmr::vector<std::pair<StringId, StringId>> parameters;
+    StringTable strings;
+};
+
+} // Namespace mswmm
+
+#endif
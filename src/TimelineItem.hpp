@@ -17,9 +17,11 @@ See LICENSE file for the full license text.
 #ifndef _TIMELINEITEM_HPP
 #define _TIMELINEITEM_HPP
 
-#include <string>
-#include <vector>
-#include <ostream>
+#include <cstddef>
+#include <cstdint>
+
+#include "Effects.hpp"
+#include "StringTable.hpp"
 
 
 namespace mswmm {
@@ -42,108 +44,58 @@ struct size {
 
 
 
-struct TimelineItem {
-  float timelineStart;
-  float timelineEnd;
-  std::vector<std::string> effects;
-
-  virtual ~TimelineItem() = default;
-  virtual void printItem(std::ostream& target, uint8_t indent = 0) const = 0;
-  virtual void printEffects(std::ostream& target, uint8_t indent = 0) const {
-    if (!effects.empty()) {
-      target << std::string(indent*2, ' ') << "- Effects:\n";
-      for (auto const& e: effects) {
-        target << std::string(indent*3, ' ') << "- " << e << '\n';
-      }
-    }
-  }
-};
-
-
-
-struct TimelineTitleItem : public TimelineItem {
-  //std::string type;
-  void printItem(std::ostream& target, uint8_t indent = 0) const override {
-    std::string indentStr = std::string(indent, ' ');
-    target << indentStr << "Title from " << timelineStart << "s to " << timelineEnd << "s\n";
-    printEffects(target, indent);
-  }
-};
-
-
-
-struct TimelineStillItem : public TimelineItem {
-  std::string srcPath;
-  std::string name;
-  size_t fileSizeKiB;
-  size srcSizePx;
-
-  void printItem(std::ostream& target, uint8_t indent = 0) const override {
-    std::string i1 = std::string(indent,   ' ');
-    std::string i2 = std::string(indent*2, ' ');
-    target << i1 << "'" << name << "' from " << timelineStart << "s to " << timelineEnd << "s\n"
-           << i2 << "- Path: " << srcPath << "\n"
-           << i2 << "- File size: ca. " << fileSizeKiB << "KiB\n"
-           << i2 << "- Width x Height: " << srcSizePx.x << "px x " << srcSizePx.y << "px\n";
-    printEffects(target, indent);
-  }
-};
-
-
-
-struct TimelineVideoItem : public TimelineStillItem {
-  float sourceStart;
-  float sourceEnd;
-
-  void printItem(std::ostream& target, uint8_t indent = 0) const override {
-    std::string i1 = std::string(indent,   ' ');
-    std::string i2 = std::string(indent*2, ' ');
-    target << i1 << "'" << name << "' from " << timelineStart << "s to " << timelineEnd << "s\n"
-           << i2 << "- Path: " << srcPath << "\n"
-           << i2 << "- Part taken from file: " << sourceStart << "s to " << sourceEnd << "s\n"
-           << i2 << "- File size: ca. " << fileSizeKiB << "KiB\n"
-           << i2 << "- Width x Height: " << srcSizePx.x << "px x " << srcSizePx.y << "px\n";
-    printEffects(target, indent);
-  }
+enum class ItemType : uint8_t {
+  TITLE,
+  STILL,
+  VIDEO,
+  AUDIO
 };
 
 
 
-struct TimelineAudioItem : TimelineVideoItem {
+/**
+ * @brief One section of a timeline.
+ *
+ * This is a plain value, stored contiguously in a Timeline. Strings
+ * are IDs into the string table of that timeline, and effects are a
+ * range in its effect list. Which fields are meaningful depends on
+ * the type:
+ * - TITLE: only the timeline position, effects, transition and
+ *   parameters, see Timeline::parameter()
+ * - STILL: additionally name, path, file size, dimensions, thumbnail
+ *   and shell link
+ * - VIDEO: additionally the part taken from the source file
+ * - AUDIO: like VIDEO, plus mute, fades and volume, but no dimensions
+ *   and no thumbnail
+ */
+struct TimelineItem {
+  ItemType type;
   bool isMuted;
   bool fadesIn;
   bool fadesOut;
+  float timelineStart;
+  float timelineEnd;
+  float sourceStart;
+  float sourceEnd;
   float volume;
+  StringId name;
+  StringId srcPath;
+  // Path of the thumbnail stream below ProducerData, e.g. "Thumbnails\Data.1".
+  StringId thumbnail;
+  // Path of the ShellLink stream pointing to the source file, e.g.
+  // "ShellLink\Data.3"; see readShellLink().
+  StringId link;
+  uint32_t firstEffect;
+  uint32_t effectCount;
+  // The transition from the previous item on the track; NONE if
+  // they don't overlap.
+  Effect transition;
+  uint32_t firstParameter;
+  uint32_t parameterCount;
+  size_t fileSizeKiB;
+  size srcSizePx;
 
-  void printItem(std::ostream& target, uint8_t indent = 0) const override {
-    std::string i1 = std::string(indent,   ' ');
-    std::string i2 = std::string(indent*2, ' ');
-    target << i1 << "'" << name << "' from " << timelineStart << "s to " << timelineEnd << "s\n"
-           << i2 << "- Path: " << srcPath << "\n"
-           << i2 << "- Part taken from file: " << sourceStart << "s to " << sourceEnd << "s\n"
-           << i2 << "- File size: ca. " << fileSizeKiB << "KiB\n";
-
-    if (volume != 1) {
-      target << i2 << "- Volume: " << volume << '\n';
-    }
-    if (isMuted) {
-      target << i2 << "- Is muted\n";
-    }
-
-    std::string fade;
-    if (fadesIn) {
-      fade = "in";
-    }
-    if (fadesOut) {
-      if (!fade.empty()) {
-        fade += " &";
-      }
-      fade += " out";
-    }
-    if (!fade.empty()) {
-      target << i2 << "- Fades " << fade << '\n';
-    }
-  }
+  bool hasSource() const { return type != ItemType::TITLE; }
 };
 
 } // Namespace mswmm
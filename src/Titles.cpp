@@ -0,0 +1,190 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#include <cctype>
+#include <cstdio>
+#include <algorithm>
+#include <string_view>
+
+#include "Titles.hpp"
+
+
+namespace mswmm {
+
+/**
+ * @brief Reduce a parameter name to the part that tells what it is.
+ * Prefixes of nested elements ("TiTitlePtr.") and of effect
+ * semantics ("3:Semantics/") are removed, as well as the keyframe
+ * of effect parameters ("(0.000000,8)"). The result is lower case.
+ */
+static std::string baseName(std::string_view name) {
+  name = name.substr(0, name.find('('));
+  size_t separator = name.find_last_of(".:/");
+  if (separator != std::string_view::npos) {
+    name.remove_prefix(separator + 1);
+  }
+  std::string base(name);
+  for (char& c: base) {
+    c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  }
+  return base;
+}
+
+
+
+/**
+ * @brief Check if a base name is that of a line of text, like
+ * "text", "text2" or "titletext1".
+ */
+static bool isText(std::string_view base) {
+  for (std::string_view prefix: {"titletext", "text"}) {
+    if (base.substr(0, prefix.size()) == prefix) {
+      base.remove_prefix(prefix.size());
+      return std::all_of(base.begin(), base.end(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)); });
+    }
+  }
+  return false;
+}
+
+
+
+/**
+ * @brief Get the title sequences of the video and the title track.
+ * This extracts both timelines.
+ *
+ * The parameters of the items are matched by name, ignoring case and
+ * the element they were found in: lines of text are called "Text" or
+ * "TitleText", optionally numbered; the font "Font", "FontFace" or
+ * "FontName"; the animation "Animation", otherwise the TFXName of the
+ * element the title refers to. Transitions are found below the
+ * TAVTransition and TAVTransitionRight elements.
+ */
+std::vector<Title> getTitles(Project const& project) {
+  std::vector<Title> titles;
+  for (TrackType track: {TrackType::VIDEO, TrackType::SOMETHING}) {
+    Timeline const& timeline = track == TrackType::VIDEO ? project.videoTimeline() : project.titleTimeline();
+    for (size_t i = 0; i < timeline.size(); ++i) {
+      TimelineItem const& item = timeline[i];
+      if (item.type != ItemType::TITLE) {
+        continue;
+      }
+      Title& title = titles.emplace_back();
+      title.track = track;
+      title.item = i;
+      title.start = item.timelineStart;
+      title.end = item.timelineEnd;
+      std::string_view effectName;
+      for (size_t p = 0; p < item.parameterCount; ++p) {
+        auto [name, value] = timeline.parameter(item, p);
+        std::string base = baseName(name);
+        if (value.empty()) {
+          continue;
+        }
+        // Parameters of the transitions only tell which they are.
+        if (name.substr(0, 13) == "TAVTransition") {
+          if (base == "tfxguid") {
+            bool right = name.substr(0, 18) == "TAVTransitionRight";
+            (right ? title.transitionOut : title.transitionIn) = value;
+          }
+          continue;
+        }
+        if (isText(base)) {
+          if (!title.text.empty()) {
+            title.text += '\n';
+          }
+          title.text += value;
+        }
+        else if (title.font.empty() && (base == "font" || base == "fontface" || base == "fontname")) {
+          title.font = value;
+        }
+        else if (base == "animation") {
+          title.animation = value;
+        }
+        else if (effectName.empty() && base == "tfxname" && name.find('.') != std::string_view::npos) {
+          effectName = value;
+        }
+      }
+      if (title.animation.empty()) {
+        title.animation = effectName;
+      }
+    }
+  }
+  // Titles of both tracks in the order they appear.
+  std::stable_sort(titles.begin(), titles.end(), [](Title const& a, Title const& b) {
+    return a.start < b.start;
+  });
+  return titles;
+}
+
+
+
+static std::string srtTime(float seconds) {
+  long ms = static_cast<long>(std::max(seconds, 0.0f) * 1000 + 0.5f);
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "%02ld:%02ld:%02ld,%03ld",
+                ms / 3600000, ms / 60000 % 60, ms / 1000 % 60, ms % 1000);
+  return buffer;
+}
+
+
+
+/**
+ * @brief Get the text of a title as lines of a SubRip cue. A blank
+ * line ends the cue, so empty lines are dropped, and Windows line
+ * breaks become plain ones.
+ */
+static std::string srtText(std::string_view text) {
+  std::string lines;
+  size_t begin = 0;
+  while (begin < text.size()) {
+    size_t end = text.find_first_of("\r\n", begin);
+    if (end == std::string_view::npos) {
+      end = text.size();
+    }
+    std::string_view line = text.substr(begin, end - begin);
+    if (line.find_first_not_of(" \t") != std::string_view::npos) {
+      if (!lines.empty()) {
+        lines += '\n';
+      }
+      lines += line;
+    }
+    begin = end + 1;
+  }
+  return lines;
+}
+
+
+
+/**
+ * @brief Write the text of all title sequences as SubRip subtitles,
+ * e.g. to add them as a subtitle stream to a rendered project.
+ * Titles without text are skipped.
+ */
+std::string generateSubtitles(Project const& project) {
+  std::string srt;
+  size_t number = 0;
+  for (auto const& title: getTitles(project)) {
+    std::string text = srtText(title.text);
+    if (text.empty()) {
+      continue;
+    }
+    srt += std::to_string(++number) + '\n' + srtTime(title.start) + " --> " + srtTime(title.end) + '\n'
+           + text + "\n\n";
+  }
+  return srt;
+}
+
+} // Namespace mswmm
@@ -0,0 +1,59 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#ifndef _MSWMM_TITLES_HPP
+#define _MSWMM_TITLES_HPP
+
+#include <string>
+#include <vector>
+
+#include "Project.hpp"
+
+
+namespace mswmm {
+
+/**
+ * @brief A title sequence, interpreted from the parameters of a
+ * timeline item.
+ *
+ * Titles on the video track are shown on black, those on the title
+ * track are overlaid on the video.
+ */
+struct Title {
+  TrackType track;
+  // Index of the item in its timeline.
+  size_t item;
+  float start;
+  float end;
+  // Lines are separated by '\n'. Empty if no text could be found.
+  std::string text;
+  std::string font;
+  // E.g. "Fade, In and Out"; empty if unknown.
+  std::string animation;
+  // TFXGuid of the transitions from the previous item and to the
+  // next one, e.g. "TFX\Fade"; empty if there is none.
+  std::string transitionIn;
+  std::string transitionOut;
+};
+
+
+
+std::vector<Title> getTitles(Project const& project);
+std::string generateSubtitles(Project const& project);
+
+} // Namespace mswmm
+
+#endif
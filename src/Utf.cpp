@@ -0,0 +1,212 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define MSWMM_UTF_SSE2
+#include <immintrin.h>
+#endif
+#if defined(MSWMM_UTF_SSE2) && (defined(__GNUC__) || defined(__clang__))
+#define MSWMM_UTF_AVX2
+#endif
+
+#include "Utf.hpp"
+
+
+namespace mswmm {
+
+// Almost all of a Producer.Dat is ASCII, so the conversion is built
+// around a kernel that copies the leading ASCII characters of a UTF-16
+// string and stops at the first other one, which is then encoded by
+// the scalar code. The kernel is picked once, depending on the CPU.
+using AsciiKernel = size_t (*)(char* target, char16_t const* source, size_t length);
+
+
+
+static size_t copyAsciiScalar(char* target, char16_t const* source, size_t length) {
+  size_t i = 0;
+  while (i < length && source[i] < 0x80) {
+    target[i] = static_cast<char>(source[i]);
+    ++i;
+  }
+  return i;
+}
+
+
+
+#ifdef MSWMM_UTF_SSE2
+
+/**
+ * @brief Copy ASCII characters 16 at a time. SSE2 is part of every
+ * x86-64 CPU, so this needs no detection.
+ */
+static size_t copyAsciiSse2(char* target, char16_t const* source, size_t length) {
+  __m128i const nonAscii = _mm_set1_epi16(static_cast<short>(0xFF80));
+  size_t i = 0;
+  for (; i + 16 <= length; i += 16) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<__m128i const*>(source + i));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<__m128i const*>(source + i + 8));
+    __m128i high = _mm_and_si128(_mm_or_si128(a, b), nonAscii);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi16(high, _mm_setzero_si128())) != 0xFFFF) {
+      break;
+    }
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(target + i), _mm_packus_epi16(a, b));
+  }
+  return i + copyAsciiScalar(target + i, source + i, length - i);
+}
+
+#endif
+
+
+
+#ifdef MSWMM_UTF_AVX2
+
+/**
+ * @brief Copy ASCII characters 32 at a time, on CPUs with AVX2.
+ */
+__attribute__((target("avx2")))
+static size_t copyAsciiAvx2(char* target, char16_t const* source, size_t length) {
+  __m256i const nonAscii = _mm256_set1_epi16(static_cast<short>(0xFF80));
+  size_t i = 0;
+  for (; i + 32 <= length; i += 32) {
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(source + i));
+    __m256i b = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(source + i + 16));
+    if (!_mm256_testz_si256(_mm256_or_si256(a, b), nonAscii)) {
+      break;
+    }
+    // Packing works on 128 bit lanes, which puts the quarters of the
+    // result in the order a0 b0 a1 b1.
+    __m256i packed = _mm256_packus_epi16(a, b);
+    packed = _mm256_permute4x64_epi64(packed, 0xD8);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(target + i), packed);
+  }
+  // The rest is done here instead of calling copyAsciiSse2(), as
+  // switching from AVX to legacy SSE code costs more than it saves.
+  __m128i const nonAscii128 = _mm_set1_epi16(static_cast<short>(0xFF80));
+  for (; i + 8 <= length; i += 8) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<__m128i const*>(source + i));
+    if (!_mm_testz_si128(a, nonAscii128)) {
+      break;
+    }
+    _mm_storel_epi64(reinterpret_cast<__m128i*>(target + i), _mm_packus_epi16(a, a));
+  }
+  return i + copyAsciiScalar(target + i, source + i, length - i);
+}
+
+#endif
+
+
+
+static AsciiKernel selectAsciiKernel() {
+#ifdef MSWMM_UTF_AVX2
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return copyAsciiAvx2;
+  }
+#endif
+#ifdef MSWMM_UTF_SSE2
+  return copyAsciiSse2;
+#else
+  return copyAsciiScalar;
+#endif
+}
+
+
+
+/**
+ * @brief Convert UTF-16 to UTF-8 and append it to a string.
+ * Unpaired surrogates are replaced by U+FFFD, like QString does.
+ * Reusing the target string avoids allocations once its capacity
+ * suffices.
+ *
+ * @param target The string to append to.
+ * @param source The UTF-16 text.
+ */
+void appendUtf8(std::string& target, std::u16string_view source) {
+  static AsciiKernel const copyAscii = selectAsciiKernel();
+
+  // No character takes more than three bytes per UTF-16 code unit.
+  size_t start = target.size();
+  size_t length = source.size();
+  target.resize(start + length*3);
+  char* out = target.data() + start;
+
+  for (size_t i = 0; i < length; ++i) {
+    size_t ascii = copyAscii(out, source.data() + i, length - i);
+    out += ascii;
+    i += ascii;
+    if (i == length) {
+      break;
+    }
+
+    char32_t c = source[i];
+    if (c >= 0xD800 && c <= 0xDFFF) {
+      bool isPair = c <= 0xDBFF && i+1 < length &&
+                    source[i+1] >= 0xDC00 && source[i+1] <= 0xDFFF;
+      if (isPair) {
+        c = 0x10000 + ((c - 0xD800) << 10) + (source[i+1] - 0xDC00);
+        ++i;
+      }
+      else {
+        c = 0xFFFD;
+      }
+    }
+
+    if (c < 0x800) {
+      *out++ = static_cast<char>(0xC0 | (c >> 6));
+      *out++ = static_cast<char>(0x80 | (c & 0x3F));
+    }
+    else if (c < 0x10000) {
+      *out++ = static_cast<char>(0xE0 | (c >> 12));
+      *out++ = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+      *out++ = static_cast<char>(0x80 | (c & 0x3F));
+    }
+    else {
+      *out++ = static_cast<char>(0xF0 | (c >> 18));
+      *out++ = static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+      *out++ = static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+      *out++ = static_cast<char>(0x80 | (c & 0x3F));
+    }
+  }
+  target.resize(out - target.data());
+}
+
+
+
+/**
+ * @brief Remove leading and trailing whitespace and zeros without
+ * copying, e.g. the line break and zero termination Movie Maker
+ * writes after the XML.
+ *
+ * @param str The text to trim.
+ * @return std::u16string_view A view into str.
+ */
+std::u16string_view trimWhitespace(std::u16string_view str) {
+  auto isSpace = [](char16_t c) {
+    return c == u' ' || c == u'\t' || c == u'\n' || c == u'\r' || c == u'\0';
+  };
+  size_t begin = 0;
+  size_t end = str.size();
+  while (begin < end && isSpace(str[begin])) {
+    ++begin;
+  }
+  while (end > begin && isSpace(str[end-1])) {
+    --end;
+  }
+  return str.substr(begin, end - begin);
+}
+
+} // Namespace mswmm
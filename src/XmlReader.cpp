@@ -0,0 +1,668 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#include <string>
+#include <vector>
+#include <type_traits>
+#ifdef MSWMM_WITH_QT
+#include <QXmlStreamReader>
+#endif
+
+#include "XmlReader.hpp"
+#include "Error.hpp"
+#include "Utf.hpp"
+
+
+namespace mswmm {
+
+/**
+ * @brief The embedded pull parser behind readXml(), for UTF-16 or
+ * UTF-8 text.
+ *
+ * Elements and attributes are added to the tree as soon as they are
+ * read. Names and values without references are taken from the text
+ * as they are, or converted to UTF-8 in a reused buffer, so nothing is
+ * allocated per element or attribute.
+ * Well-formedness is checked as far as it matters for the tree: tags
+ * have to match, attribute values have to be quoted and references
+ * have to be known. Namespaces are not processed, so prefixed names
+ * are kept as they are, and a DTD is skipped. UTF-8 text is expected
+ * to be valid, it is not checked again.
+ */
+template<typename Char>
+class XmlScanner {
+  public:
+    using View = std::basic_string_view<Char>;
+
+    XmlScanner(View xml, XmlTree& tree) : xml(xml), pos(0), tree(tree) {}
+    void parse();
+
+  private:
+    static char32_t code(Char c) { return static_cast<std::make_unsigned_t<Char>>(c); }
+    static bool isSpace(Char c) { return c == ' ' || c == '\t' || c == '\n' || c == '\r'; }
+    static bool isNameChar(Char c);
+    static bool equals(View text, char const* ascii);
+
+    bool atEnd() const { return pos >= xml.size(); }
+    Char peek() const { return atEnd() ? Char(0) : xml[pos]; }
+    bool startsWith(char const* ascii) const;
+    bool skipSpace();
+    void skipUntil(char const* terminator);
+    void skipDoctype();
+    View readName();
+    void readStartTag();
+    void readEndTag();
+    void readAttribute();
+    void decodeValue(View raw, size_t offset);
+    void appendReference(View reference, size_t offset);
+    void appendChar(char32_t c);
+    std::string_view toUtf8(View text, std::string& buffer) const;
+    [[noreturn]] void fail(char const* message) const;
+
+    View xml;
+    size_t pos;
+    XmlTree& tree;
+    // Names of the open elements, to match the end tags against.
+    std::vector<View> openTags;
+    // Attribute values with references or line breaks are decoded
+    // into this buffer first; the others are passed on directly.
+    std::basic_string<Char> decoded;
+    // Buffers for converting names and values from UTF-16.
+    std::string name;
+    std::string value;
+};
+
+
+
+template<typename Char>
+bool XmlScanner<Char>::isNameChar(Char c) {
+  char32_t u = code(c);
+  return u >= 0x80 || (u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z') || (u >= '0' && u <= '9')
+         || u == '_' || u == ':' || u == '-' || u == '.';
+}
+
+
+
+template<typename Char>
+bool XmlScanner<Char>::equals(View text, char const* ascii) {
+  size_t i = 0;
+  for (; ascii[i] != '\0'; ++i) {
+    if (i == text.size() || code(text[i]) != static_cast<unsigned char>(ascii[i])) {
+      return false;
+    }
+  }
+  return i == text.size();
+}
+
+
+
+template<typename Char>
+bool XmlScanner<Char>::startsWith(char const* ascii) const {
+  for (size_t i = 0; ascii[i] != '\0'; ++i) {
+    if (pos + i >= xml.size() || code(xml[pos + i]) != static_cast<unsigned char>(ascii[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+
+/**
+ * @brief Skip whitespace.
+ *
+ * @return bool Whether there was any.
+ */
+template<typename Char>
+bool XmlScanner<Char>::skipSpace() {
+  size_t start = pos;
+  while (!atEnd() && isSpace(xml[pos])) {
+    ++pos;
+  }
+  return pos != start;
+}
+
+
+
+/**
+ * @brief Skip comments, processing instructions and CDATA sections,
+ * up to and including their terminator.
+ */
+template<typename Char>
+void XmlScanner<Char>::skipUntil(char const* terminator) {
+  while (!atEnd() && !startsWith(terminator)) {
+    ++pos;
+  }
+  if (atEnd()) {
+    fail("Premature end of document.");
+  }
+  pos += std::char_traits<char>::length(terminator);
+}
+
+
+
+/**
+ * @brief Skip the document type declaration, including an internal
+ * subset in brackets. Entities declared there are not supported.
+ */
+template<typename Char>
+void XmlScanner<Char>::skipDoctype() {
+  Char quote = 0;
+  int depth = 0;
+  for (; !atEnd(); ++pos) {
+    Char c = xml[pos];
+    if (quote != 0) {
+      if (c == quote) {
+        quote = 0;
+      }
+    }
+    else if (c == '"' || c == '\'') {
+      quote = c;
+    }
+    else if (c == '[') {
+      ++depth;
+    }
+    else if (c == ']') {
+      --depth;
+    }
+    else if (c == '>' && depth <= 0) {
+      ++pos;
+      return;
+    }
+  }
+  fail("Premature end of document.");
+}
+
+
+
+template<typename Char>
+typename XmlScanner<Char>::View XmlScanner<Char>::readName() {
+  size_t start = pos;
+  while (!atEnd() && isNameChar(xml[pos])) {
+    ++pos;
+  }
+  if (pos == start) {
+    fail(atEnd() ? "Premature end of document." : "Unexpected character.");
+  }
+  char32_t first = code(xml[start]);
+  if ((first >= '0' && first <= '9') || first == '-' || first == '.') {
+    pos = start;
+    fail("Invalid name.");
+  }
+  return xml.substr(start, pos - start);
+}
+
+
+
+template<typename Char>
+void XmlScanner<Char>::readStartTag() {
+  ++pos;
+  View tag = readName();
+  tree.startElement(toUtf8(tag, name));
+  while (true) {
+    bool separated = skipSpace();
+    if (startsWith("/>")) {
+      pos += 2;
+      tree.endElement();
+      return;
+    }
+    if (peek() == '>') {
+      ++pos;
+      openTags.push_back(tag);
+      return;
+    }
+    if (atEnd()) {
+      fail("Premature end of document.");
+    }
+    if (!separated) {
+      fail("Expected whitespace, '>' or '/>'.");
+    }
+    readAttribute();
+  }
+}
+
+
+
+template<typename Char>
+void XmlScanner<Char>::readEndTag() {
+  pos += 2;
+  size_t start = pos;
+  View tag = readName();
+  skipSpace();
+  if (peek() != '>') {
+    fail(atEnd() ? "Premature end of document." : "Expected '>'.");
+  }
+  if (openTags.empty() || openTags.back() != tag) {
+    pos = start;
+    fail("Opening and ending tag mismatch.");
+  }
+  ++pos;
+  openTags.pop_back();
+  tree.endElement();
+}
+
+
+
+template<typename Char>
+void XmlScanner<Char>::readAttribute() {
+  View attributeName = readName();
+  skipSpace();
+  if (peek() != '=') {
+    fail("Expected '=' after attribute name.");
+  }
+  ++pos;
+  skipSpace();
+  Char quote = peek();
+  if (quote != '"' && quote != '\'') {
+    fail("Expected quoted attribute value.");
+  }
+
+  // Most values can be passed on as they are.
+  size_t start = ++pos;
+  bool plain = true;
+  while (!atEnd() && xml[pos] != quote) {
+    Char c = xml[pos];
+    plain &= c != '&' && c != '<' && c != '\t' && c != '\n' && c != '\r';
+    ++pos;
+  }
+  if (atEnd()) {
+    fail("Premature end of document.");
+  }
+  View raw = xml.substr(start, pos - start);
+  ++pos;
+
+  std::string_view n = toUtf8(attributeName, name);
+  if (plain) {
+    tree.addAttribute(n, toUtf8(raw, value));
+  }
+  else {
+    decodeValue(raw, start);
+    tree.addAttribute(n, toUtf8(decoded, value));
+  }
+}
+
+
+
+/**
+ * @brief Resolve references and normalize whitespace in an attribute
+ * value, as every XML parser has to: line breaks, including CR LF,
+ * and tabs become spaces.
+ *
+ * @param raw The value as written in the text.
+ * @param offset Position of the value in the text, for errors.
+ */
+template<typename Char>
+void XmlScanner<Char>::decodeValue(View raw, size_t offset) {
+  decoded.clear();
+  for (size_t i = 0; i < raw.size(); ++i) {
+    Char c = raw[i];
+    if (c == '<') {
+      pos = offset + i;
+      fail("Attribute values must not contain '<'.");
+    }
+    else if (c == '\r') {
+      decoded += Char(' ');
+      if (i + 1 < raw.size() && raw[i + 1] == '\n') {
+        ++i;
+      }
+    }
+    else if (c == '\n' || c == '\t') {
+      decoded += Char(' ');
+    }
+    else if (c == '&') {
+      size_t end = raw.find(Char(';'), i);
+      if (end == View::npos) {
+        pos = offset + i;
+        fail("Unterminated reference.");
+      }
+      appendReference(raw.substr(i + 1, end - i - 1), offset + i);
+      i = end;
+    }
+    else {
+      decoded += c;
+    }
+  }
+}
+
+
+
+/**
+ * @brief Append the character a reference stands for to the decoded
+ * value.
+ *
+ * @param reference The reference between '&' and ';'.
+ * @param offset Position of the reference in the text, for errors.
+ */
+template<typename Char>
+void XmlScanner<Char>::appendReference(View reference, size_t offset) {
+  if (reference.empty() || reference[0] != '#') {
+    static constexpr std::pair<char const*, char> entities[] = {
+      {"amp", '&'}, {"lt", '<'}, {"gt", '>'}, {"quot", '"'}, {"apos", '\''}
+    };
+    for (auto [entity, c]: entities) {
+      if (equals(reference, entity)) {
+        decoded += Char(c);
+        return;
+      }
+    }
+    pos = offset;
+    fail("Undefined entity.");
+  }
+
+  bool hex = reference.size() > 1 && reference[1] == 'x';
+  size_t i = hex ? 2 : 1;
+  char32_t c = 0;
+  for (; i < reference.size() && c <= 0x10FFFF; ++i) {
+    char32_t digit = code(reference[i]);
+    if (digit >= '0' && digit <= '9') {
+      digit -= '0';
+    }
+    else if (hex && digit >= 'a' && digit <= 'f') {
+      digit -= 'a' - 10;
+    }
+    else if (hex && digit >= 'A' && digit <= 'F') {
+      digit -= 'A' - 10;
+    }
+    else {
+      break;
+    }
+    c = c * (hex ? 16 : 10) + digit;
+  }
+  // Only characters that are allowed in XML text.
+  bool valid = c == 0x9 || c == 0xA || c == 0xD || (c >= 0x20 && c <= 0xD7FF)
+               || (c >= 0xE000 && c <= 0xFFFD) || (c >= 0x10000 && c <= 0x10FFFF);
+  if (i != reference.size() || i == (hex ? 2u : 1u) || !valid) {
+    pos = offset;
+    fail("Invalid character reference.");
+  }
+  appendChar(c);
+}
+
+
+
+template<typename Char>
+void XmlScanner<Char>::appendChar(char32_t c) {
+  if constexpr (std::is_same_v<Char, char16_t>) {
+    if (c >= 0x10000) {
+      c -= 0x10000;
+      decoded += static_cast<char16_t>(0xD800 + (c >> 10));
+      decoded += static_cast<char16_t>(0xDC00 + (c & 0x3FF));
+    }
+    else {
+      decoded += static_cast<char16_t>(c);
+    }
+  }
+  else {
+    if (c < 0x80) {
+      decoded += static_cast<char>(c);
+    }
+    else if (c < 0x800) {
+      decoded += static_cast<char>(0xC0 | (c >> 6));
+      decoded += static_cast<char>(0x80 | (c & 0x3F));
+    }
+    else if (c < 0x10000) {
+      decoded += static_cast<char>(0xE0 | (c >> 12));
+      decoded += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+      decoded += static_cast<char>(0x80 | (c & 0x3F));
+    }
+    else {
+      decoded += static_cast<char>(0xF0 | (c >> 18));
+      decoded += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+      decoded += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+      decoded += static_cast<char>(0x80 | (c & 0x3F));
+    }
+  }
+}
+
+
+
+template<typename Char>
+std::string_view XmlScanner<Char>::toUtf8(View text, std::string& buffer) const {
+  if constexpr (std::is_same_v<Char, char16_t>) {
+    buffer.clear();
+    appendUtf8(buffer, text);
+    return buffer;
+  }
+  else {
+    return text;
+  }
+}
+
+
+
+/**
+ * @brief Throw a CorruptFileError for the current position.
+ */
+template<typename Char>
+void XmlScanner<Char>::fail(char const* message) const {
+  size_t line = 1;
+  size_t lineStart = 0;
+  for (size_t i = 0; i < pos && i < xml.size(); ++i) {
+    if (xml[i] == '\n') {
+      ++line;
+      lineStart = i + 1;
+    }
+  }
+  std::string error = "Can't parse project XML (Producer.Dat) at line " +
+                      std::to_string(line) +
+                      ", column " +
+                      std::to_string(pos - lineStart + 1) +
+                      ": " +
+                      message;
+  throw mswmm::CorruptFileError(error);
+}
+
+
+
+template<typename Char>
+void XmlScanner<Char>::parse() {
+  // Skip a byte order mark.
+  if constexpr (std::is_same_v<Char, char16_t>) {
+    if (peek() == 0xFEFF) {
+      ++pos;
+    }
+  }
+  else if (startsWith("\xEF\xBB\xBF")) {
+    pos = 3;
+  }
+
+  bool hasRoot = false;
+  while (true) {
+    // Text is dropped; outside of the document element, there may
+    // only be whitespace.
+    size_t start = pos;
+    while (!atEnd() && xml[pos] != '<') {
+      ++pos;
+    }
+    if (openTags.empty()) {
+      for (size_t i = start; i < pos; ++i) {
+        if (!isSpace(xml[i])) {
+          pos = i;
+          fail(hasRoot ? "Extra content at end of document." : "Start tag expected.");
+        }
+      }
+    }
+    if (atEnd()) {
+      break;
+    }
+
+    if (startsWith("</")) {
+      readEndTag();
+    }
+    else if (startsWith("<?")) {
+      skipUntil("?>");
+    }
+    else if (startsWith("<!--")) {
+      skipUntil("-->");
+    }
+    else if (startsWith("<![CDATA[")) {
+      if (openTags.empty()) {
+        fail("CDATA section outside of the document element.");
+      }
+      skipUntil("]]>");
+    }
+    else if (startsWith("<!DOCTYPE")) {
+      if (hasRoot) {
+        fail("Unexpected document type declaration.");
+      }
+      skipDoctype();
+    }
+    else {
+      if (hasRoot && openTags.empty()) {
+        fail("Extra content at end of document.");
+      }
+      readStartTag();
+      hasRoot = true;
+    }
+  }
+
+  if (!hasRoot || !openTags.empty()) {
+    fail("Premature end of document.");
+  }
+}
+
+
+
+/**
+ * @brief Read XML with the embedded pull parser into an element tree.
+ * This doesn't need Qt, and doesn't copy or convert the text except
+ * for the names and values that are stored.
+ *
+ * @param xml The content of Producer.Dat.
+ * @param tree The tree to fill; should be empty.
+ */
+void readXml(std::u16string_view xml, XmlTree& tree) {
+  XmlScanner<char16_t>(xml, tree).parse();
+}
+
+
+
+/**
+ * @brief Read XML in UTF-8 with the embedded pull parser into an
+ * element tree, e.g. a Producer.Dat that was already transcoded.
+ *
+ * @param xml The XML text.
+ * @param tree The tree to fill; should be empty.
+ */
+void readXml(std::string_view xml, XmlTree& tree) {
+  XmlScanner<char>(xml, tree).parse();
+}
+
+
+
+#ifdef MSWMM_WITH_QT
+
+static std::u16string_view toView(QStringView str) {
+  return std::u16string_view(reinterpret_cast<char16_t const*>(str.utf16()), str.size());
+}
+
+
+
+/**
+ * @brief Read XML with Qt's pull parser into an element tree, without
+ * ever building a DOM. Kept to compare against readXml().
+ *
+ * @param xml The content of Producer.Dat.
+ * @param tree The tree to fill; should be empty.
+ */
+void readXmlStream(QString const& xml, XmlTree& tree) {
+  // Names and values are converted into these buffers, which are
+  // reused, so there are no allocations per element or attribute.
+  std::string tag;
+  std::string name;
+  std::string value;
+
+  QXmlStreamReader reader(xml);
+  while (!reader.atEnd()) {
+    auto token = reader.readNext();
+    if (token == QXmlStreamReader::StartElement) {
+      tag.clear();
+      appendUtf8(tag, toView(reader.name()));
+      tree.startElement(tag);
+      for (auto const& a: reader.attributes()) {
+        name.clear();
+        value.clear();
+        appendUtf8(name, toView(a.name()));
+        appendUtf8(value, toView(a.value()));
+        tree.addAttribute(name, value);
+      }
+    }
+    else if (token == QXmlStreamReader::EndElement) {
+      tree.endElement();
+    }
+  }
+
+  if (reader.hasError()) {
+    std::string error = "Can't parse project XML (Producer.Dat) at line " +
+                        std::to_string(reader.lineNumber()) +
+                        ", column " +
+                        std::to_string(reader.columnNumber()) +
+                        ": " +
+                        reader.errorString().toStdString();
+    throw mswmm::CorruptFileError(error);
+  }
+}
+
+
+
+/**
+ * @brief Copy a DOM element and all of its descendants into the
+ * element tree.
+ *
+ * @param element The element to copy.
+ * @param tree The tree to add the element to.
+ * @param name Buffer for converted names, reused for all elements.
+ * @param value Buffer for converted values, reused for all elements.
+ */
+static void readXmlDom(QDomElement const& element, XmlTree& tree, std::string& name, std::string& value) {
+  name.clear();
+  appendUtf8(name, toView(element.tagName()));
+  tree.startElement(name);
+  auto attr = element.attributes();
+  for (int i = 0; i < attr.count(); ++i) {
+    QDomNode a = attr.item(i);
+    name.clear();
+    value.clear();
+    appendUtf8(name, toView(a.nodeName()));
+    appendUtf8(value, toView(a.nodeValue()));
+    tree.addAttribute(name, value);
+  }
+
+  QDomElement n = element.firstChildElement();
+  for (; !n.isNull(); n = n.nextSiblingElement()) {
+    readXmlDom(n, tree, name, value);
+  }
+  tree.endElement();
+}
+
+
+
+/**
+ * @brief Copy a DOM element and all of its descendants into the
+ * element tree.
+ *
+ * @param element The element to copy.
+ * @param tree The tree to add the element to.
+ */
+void readXmlDom(QDomElement const& element, XmlTree& tree) {
+  std::string name;
+  std::string value;
+  readXmlDom(element, tree, name, value);
+}
+
+#endif
+
+} // Namespace mswmm
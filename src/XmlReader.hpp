@@ -0,0 +1,46 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#ifndef _MSWMM_XMLREADER_HPP
+#define _MSWMM_XMLREADER_HPP
+
+#include <string_view>
+
+#ifdef MSWMM_WITH_QT
+#include <qdom.h>
+#include <QString>
+#endif
+
+#include "XmlTree.hpp"
+
+
+namespace mswmm {
+
+// Fill an element tree from XML text. readXml() is the embedded pull
+// parser, which reads UTF-16 like Producer.Dat or text transcoded to
+// UTF-8. Builds with Qt can also use Qt's pull parser or copy an
+// existing DOM. Parse errors throw a CorruptFileError.
+
+void readXml(std::u16string_view xml, XmlTree& tree);
+void readXml(std::string_view xml, XmlTree& tree);
+#ifdef MSWMM_WITH_QT
+void readXmlStream(QString const& xml, XmlTree& tree);
+void readXmlDom(QDomElement const& element, XmlTree& tree);
+#endif
+
+} // Namespace mswmm
+
+#endif
@@ -0,0 +1,362 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#include <string>
+#include <vector>
+#include <charconv>
+#include <stdexcept>
+
+#include "XmlTree.hpp"
+
+
+namespace mswmm {
+
+std::string_view XmlTree::Element::tagName() const {
+  if (isNull()) {
+    return {};
+  }
+  return tree->string(tree->nodes[index].tag);
+}
+
+
+
+bool XmlTree::Element::hasAttribute(std::string_view name) const {
+  return findAttribute(name) != nullptr;
+}
+
+
+
+/**
+ * @brief Get the value of an attribute.
+ *
+ * @param name The name of the attribute.
+ * @return std::string_view The value, or an empty string if the
+ * element is Null or doesn't carry the attribute. The view stays
+ * valid for the lifetime of the tree and is zero terminated.
+ */
+std::string_view XmlTree::Element::attribute(std::string_view name) const {
+  char const* value = findAttribute(name);
+  return value ? std::string_view(value) : std::string_view();
+}
+
+
+
+/**
+ * @brief Get an attribute converted to float.
+ * Like QString::toFloat(), returns 0 if the conversion fails, and
+ * doesn't depend on the locale either.
+ */
+float XmlTree::Element::floatAttribute(std::string_view name) const {
+  std::string_view value = attribute(name);
+  float f = 0;
+  auto result = std::from_chars(value.data(), value.data() + value.size(), f);
+  if (result.ec != std::errc() || result.ptr != value.data() + value.size()) {
+    return 0;
+  }
+  return f;
+}
+
+
+
+/**
+ * @brief Get an attribute converted to unsigned long.
+ * Like QString::toULong(), returns 0 if the conversion fails.
+ */
+unsigned long XmlTree::Element::ulongAttribute(std::string_view name) const {
+  std::string_view value = attribute(name);
+  unsigned long l = 0;
+  auto result = std::from_chars(value.data(), value.data() + value.size(), l);
+  if (result.ec != std::errc() || result.ptr != value.data() + value.size()) {
+    return 0;
+  }
+  return l;
+}
+
+
+
+/**
+ * @brief Get an attribute converted to int.
+ * Like QString::toInt(), returns 0 if the conversion fails.
+ */
+int XmlTree::Element::intAttribute(std::string_view name) const {
+  std::string_view value = attribute(name);
+  int i = 0;
+  auto result = std::from_chars(value.data(), value.data() + value.size(), i);
+  if (result.ec != std::errc() || result.ptr != value.data() + value.size()) {
+    return 0;
+  }
+  return i;
+}
+
+
+
+size_t XmlTree::Element::attributeCount() const {
+  return isNull() ? 0 : tree->nodes[index].attributeCount;
+}
+
+
+
+/**
+ * @brief Get the name of an attribute, in document order.
+ *
+ * @param i Index of the attribute, smaller than attributeCount().
+ */
+std::string_view XmlTree::Element::attributeName(size_t i) const {
+  return tree->string(tree->attributes[tree->nodes[index].firstAttribute + i].name);
+}
+
+
+
+/**
+ * @brief Get the value of an attribute, in document order.
+ *
+ * @param i Index of the attribute, smaller than attributeCount().
+ */
+std::string_view XmlTree::Element::attributeValue(size_t i) const {
+  return tree->string(tree->attributes[tree->nodes[index].firstAttribute + i].value);
+}
+
+
+
+/**
+ * @brief Get the first child element with the given tag name.
+ *
+ * @param tag The tag name; any element matches if empty.
+ * @return Element The child, which might be Null.
+ */
+XmlTree::Element XmlTree::Element::firstChildElement(std::string_view tag) const {
+  if (isNull()) {
+    return Element();
+  }
+  uint32_t i = tree->nodes[index].firstChild;
+  for (; i != none; i = tree->nodes[i].nextSibling) {
+    if (tag.empty() || tree->string(tree->nodes[i].tag) == tag) {
+      return Element(tree, i);
+    }
+  }
+  return Element();
+}
+
+
+
+/**
+ * @brief Get the next sibling element with the given tag name.
+ *
+ * @param tag The tag name; any element matches if empty.
+ * @return Element The sibling, which might be Null.
+ */
+XmlTree::Element XmlTree::Element::nextSiblingElement(std::string_view tag) const {
+  if (isNull()) {
+    return Element();
+  }
+  uint32_t i = tree->nodes[index].nextSibling;
+  for (; i != none; i = tree->nodes[i].nextSibling) {
+    if (tag.empty() || tree->string(tree->nodes[i].tag) == tag) {
+      return Element(tree, i);
+    }
+  }
+  return Element();
+}
+
+
+
+char const* XmlTree::Element::findAttribute(std::string_view name) const {
+  if (isNull()) {
+    return nullptr;
+  }
+  Node const& node = tree->nodes[index];
+  for (uint32_t i = 0; i < node.attributeCount; ++i) {
+    Attribute const& a = tree->attributes[node.firstAttribute + i];
+    if (tree->string(a.name) == name) {
+      return tree->pool.data() + a.value;
+    }
+  }
+  return nullptr;
+}
+
+
+
+XmlTree::XmlTree(std::pmr::memory_resource* resource)
+  : nodes(resource),
+    attributes(resource),
+    pool(resource),
+    names(resource),
+    openElements(resource),
+    lastChildren(resource)
+{
+}
+
+
+
+XmlTree::Element XmlTree::documentElement() const {
+  if (nodes.empty()) {
+    return Element();
+  }
+  return Element(this, 0);
+}
+
+
+
+/**
+ * @brief Write the start tag of an element with its attributes, on
+ * its own line.
+ *
+ * @param line The indentation of the line; it is reused as buffer.
+ * @param empty Whether the element has no children, so the tag closes
+ * it as well.
+ */
+static void printStartTag(std::ostream& target, XmlTree::Element element, std::string& line, bool empty) {
+  line += '<';
+  line += element.tagName();
+  for (size_t i = 0; i < element.attributeCount(); ++i) {
+    line += ' ';
+    line += element.attributeName(i);
+    line += "=\"";
+    for (char c: element.attributeValue(i)) {
+      switch (c) {
+        case '&':  line += "&amp;";  break;
+        case '<':  line += "&lt;";   break;
+        case '>':  line += "&gt;";   break;
+        case '"':  line += "&quot;"; break;
+        case '\t': line += "&#x9;";  break;
+        case '\n': line += "&#xa;";  break;
+        case '\r': line += "&#xd;";  break;
+        default:   line += c;
+      }
+    }
+    line += '"';
+  }
+  line += empty ? "/>\n" : ">\n";
+  target << line;
+}
+
+
+
+/**
+ * @brief Write the tree as XML, formatted like QDomDocument::toString()
+ * does. Only elements and attributes are kept in the tree, so text
+ * and comments of the original document are missing.
+ *
+ * The tree is walked with a stack of the open elements instead of
+ * recursion, as the nesting of a corrupt file has no limit.
+ *
+ * @param target Where to write to.
+ * @param indent Spaces per level of nesting.
+ */
+void XmlTree::print(std::ostream& target, uint8_t indent) const {
+  std::vector<Element> open;
+  std::string line;
+  Element element = documentElement();
+  while (!element.isNull()) {
+    Element child = element.firstChildElement();
+    line.assign(indent * open.size(), ' ');
+    printStartTag(target, element, line, child.isNull());
+    if (!child.isNull()) {
+      open.push_back(element);
+      element = child;
+      continue;
+    }
+    // Close the elements that are complete, up to the next sibling.
+    element = element.nextSiblingElement();
+    while (element.isNull() && !open.empty()) {
+      Element parent = open.back();
+      open.pop_back();
+      line.assign(indent * open.size(), ' ');
+      line += "</";
+      line += parent.tagName();
+      line += ">\n";
+      target << line;
+      element = open.empty() ? Element() : parent.nextSiblingElement();
+    }
+  }
+}
+
+
+
+void XmlTree::startElement(std::string_view tag) {
+  if (openElements.empty() && !nodes.empty()) {
+    throw std::logic_error("XML document can only have one root element.");
+  }
+
+  uint32_t index = nodes.size();
+  nodes.push_back({addName(tag), static_cast<uint32_t>(attributes.size()), 0, none, none});
+
+  // Link new node to its parent or its previous sibling.
+  if (!openElements.empty()) {
+    uint32_t& lastChild = lastChildren.back();
+    if (lastChild == none) {
+      nodes[openElements.back()].firstChild = index;
+    }
+    else {
+      nodes[lastChild].nextSibling = index;
+    }
+    lastChild = index;
+  }
+  openElements.push_back(index);
+  lastChildren.push_back(none);
+}
+
+
+
+void XmlTree::addAttribute(std::string_view name, std::string_view value) {
+  if (openElements.empty() || lastChildren.back() != none) {
+    throw std::logic_error("XML attribute added outside of a start tag.");
+  }
+  attributes.push_back({addName(name), addString(value)});
+  ++nodes[openElements.back()].attributeCount;
+}
+
+
+
+void XmlTree::endElement() {
+  if (openElements.empty()) {
+    throw std::logic_error("XML end tag without start tag.");
+  }
+  openElements.pop_back();
+  lastChildren.pop_back();
+}
+
+
+
+uint32_t XmlTree::addString(std::string_view str) {
+  uint32_t offset = pool.size();
+  pool.append(str);
+  pool.push_back('\0');
+  return offset;
+}
+
+
+
+uint32_t XmlTree::addName(std::string_view name) {
+  size_t hash = std::hash<std::string_view>()(name);
+  auto range = names.equal_range(hash);
+  for (auto it = range.first; it != range.second; ++it) {
+    if (string(it->second) == name) {
+      return it->second;
+    }
+  }
+  uint32_t offset = addString(name);
+  names.emplace(hash, offset);
+  return offset;
+}
+
+
+
+std::string_view XmlTree::string(uint32_t offset) const {
+  return std::string_view(pool.data() + offset);
+}
+
+} // Namespace mswmm
@@ -0,0 +1,115 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#ifndef _MSWMM_XMLTREE_HPP
+#define _MSWMM_XMLTREE_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <ostream>
+#include <string_view>
+#include <unordered_map>
+#include <memory_resource>
+
+
+namespace mswmm {
+
+/**
+ * @brief A compact, read-only element tree of an XML document.
+ *
+ * Only elements and their attributes are stored; text, comments and
+ * whitespace are dropped. All nodes live in one vector and all names
+ * and values in one string pool, so a whole Producer.Dat takes a
+ * fraction of the memory a QDomDocument would.
+ * Navigation mimics the QDom API, so code reads the same.
+ * All memory comes from the memory resource given on construction.
+ */
+class XmlTree {
+  public:
+    class Element {
+      public:
+        Element() : tree(nullptr), index(0) {}
+
+        bool isNull() const { return tree == nullptr; }
+        std::string_view tagName() const;
+        bool hasAttribute(std::string_view name) const;
+        std::string_view attribute(std::string_view name) const;
+        float floatAttribute(std::string_view name) const;
+        unsigned long ulongAttribute(std::string_view name) const;
+        int intAttribute(std::string_view name) const;
+        size_t attributeCount() const;
+        std::string_view attributeName(size_t i) const;
+        std::string_view attributeValue(size_t i) const;
+        Element firstChildElement(std::string_view tag = {}) const;
+        Element nextSiblingElement(std::string_view tag = {}) const;
+
+      private:
+        friend class XmlTree;
+        Element(XmlTree const* tree, uint32_t index) : tree(tree), index(index) {}
+        char const* findAttribute(std::string_view name) const;
+
+        XmlTree const* tree;
+        uint32_t index;
+    };
+
+    explicit XmlTree(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    Element documentElement() const;
+    bool isEmpty() const { return nodes.empty(); }
+    void print(std::ostream& target, uint8_t indent) const;
+
+    // Building the tree. Elements have to be opened and closed in
+    // document order; attributes belong to the last opened element
+    // and have to be added before its first child is opened.
+    void startElement(std::string_view tag);
+    void addAttribute(std::string_view name, std::string_view value);
+    void endElement();
+
+  private:
+    static constexpr uint32_t none = UINT32_MAX;
+
+    struct Node {
+      uint32_t tag;
+      uint32_t firstAttribute;
+      uint32_t attributeCount;
+      uint32_t firstChild;
+      uint32_t nextSibling;
+    };
+
+    struct Attribute {
+      uint32_t name;
+      uint32_t value;
+    };
+
+    uint32_t addString(std::string_view str);
+    uint32_t addName(std::string_view name);
+    std::string_view string(uint32_t offset) const;
+
+    std::pmr::vector<Node> nodes;
+    std::pmr::vector<Attribute> attributes;
+    // Zero terminated strings, referenced by their offset.
+    std::pmr::string pool;
+    // Tag and attribute names are stored only once. They are found by
+    // their hash, so looking them up doesn't allocate.
+    std::pmr::unordered_multimap<size_t, uint32_t> names;
+    // Currently open elements and the last child added to each of them.
+    std::pmr::vector<uint32_t> openElements;
+    std::pmr::vector<uint32_t> lastChildren;
+};
+
+} // Namespace mswmm
+
+#endif
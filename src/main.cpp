@@ -15,24 +15,334 @@ GNU General Public License for more details.
 See LICENSE file for the full license text.
 *******************************************************************/
 #include <string>
+#include <charconv>
 #include <cstring>
+#include <fstream>
+#include <iterator>
+#include <optional>
 #include <iostream>
+#include <filesystem>
 #include <stdexcept>
 
 #include "Project.hpp"
+#include "Batch.hpp"
+#include "Thumbnails.hpp"
+#include "MediaIndex.hpp"
+#include "MediaProbe.hpp"
+#include "ArchiveIndex.hpp"
+#include "MappedFile.hpp"
+#include "Render.hpp"
+#include "Titles.hpp"
+#include "Export.hpp"
+#include "Snapshot.hpp"
+
+
+
+/**
+ * @brief Print how to call the tool.
+ *
+ * @param programName The name the tool was called with.
+ */
+static void printUsage(std::string const& programName) {
+  std::cout << "Usage: " << programName
+            << " command path/to/file.MSWMM [--cache DIR] [--stats]\n"
+            << "       where command = info|xml|json|snapshot|ffmpeg|titles\n"
+            << "       ffmpeg takes [--height N] [--fps N] [--output FILE] [--segments SECONDS] [--probe] [--titles]\n"
+            << "   or: " << programName
+            << " batch path/to/directory|path/to/file-list [--jobs N] [--unordered] [--cache DIR] [--trace FILE]\n"
+            << "   or: " << programName
+            << " thumbnails path/to/directory|path/to/file-list output/directory [--jobs N] [--unordered]\n"
+            << "   or: " << programName
+            << " links path/to/directory|path/to/file-list [--media-root DIR] [--jobs N] [--unordered]\n"
+            << "   or: " << programName
+            << " probe path/to/directory|path/to/file-list [--media-root DIR] [--jobs N] [--unordered] [--cache DIR]\n"
+            << "   or: " << programName
+            << " index path/to/directory|path/to/file-list path/to/index [--jobs N] [--unordered] [--cache DIR] [--trace FILE]\n"
+            << "   or: " << programName
+            << " users path/to/index path\\to\\media\n"
+            << "   or: " << programName
+            << " missing path/to/index [--media-root DIR]" << std::endl;
+}
+
+
+
+/**
+ * @brief Parse a number given on the command line.
+ *
+ * @param text The command line argument.
+ * @param value Set to the number, if the whole argument is one.
+ * @return bool Whether the argument is a number.
+ */
+template<typename T>
+static bool parseNumber(char const* text, T& value) {
+  char const* end = text + strlen(text);
+  auto [ptr, error] = std::from_chars(text, end, value);
+  return error == std::errc() && ptr == end && ptr != text;
+}
 
 
 
 int main(int argc, char** argv) {
   if (argc <= 2) {
-    std::string programName(argv[0]);
-    std::cout << "Usage: " << programName
-              << " command path/to/file.MSWMM\n"
-              << "       where command = info|xml|ffmpeg" << std::endl;
+    printUsage(argv[0]);
+    return 1;
+  }
+
+  mswmm::LoadOptions options;
+  options.memoryMap = true;
+
+  // Queries of an archive index. The index is mapped into memory, so
+  // a query only reads the records it needs.
+  bool isUsers = strcmp(argv[1], "users") == 0;
+  if (isUsers || strcmp(argv[1], "missing") == 0) {
+    std::string mediaRoot;
+    for (int i = isUsers ? 4 : 3; i < argc; ++i) {
+      if (!isUsers && strcmp(argv[i], "--media-root") == 0 && i+1 < argc) {
+        mediaRoot = argv[++i];
+      }
+      else {
+        std::cout << "Unknown option '" << argv[i] << "'." << std::endl;
+        return 1;
+      }
+    }
+    if (isUsers && argc < 4) {
+      std::cout << "Missing media file." << std::endl;
+      return 1;
+    }
+    try {
+      mswmm::MappedFile file(argv[2]);
+      mswmm::ArchiveIndex index(file.data(), file.size());
+      if (isUsers) {
+        std::optional<uint32_t> media = index.findMedia(argv[3]);
+        if (media) {
+          mswmm::ArchiveMedia mediaFile = index.mediaFile(*media);
+          for (size_t i = 0; i < mediaFile.projectCount; ++i) {
+            std::cout << index.project(index.mediaProject(mediaFile, i)).path << '\n';
+          }
+        }
+      }
+      else {
+        std::optional<mswmm::MediaIndex> mediaIndex;
+        if (!mediaRoot.empty()) {
+          mediaIndex.emplace(mediaRoot);
+        }
+        for (uint32_t missing: mswmm::findMissingMedia(index, mediaIndex ? &*mediaIndex : nullptr)) {
+          mswmm::ArchiveMedia mediaFile = index.mediaFile(missing);
+          std::cout << mediaFile.originalPath << " (" << mediaFile.projectCount << " projects)\n";
+        }
+      }
+    }
+    catch (std::exception& e) {
+      std::cerr << "ERROR: " << e.what() << std::endl;
+      return 1;
+    }
+    return 0;
+  }
+
+  bool isThumbnails = strcmp(argv[1], "thumbnails") == 0;
+  bool isLinks = strcmp(argv[1], "links") == 0;
+  bool isProbe = strcmp(argv[1], "probe") == 0;
+  bool isIndex = strcmp(argv[1], "index") == 0;
+  if (strcmp(argv[1], "batch") == 0 || isThumbnails || isLinks || isProbe || isIndex) {
+    mswmm::BatchOptions batchOptions;
+    batchOptions.loadOptions = options;
+    std::string outputDirectory;
+    std::string mediaRoot;
+    int firstOption = 3;
+    if (isThumbnails) {
+      if (argc < 4) {
+        std::cout << "Missing output directory." << std::endl;
+        return 1;
+      }
+      outputDirectory = argv[3];
+      firstOption = 4;
+    }
+    std::string indexPath;
+    if (isIndex) {
+      if (argc < 4) {
+        std::cout << "Missing index file." << std::endl;
+        return 1;
+      }
+      indexPath = argv[3];
+      firstOption = 4;
+    }
+    for (int i = firstOption; i < argc; ++i) {
+      if (strcmp(argv[i], "--jobs") == 0 && i+1 < argc) {
+        if (!parseNumber(argv[++i], batchOptions.threads)) {
+          printUsage(argv[0]);
+          return 1;
+        }
+      }
+      else if (strcmp(argv[i], "--unordered") == 0) {
+        batchOptions.ordered = false;
+      }
+      else if (strcmp(argv[i], "--cache") == 0 && i+1 < argc) {
+        batchOptions.loadOptions.cacheDirectory = argv[++i];
+      }
+      else if (strcmp(argv[i], "--trace") == 0 && i+1 < argc) {
+        batchOptions.traceFile = argv[++i];
+      }
+      else if ((isLinks || isProbe) && strcmp(argv[i], "--media-root") == 0 && i+1 < argc) {
+        mediaRoot = argv[++i];
+      }
+      else {
+        std::cout << "Unknown option '" << argv[i] << "'." << std::endl;
+        return 1;
+      }
+    }
+
+    std::vector<std::string> files;
+    std::optional<mswmm::MediaIndex> mediaIndex;
+    std::optional<mswmm::ArchiveIndexBuilder> builder;
+    size_t indexed = 0;
+    // Shared by all projects, so each source file is probed once.
+    mswmm::MediaProbe mediaProbe;
+    std::string probeCache;
+    if (isProbe && !batchOptions.loadOptions.cacheDirectory.empty()) {
+      probeCache = (std::filesystem::path(batchOptions.loadOptions.cacheDirectory) / "media.cache").string();
+      mediaProbe.load(probeCache);
+    }
+    try {
+      files = mswmm::collectProjectFiles(argv[2]);
+      // The media root is walked once for all projects.
+      if (!mediaRoot.empty()) {
+        mediaIndex.emplace(mediaRoot);
+      }
+      // Only projects that changed since the last run are loaded.
+      if (isIndex) {
+        std::ifstream previous(indexPath, std::ios_base::in | std::ios_base::binary);
+        if (previous.good()) {
+          std::string buffer((std::istreambuf_iterator<char>(previous)), std::istreambuf_iterator<char>());
+          mswmm::ArchiveIndex index(buffer.data(), buffer.size());
+          builder.emplace(&index);
+        }
+        else {
+          builder.emplace();
+        }
+        indexed = files.size();
+        files = builder->update(files);
+      }
+    }
+    catch (std::exception& e) {
+      std::cerr << "ERROR: " << e.what() << std::endl;
+      return 1;
+    }
+    size_t failures;
+    try {
+      if (isThumbnails) {
+        auto job = [&](std::string const& path, mswmm::LoadOptions const& loadOptions, bool& failed) {
+          return mswmm::exportThumbnails(path, outputDirectory, loadOptions, failed);
+        };
+        failures = mswmm::runBatch(files, batchOptions, std::cout, job);
+      }
+      else if (isLinks) {
+        mswmm::MediaIndex const* index = mediaIndex ? &*mediaIndex : nullptr;
+        auto job = [&](std::string const& path, mswmm::LoadOptions const& loadOptions, bool& failed) {
+          return mswmm::resolveSources(path, index, loadOptions, failed);
+        };
+        failures = mswmm::runBatch(files, batchOptions, std::cout, job);
+      }
+      else if (isIndex) {
+        auto job = [&](std::string const& path, mswmm::LoadOptions const& loadOptions, bool& failed) {
+          return mswmm::indexProject(path, *builder, loadOptions, failed);
+        };
+        failures = mswmm::runBatch(files, batchOptions, std::cout, job);
+        std::string index = builder->write();
+        std::error_code error;
+        std::filesystem::path parent = std::filesystem::path(indexPath).parent_path();
+        if (!parent.empty()) {
+          std::filesystem::create_directories(parent, error);
+        }
+        if (!mswmm::replaceFile(indexPath, index)) {
+          throw std::runtime_error("Can't write index file '" + indexPath + "'.");
+        }
+      }
+      else if (isProbe) {
+        mswmm::MediaIndex const* index = mediaIndex ? &*mediaIndex : nullptr;
+        auto job = [&](std::string const& path, mswmm::LoadOptions const& loadOptions, bool& failed) {
+          return mswmm::probeSources(path, mediaProbe, index, loadOptions, failed);
+        };
+        failures = mswmm::runBatch(files, batchOptions, std::cout, job);
+        if (!probeCache.empty()) {
+          mediaProbe.save(probeCache);
+        }
+      }
+      else {
+        failures = mswmm::runBatch(files, batchOptions, std::cout);
+      }
+    }
+    catch (std::exception& e) {
+      std::cerr << "ERROR: " << e.what() << std::endl;
+      return 1;
+    }
+    std::cerr << files.size() - failures << " of " << files.size()
+              << " projects loaded successfully." << std::endl;
+    if (isIndex) {
+      std::cerr << indexed - files.size() << " unchanged projects were taken from the index." << std::endl;
+    }
+    return 0;
+  }
+
+  mswmm::RenderOptions renderOptions;
+  mswmm::MediaProbe mediaProbe;
+  bool segmented = false;
+  bool printStats = false;
+  bool isFfmpeg = strcmp(argv[1], "ffmpeg") == 0;
+  for (int i = 3; i < argc; ++i) {
+    // The XML itself is not cached, so printing it always parses the file.
+    if (strcmp(argv[i], "--cache") == 0 && i+1 < argc) {
+      if (strcmp(argv[1], "xml") != 0) {
+        options.cacheDirectory = argv[++i];
+      }
+      else {
+        ++i;
+      }
+    }
+    else if (strcmp(argv[i], "--stats") == 0) {
+      options.collectStats = true;
+      printStats = true;
+    }
+    else if (isFfmpeg && strcmp(argv[i], "--height") == 0 && i+1 < argc) {
+      if (!parseNumber(argv[++i], renderOptions.height)) {
+        printUsage(argv[0]);
+        return 1;
+      }
+    }
+    else if (isFfmpeg && strcmp(argv[i], "--fps") == 0 && i+1 < argc) {
+      if (!parseNumber(argv[++i], renderOptions.frameRate)) {
+        printUsage(argv[0]);
+        return 1;
+      }
+    }
+    else if (isFfmpeg && strcmp(argv[i], "--output") == 0 && i+1 < argc) {
+      renderOptions.output = argv[++i];
+    }
+    else if (isFfmpeg && strcmp(argv[i], "--segments") == 0 && i+1 < argc) {
+      if (!parseNumber(argv[++i], renderOptions.segmentLength)) {
+        printUsage(argv[0]);
+        return 1;
+      }
+      segmented = true;
+    }
+    else if (isFfmpeg && strcmp(argv[i], "--probe") == 0) {
+      renderOptions.probe = &mediaProbe;
+    }
+    else if (isFfmpeg && strcmp(argv[i], "--titles") == 0) {
+      renderOptions.titles = true;
+    }
+    else {
+      std::cout << "Unknown option '" << argv[i] << "'." << std::endl;
+      return 1;
+    }
+  }
+
+  // Shorter segments can't be cut.
+  if (segmented && !(renderOptions.segmentLength * renderOptions.frameRate >= 1)) {
+    std::cout << "Segments have to be at least one frame long." << std::endl;
     return 1;
   }
 
-  mswmm::Project project(argv[2]);
+  mswmm::Project project(argv[2], options);
 
   if (strcmp(argv[1], "xml") == 0) {
     project.printXml(std::cout);
@@ -47,25 +357,64 @@ int main(int argc, char** argv) {
     project.printMediaTimeline(std::cout, mswmm::TrackType::VIDEO, indent);
     std::cout << "Audio timeline:\n";
     project.printMediaTimeline(std::cout, mswmm::TrackType::AUDIO, indent);
+    std::cout << "Title timeline:\n";
+    project.printMediaTimeline(std::cout, mswmm::TrackType::SOMETHING, indent);
   }
-  else if (strcmp(argv[1], "ffmpeg") == 0) {
-    std::vector<std::pair<std::string, std::string>> substitutions;
-    substitutions.emplace_back("\\", "/");
-    substitutions.emplace_back("@:MyPictures", "/home/jeinzi/Bilder");
+  else if (strcmp(argv[1], "json") == 0) {
+    std::cout << mswmm::exportJson(project) << std::endl;
+  }
+  else if (strcmp(argv[1], "snapshot") == 0) {
+    std::string snapshot = mswmm::exportSnapshot(project);
+    std::cout.write(snapshot.data(), snapshot.size());
+  }
+  else if (isFfmpeg) {
+    mswmm::PathSubstitutions substitutions({
+      {"\\", "/"},
+      {"@:MyPictures", "/home/jeinzi/Bilder"}
+    });
+    std::string probeCache;
+    if (renderOptions.probe && !options.cacheDirectory.empty()) {
+      probeCache = (std::filesystem::path(options.cacheDirectory) / "media.cache").string();
+      mediaProbe.load(probeCache);
+    }
     std::string command;
     try {
-      command = project.generateFfmpegCommand(substitutions);
+      auto plan = segmented ? mswmm::planRender(project, substitutions, renderOptions)
+                            : mswmm::generateFfmpegCommand(project, substitutions, renderOptions);
+      // The filter graphs are written next to the output.
+      mswmm::writeRenderFiles(plan);
+      // One command per line, so the segments can be distributed,
+      // e.g. with xargs or GNU parallel, before joining them.
+      for (auto const& segment: plan.segments) {
+        command += segment.command + '\n';
+      }
+      command += plan.concatCommand;
+      if (plan.concatCommand.empty()) {
+        command.pop_back();
+      }
     }
     catch (std::runtime_error& e) {
       std::cout << "ERROR: " << e.what() << std::endl;
       return 1;
     }
+    if (!probeCache.empty()) {
+      mediaProbe.save(probeCache);
+    }
     std::cout << command << std::endl;
   }
+  else if (strcmp(argv[1], "titles") == 0) {
+    std::cout << mswmm::generateSubtitles(project);
+  }
   else {
     std::cout << "Command not known." << std::endl;
     return 1;
   }
 
+  // On stderr, so the output of the command stays usable.
+  if (printStats) {
+    std::cerr << "Statistics:\n";
+    mswmm::printStats(std::cerr, project.stats(), 4);
+  }
+
   return 0;
 }
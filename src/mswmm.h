@@ -0,0 +1,142 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#ifndef _MSWMM_H
+#define _MSWMM_H
+
+/*
+ * C interface of libmswmm, for embedding it into programs that can't
+ * use the C++ classes, e.g. video editors written in other languages.
+ *
+ * A project is opened from a file or a buffer and read through the
+ * functions below, which never throw. Each returns a status and, on
+ * failure, leaves a message for mswmm_last_error(). Strings are views
+ * into storage owned by the project: they are not copied, not zero
+ * terminated, and stay valid until the project is freed. Structs are
+ * only extended by new functions, so the layout of the existing ones
+ * never changes. Several threads may read the same project at once.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32) && defined(MSWMM_SHARED)
+#  ifdef MSWMM_BUILDING
+#    define MSWMM_API __declspec(dllexport)
+#  else
+#    define MSWMM_API __declspec(dllimport)
+#  endif
+#elif defined(__GNUC__)
+#  define MSWMM_API __attribute__((visibility("default")))
+#else
+#  define MSWMM_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Incremented whenever functions or structs are added. */
+#define MSWMM_API_VERSION 1
+
+typedef enum mswmm_status {
+  MSWMM_OK = 0,
+  MSWMM_ERROR = 1,          /* E.g. the file can't be read */
+  MSWMM_ERROR_CORRUPT = 2,  /* Not a valid project */
+  MSWMM_ERROR_ARGUMENT = 3, /* Null pointer or index out of range */
+  MSWMM_ERROR_MEMORY = 4
+} mswmm_status;
+
+typedef enum mswmm_track {
+  MSWMM_TRACK_VIDEO = 0,
+  MSWMM_TRACK_AUDIO = 1,
+  MSWMM_TRACK_TITLE = 5
+} mswmm_track;
+
+typedef enum mswmm_item_type {
+  MSWMM_ITEM_TITLE = 0,
+  MSWMM_ITEM_STILL = 1,
+  MSWMM_ITEM_VIDEO = 2,
+  MSWMM_ITEM_AUDIO = 3
+} mswmm_item_type;
+
+/* Flags of mswmm_item. */
+#define MSWMM_ITEM_MUTED     1u
+#define MSWMM_ITEM_FADES_IN  2u
+#define MSWMM_ITEM_FADES_OUT 4u
+
+typedef struct mswmm_project mswmm_project;
+
+typedef struct mswmm_string {
+  char const* data; /* Never null, even if the string is empty */
+  size_t length;
+} mswmm_string;
+
+typedef struct mswmm_metadata {
+  uint32_t aspect_ratio_x;
+  uint32_t aspect_ratio_y;
+  mswmm_string author;
+  mswmm_string title;
+  mswmm_string description;
+  mswmm_string copyright;
+  mswmm_string rating;
+} mswmm_metadata;
+
+/* Which fields are meaningful depends on the type, see TimelineItem. */
+typedef struct mswmm_item {
+  uint32_t type;  /* mswmm_item_type */
+  uint32_t flags; /* MSWMM_ITEM_* */
+  float timeline_start;
+  float timeline_end;
+  float source_start;
+  float source_end;
+  float volume;
+  uint32_t width;
+  uint32_t height;
+  uint64_t file_size_kib;
+  mswmm_string name;
+  mswmm_string source_path;
+  mswmm_string thumbnail;
+  mswmm_string link;
+  /* GUID of the transition from the previous item; empty if none. */
+  mswmm_string transition;
+  uint32_t effect_count;
+  uint32_t parameter_count;
+} mswmm_item;
+
+MSWMM_API int mswmm_api_version(void);
+MSWMM_API char const* mswmm_last_error(void);
+
+MSWMM_API mswmm_status mswmm_open_file(char const* path, mswmm_project** project);
+MSWMM_API mswmm_status mswmm_open_memory(void const* data, size_t length, mswmm_project** project);
+MSWMM_API void mswmm_free(mswmm_project* project);
+
+MSWMM_API mswmm_status mswmm_get_metadata(mswmm_project const* project, mswmm_metadata* metadata);
+MSWMM_API mswmm_status mswmm_source_file_count(mswmm_project const* project, size_t* count);
+MSWMM_API mswmm_status mswmm_get_source_file(mswmm_project const* project, size_t i, mswmm_string* path);
+MSWMM_API mswmm_status mswmm_item_count(mswmm_project const* project, mswmm_track track, size_t* count);
+MSWMM_API mswmm_status mswmm_get_item(mswmm_project const* project, mswmm_track track, size_t i,
+                                      mswmm_item* item);
+MSWMM_API mswmm_status mswmm_get_effect(mswmm_project const* project, mswmm_track track, size_t item,
+                                        size_t i, mswmm_string* guid);
+MSWMM_API mswmm_status mswmm_get_parameter(mswmm_project const* project, mswmm_track track, size_t item,
+                                           size_t i, mswmm_string* name, mswmm_string* value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
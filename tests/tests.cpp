@@ -0,0 +1,281 @@
+/*******************************************************************
+libmswmm: Read Microsoft Windows Movie Maker (.mswmm) files.
+Copyright © 2023 Julian Heinzel
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation; either version 2 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+See LICENSE file for the full license text.
+*******************************************************************/
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <optional>
+#include <algorithm>
+#include <stdexcept>
+#include <filesystem>
+
+#include "Project.hpp"
+#include "Export.hpp"
+#include "Snapshot.hpp"
+#include "ArchiveIndex.hpp"
+#include "Utf.hpp"
+#include "Generator.hpp"
+
+// Round trips of projects through the formats the library writes
+// itself: the parse cache, the snapshot and the archive index. The
+// projects are the example projects and a generated one.
+
+
+
+namespace {
+
+using namespace mswmm;
+namespace fs = std::filesystem;
+
+void check(bool condition, char const* expression, int line) {
+  if (!condition) {
+    throw std::runtime_error("Check failed in line " + std::to_string(line) + ": " + expression);
+  }
+}
+#define CHECK(condition) check((condition), #condition, __LINE__)
+
+
+
+bool hasStage(LoadStats const& stats, Stage stage) {
+  return std::any_of(stats.stages.begin(), stats.stages.end(), [stage](StageStats const& s) {
+    return s.stage == stage;
+  });
+}
+
+
+
+// The model taken from the cache has to be the one parsed from the
+// file. The first load stores it, the second one only reads it.
+void checkCache(std::string const& path, std::string const& cacheDirectory) {
+  std::string expected = exportJson(Project(path));
+  LoadOptions options;
+  options.cacheDirectory = cacheDirectory;
+  options.collectStats = true;
+  for (int run = 0; run < 2; ++run) {
+    Project project(path, options);
+    CHECK(exportJson(project) == expected);
+    LoadStats stats = project.stats();
+    if (run == 0) {
+      CHECK(hasStage(stats, Stage::STORE_CACHE));
+    }
+    else {
+      CHECK(hasStage(stats, Stage::LOAD_CACHE));
+      CHECK(!hasStage(stats, Stage::PARSE_XML));
+    }
+  }
+}
+
+
+
+void checkSnapshot(Project const& project) {
+  std::string data = exportSnapshot(project);
+  Snapshot snapshot(data.data(), data.size());
+
+  Metadata const& metadata = project.metadata();
+  CHECK(snapshot.aspectRatio() == metadata.aspectRatio);
+  CHECK(snapshot.author() == metadata.author);
+  CHECK(snapshot.title() == metadata.title);
+  CHECK(snapshot.description() == metadata.description);
+  CHECK(snapshot.copyright() == metadata.copyright);
+  CHECK(snapshot.rating() == metadata.rating);
+  CHECK(snapshot.hasTitleSequences() == project.hasTitleSequences());
+
+  auto const& files = project.sourceFiles();
+  CHECK(snapshot.fileCount() == files.size());
+  for (size_t i = 0; i < files.size(); ++i) {
+    CHECK(snapshot.file(i) == files[i]);
+  }
+
+  for (TrackType track: {TrackType::VIDEO, TrackType::AUDIO, TrackType::SOMETHING}) {
+    Timeline const& timeline = track == TrackType::VIDEO ? project.videoTimeline()
+                             : track == TrackType::AUDIO ? project.audioTimeline()
+                             : project.titleTimeline();
+    CHECK(snapshot.itemCount(track) == timeline.size());
+    for (size_t i = 0; i < timeline.size(); ++i) {
+      TimelineItem const& expected = timeline[i];
+      SnapshotItem item = snapshot.item(track, i);
+      CHECK(item.type == expected.type);
+      CHECK(item.isMuted == expected.isMuted);
+      CHECK(item.fadesIn == expected.fadesIn);
+      CHECK(item.fadesOut == expected.fadesOut);
+      CHECK(item.timelineStart == expected.timelineStart);
+      CHECK(item.timelineEnd == expected.timelineEnd);
+      CHECK(item.sourceStart == expected.sourceStart);
+      CHECK(item.sourceEnd == expected.sourceEnd);
+      CHECK(item.volume == expected.volume);
+      CHECK(item.name == timeline.name(expected));
+      CHECK(item.srcPath == timeline.srcPath(expected));
+      CHECK(item.thumbnail == timeline.thumbnail(expected));
+      CHECK(item.link == timeline.link(expected));
+      CHECK(item.transition == expected.transition.id);
+      CHECK(item.transitionGuid == timeline.transition(expected));
+      CHECK(item.fileSizeKiB == expected.fileSizeKiB);
+      CHECK(item.srcSizePx == expected.srcSizePx);
+      CHECK(item.effectCount == expected.effectCount);
+      for (size_t k = 0; k < item.effectCount; ++k) {
+        auto [id, guid] = snapshot.effect(item, k);
+        CHECK(id == timeline.effectId(expected, k));
+        CHECK(guid == timeline.effect(expected, k));
+      }
+      CHECK(item.parameterCount == expected.parameterCount);
+      for (size_t k = 0; k < item.parameterCount; ++k) {
+        CHECK(snapshot.parameter(item, k) == timeline.parameter(expected, k));
+      }
+    }
+  }
+}
+
+
+
+// Every source file of every project has to be found in the index,
+// pointing back to the project, and an unchanged archive has nothing
+// to load again.
+void checkArchiveIndex(std::vector<std::string> const& paths) {
+  ArchiveIndexBuilder builder;
+  std::vector<std::string> changed = builder.update(paths);
+  CHECK(changed.size() == paths.size());
+  for (auto const& path: changed) {
+    builder.addProject(path, Project(path));
+  }
+  std::string data = builder.write();
+  ArchiveIndex index(data.data(), data.size());
+  CHECK(index.projectCount() == paths.size());
+
+  for (auto const& path: paths) {
+    std::optional<uint32_t> indexed = index.findProject(path);
+    CHECK(indexed.has_value());
+    CHECK(!index.project(*indexed).failed);
+    Project project(path);
+    for (auto const& file: project.sourceFiles()) {
+      std::optional<uint32_t> media = index.findMedia(file);
+      CHECK(media.has_value());
+      ArchiveMedia mediaFile = index.mediaFile(*media);
+      bool found = false;
+      for (size_t i = 0; i < mediaFile.projectCount; ++i) {
+        found = found || index.mediaProject(mediaFile, i) == *indexed;
+      }
+      CHECK(found);
+    }
+  }
+
+  ArchiveIndexBuilder next(&index);
+  CHECK(next.update(paths).empty());
+  CHECK(next.projectCount() == paths.size());
+}
+
+
+
+// Straightforward encoder to compare the vectorized one to.
+std::string referenceUtf8(std::u16string_view source) {
+  std::string target;
+  for (size_t i = 0; i < source.size(); ++i) {
+    char32_t c = source[i];
+    if (c >= 0xD800 && c <= 0xDFFF) {
+      if (c <= 0xDBFF && i+1 < source.size() && source[i+1] >= 0xDC00 && source[i+1] <= 0xDFFF) {
+        c = 0x10000 + ((c - 0xD800) << 10) + (source[++i] - 0xDC00);
+      }
+      else {
+        c = 0xFFFD;
+      }
+    }
+    if (c < 0x80) {
+      target += static_cast<char>(c);
+    }
+    else if (c < 0x800) {
+      target += static_cast<char>(0xC0 | (c >> 6));
+      target += static_cast<char>(0x80 | (c & 0x3F));
+    }
+    else if (c < 0x10000) {
+      target += static_cast<char>(0xE0 | (c >> 12));
+      target += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+      target += static_cast<char>(0x80 | (c & 0x3F));
+    }
+    else {
+      target += static_cast<char>(0xF0 | (c >> 18));
+      target += static_cast<char>(0x80 | ((c >> 12) & 0x3F));
+      target += static_cast<char>(0x80 | ((c >> 6) & 0x3F));
+      target += static_cast<char>(0x80 | (c & 0x3F));
+    }
+  }
+  return target;
+}
+
+
+
+// Other characters at every position of the blocks the ASCII kernels
+// copy at once, so each kernel stops at each of its lanes.
+void checkUtf8() {
+  std::u16string_view others[] = {u"ü", u"€", u"\U0001F600", u"\xD800", u"\xDC00", u"\xD800" u"A"};
+  for (auto other: others) {
+    for (size_t position = 0; position < 80; ++position) {
+      std::u16string text(position, u'a');
+      text += other;
+      text += std::u16string(40, u'b');
+      std::string converted = "prefix";
+      appendUtf8(converted, text);
+      CHECK(converted == "prefix" + referenceUtf8(text));
+    }
+  }
+}
+
+} // Namespace
+
+
+
+int main(int argc, char* argv[]) {
+  if (argc != 3) {
+    std::cout << "Usage: " << argv[0] << " path/to/example-projects path/to/scratch/directory\n";
+    return 1;
+  }
+
+  try {
+    fs::path scratch = argv[2];
+    fs::remove_all(scratch);
+    fs::create_directories(scratch / "cache");
+
+    std::vector<std::string> paths;
+    for (auto const& entry: fs::recursive_directory_iterator(argv[1])) {
+      if (entry.path().extension() == ".MSWMM") {
+        paths.push_back(entry.path().string());
+      }
+    }
+    CHECK(!paths.empty());
+    std::sort(paths.begin(), paths.end());
+
+    GeneratorParams params;
+    params.items = 200;
+    params.effectsPerItem = 2;
+    params.sourceFiles = 20;
+    params.audioItems = 20;
+    std::string generated = (scratch / "generated.MSWMM").string();
+    std::ofstream(generated, std::ios::binary) << generateProject(params);
+    paths.push_back(generated);
+
+    for (auto const& path: paths) {
+      std::cout << path << std::endl;
+      checkCache(path, (scratch / "cache").string());
+      checkSnapshot(Project(path));
+    }
+    checkArchiveIndex(paths);
+    checkUtf8();
+  }
+  catch (std::exception const& e) {
+    std::cerr << "ERROR: " << e.what() << std::endl;
+    return 1;
+  }
+  return 0;
+}